@@ -56,6 +56,7 @@ static const string kUsage =
     "--key         - The key used to identify the device type in tracker. Default=\"\"\n"
     "--custom-addr - Custom IP Address to Report to RPC Tracker. Default=\"\"\n"
     "--silent      - Whether to run in silent mode. Default=False\n"
+    "--workers     - Number of sessions served at the same time, Linux only. Default=1\n"
     "\n"
     "  Example\n"
     "  ./tvm_rpc server --host=0.0.0.0 --port=9000 --port-end=9090 "
@@ -71,6 +72,7 @@ static const string kUsage =
  * \arg key The key used to identify the device type in tracker. Default=""
  * \arg custom_addr Custom IP Address to Report to RPC Tracker. Default=""
  * \arg silent Whether run in silent mode. Default=False
+ * \arg workers Number of sessions served at the same time. Default=1
  */
 struct RpcServerArgs {
   string host = "0.0.0.0";
@@ -80,6 +82,7 @@ struct RpcServerArgs {
   string key;
   string custom_addr;
   bool silent = false;
+  int workers = 1;
 #if defined(WIN32)
   std::string mmap_path;
 #endif
@@ -97,6 +100,7 @@ void PrintArgs(const RpcServerArgs& args) {
   LOG(INFO) << "key         = " << args.key;
   LOG(INFO) << "custom_addr = " << args.custom_addr;
   LOG(INFO) << "silent      = " << ((args.silent) ? ("True") : ("False"));
+  LOG(INFO) << "workers     = " << args.workers;
 }
 
 #if defined(__linux__) || defined(__ANDROID__)
@@ -231,6 +235,16 @@ void ParseCmdArgs(int argc, char* argv[], struct RpcServerArgs& args) {
     }
     args.custom_addr = custom_addr;
   }
+
+  const string workers = GetCmdOption(argc, argv, "--workers=");
+  if (!workers.empty()) {
+    if (!IsNumber(workers) || stoi(workers) < 1) {
+      LOG(WARNING) << "Wrong number of workers.";
+      LOG(INFO) << kUsage;
+      exit(1);
+    }
+    args.workers = stoi(workers);
+  }
 #if defined(WIN32)
   const string mmap_path = GetCmdOption(argc, argv, "--child_proc=");
   if (!mmap_path.empty()) {
@@ -274,7 +288,7 @@ int RpcServer(int argc, char* argv[]) {
 #endif
 
   RPCServerCreate(args.host, args.port, args.port_end, args.tracker, args.key, args.custom_addr,
-                  args.silent);
+                  args.silent, args.workers);
   return 0;
 }
 
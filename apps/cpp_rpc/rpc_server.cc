@@ -26,11 +26,14 @@
 #include <sys/select.h>
 #include <sys/wait.h>
 #endif
+#include <algorithm>
 #include <chrono>
 #include <future>
 #include <iostream>
+#include <map>
 #include <set>
 #include <string>
+#include <vector>
 
 #include "../../src/runtime/rpc/rpc_endpoint.h"
 #include "../../src/runtime/rpc/rpc_socket_impl.h"
@@ -38,6 +41,7 @@
 #include "rpc_env.h"
 #include "rpc_server.h"
 #include "rpc_tracker_client.h"
+#include "rpc_worker_pool.h"
 #if defined(_WIN32)
 #include "win32_process.h"
 #endif
@@ -90,6 +94,7 @@ static std::string getNextString(std::stringstream* iss) {
  * \param tracker The address of RPC tracker in host:port format e.g. 10.77.1.234:9190 Default=""
  * \param key The key used to identify the device type in tracker. Default=""
  * \param custom_addr Custom IP Address to Report to RPC Tracker. Default=""
+ * \param num_workers Number of sessions served at the same time by a pool of workers. Default=1
  */
 class RPCServer {
  public:
@@ -97,14 +102,15 @@ class RPCServer {
    * \brief Constructor.
    */
   RPCServer(std::string host, int port, int port_end, std::string tracker_addr, std::string key,
-            std::string custom_addr)
+            std::string custom_addr, int num_workers)
       : host_(std::move(host)),
         port_(port),
         my_port_(0),
         port_end_(port_end),
         tracker_addr_(std::move(tracker_addr)),
         key_(std::move(key)),
-        custom_addr_(std::move(custom_addr)) {}
+        custom_addr_(std::move(custom_addr)),
+        num_workers_(num_workers) {}
 
   /*!
    * \brief Destructor.
@@ -125,8 +131,18 @@ class RPCServer {
     listen_sock_.Create();
     my_port_ = listen_sock_.TryBindHost(host_, port_, port_end_);
     LOG(INFO) << "bind to " << host_ << ":" << my_port_;
-    listen_sock_.Listen(1);
-    std::future<void> proc(std::async(std::launch::async, &RPCServer::ListenLoopProc, this));
+    listen_sock_.Listen(std::max(num_workers_, 1));
+    auto listen_loop = &RPCServer::ListenLoopProc;
+#if defined(__linux__) || defined(__ANDROID__)
+    if (num_workers_ > 1) {
+      listen_loop = &RPCServer::PooledListenLoopProc;
+    }
+#else
+    if (num_workers_ > 1) {
+      LOG(WARNING) << "Worker pool is only supported on Linux, serve one session at a time";
+    }
+#endif
+    std::future<void> proc(std::async(std::launch::async, listen_loop, this));
     proc.get();
     // Close the listen socket
     listen_sock_.Close();
@@ -224,6 +240,111 @@ class RPCServer {
     }
   }
 
+#if defined(__linux__) || defined(__ANDROID__)
+  /*!
+   * \brief PooledListenLoopProc The listen process that serves concurrent sessions on a pool of
+   *        workers. It keeps one match key per idle worker with the tracker, and reports the
+   *        number of busy workers so that the tracker prefers the least loaded server.
+   */
+  void PooledListenLoopProc() {
+    TrackerClient tracker(tracker_addr_, key_, custom_addr_);
+    RPCWorkerPool pool(num_workers_);
+    // Match keys reported to the tracker, with the number of ping periods since the tracker
+    // gave each to a client that has not connected.
+    std::map<std::string, int> matchkeys;
+    const int ping_period = 2;
+    const int unmatch_timeout = 4;
+    const int handshake_timeout = 5;
+    bool load_changed = true;
+    auto last_ping = std::chrono::steady_clock::now();
+    while (true) {
+      try {
+        if (!tracker.IsValid()) {
+          // The tracker drops the keys of a closed connection.
+          matchkeys.clear();
+          tracker.TryConnect();
+          load_changed = true;
+        }
+        if (tracker.IsValid()) {
+          while (static_cast<int>(matchkeys.size()) < pool.NumIdle()) {
+            std::string matchkey;
+            tracker.ReportResourceAndGetKey(my_port_, &matchkey);
+            matchkeys[matchkey] = 0;
+          }
+          if (load_changed) {
+            tracker.ReportLoad(pool.size() - pool.NumIdle(), pool.size());
+            load_changed = false;
+          }
+        } else {
+          matchkeys = {{key_, 0}};
+        }
+
+        support::PollHelper poller;
+        if (pool.NumIdle() != 0) {
+          poller.WatchRead(listen_sock_.sockfd);
+        }
+        pool.WatchRead(&poller);
+        poller.Poll(ping_period * 1000);
+        if (pool.Update(poller)) {
+          load_changed = true;
+        }
+
+        if (poller.CheckRead(listen_sock_.sockfd)) {
+          support::SockAddr addr("0.0.0.0", 0);
+          support::TCPSocket conn = listen_sock_.Accept(&addr);
+          std::vector<std::string> keys;
+          for (const auto& kv : matchkeys) keys.push_back(kv.first);
+          std::string matchkey, opts;
+          bool matched = false;
+          try {
+            // A client that stalls in the handshake must not hold up the other sessions.
+            conn.SetRecvTimeout(handshake_timeout * 1000);
+            matched = Handshake(conn, addr, keys, &matchkey, &opts);
+            if (matched) conn.SetRecvTimeout(0);
+          } catch (const std::exception& e) {
+            // Only this connection failed, the tracker connection is fine.
+            LOG(WARNING) << "Handshake with " << addr.AsString() << " failed: " << e.what();
+            conn.Close();
+          }
+          if (matched) {
+            if (tracker.IsValid()) matchkeys.erase(matchkey);
+            pool.Dispatch(conn, addr.AsString(), GetTimeOutFromOpts(opts));
+            load_changed = true;
+          }
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (tracker.IsValid() && now - last_ping >= std::chrono::seconds(ping_period)) {
+          last_ping = now;
+          std::string pending_keys = tracker.GetPendingMatchKeys();
+          for (auto it = matchkeys.begin(); it != matchkeys.end();) {
+            if (pending_keys.find("\"" + it->first + "\"") == std::string::npos) {
+              it->second += 1;
+            } else {
+              it->second = 0;
+            }
+            // drop the key if it is acquired but not used for a while, a new key replaces it.
+            if (it->second * ping_period > unmatch_timeout + ping_period) {
+              LOG(INFO) << "no incoming connections, regenerate key ...";
+              it = matchkeys.erase(it);
+            } else {
+              ++it;
+            }
+          }
+        }
+      } catch (const char* msg) {
+        LOG(WARNING) << "Socket exception: " << msg;
+        // close tracker resource
+        tracker.Close();
+      } catch (const std::exception& e) {
+        // close tracker resource
+        tracker.Close();
+        LOG(WARNING) << "Exception standard: " << e.what();
+      }
+    }
+  }
+#endif
+
   /*!
    * \brief AcceptConnection Accepts the RPC Server connection.
    * \param tracker Tracker details.
@@ -243,63 +364,82 @@ class RPCServer {
     while (true) {
       tracker->WaitConnectionAndUpdateKey(listen_sock_, my_port_, ping_period, &matchkey);
       support::TCPSocket conn = listen_sock_.Accept(addr);
-
-      int code = kRPCMagic;
-      CHECK_EQ(conn.RecvAll(&code, sizeof(code)), sizeof(code));
-      if (code != kRPCMagic) {
-        conn.Close();
-        LOG(FATAL) << "Client connected is not TVM RPC server";
-        continue;
+      std::string matched;
+      if (Handshake(conn, *addr, {matchkey}, &matched, opts)) {
+        *conn_sock = conn;
+        return;
       }
+    }
+  }
 
-      int keylen = 0;
-      CHECK_EQ(conn.RecvAll(&keylen, sizeof(keylen)), sizeof(keylen));
+  /*!
+   * \brief Handshake Receives the client header of a new connection and checks its match key.
+   * \param conn The new connection, closed if the handshake fails.
+   * \param addr The address of the connection.
+   * \param matchkeys The match keys the server accepts.
+   * \param matchkey The match key of the client.
+   * \param opts Parsed options for socket
+   * \return Whether the client sent one of the match keys.
+   */
+  bool Handshake(support::TCPSocket conn, const support::SockAddr& addr,
+                 const std::vector<std::string>& matchkeys, std::string* matchkey,
+                 std::string* opts) {
+    int code = kRPCMagic;
+    CHECK_EQ(conn.RecvAll(&code, sizeof(code)), sizeof(code));
+    if (code != kRPCMagic) {
+      conn.Close();
+      LOG(WARNING) << "Client connected is not TVM RPC server";
+      return false;
+    }
 
-      const char* CLIENT_HEADER = "client:";
-      const char* SERVER_HEADER = "server:";
-      std::string expect_header = CLIENT_HEADER + matchkey;
-      std::string server_key = SERVER_HEADER + key_;
-      if (size_t(keylen) < expect_header.length()) {
-        conn.Close();
-        LOG(INFO) << "Wrong client header length";
-        continue;
-      }
+    int keylen = 0;
+    CHECK_EQ(conn.RecvAll(&keylen, sizeof(keylen)), sizeof(keylen));
 
-      CHECK_NE(keylen, 0);
-      std::string remote_key;
-      remote_key.resize(keylen);
-      CHECK_EQ(conn.RecvAll(&remote_key[0], keylen), keylen);
+    const char* CLIENT_HEADER = "client:";
+    const char* SERVER_HEADER = "server:";
+    std::string server_key = SERVER_HEADER + key_;
+    if (size_t(keylen) < strlen(CLIENT_HEADER)) {
+      conn.Close();
+      LOG(INFO) << "Wrong client header length";
+      return false;
+    }
+
+    CHECK_NE(keylen, 0);
+    std::string remote_key;
+    remote_key.resize(keylen);
+    CHECK_EQ(conn.RecvAll(&remote_key[0], keylen), keylen);
 
-      std::stringstream ssin(remote_key);
-      std::string arg0;
+    std::stringstream ssin(remote_key);
+    std::string arg0;
 #ifndef __ANDROID__
-      ssin >> arg0;
+    ssin >> arg0;
 #else
-      arg0 = getNextString(&ssin);
+    arg0 = getNextString(&ssin);
 #endif
 
-      if (arg0 != expect_header) {
-        code = kRPCMismatch;
-        CHECK_EQ(conn.SendAll(&code, sizeof(code)), sizeof(code));
-        conn.Close();
-        LOG(WARNING) << "Mismatch key from" << addr->AsString();
-        continue;
-      } else {
-        code = kRPCSuccess;
-        CHECK_EQ(conn.SendAll(&code, sizeof(code)), sizeof(code));
-        keylen = int(server_key.length());
-        CHECK_EQ(conn.SendAll(&keylen, sizeof(keylen)), sizeof(keylen));
-        CHECK_EQ(conn.SendAll(server_key.c_str(), keylen), keylen);
-        LOG(INFO) << "Connection success " << addr->AsString();
+    auto it = std::find_if(
+        matchkeys.begin(), matchkeys.end(),
+        [&arg0, CLIENT_HEADER](const std::string& key) { return arg0 == CLIENT_HEADER + key; });
+    if (it == matchkeys.end()) {
+      code = kRPCMismatch;
+      CHECK_EQ(conn.SendAll(&code, sizeof(code)), sizeof(code));
+      conn.Close();
+      LOG(WARNING) << "Mismatch key from" << addr.AsString();
+      return false;
+    }
+    code = kRPCSuccess;
+    CHECK_EQ(conn.SendAll(&code, sizeof(code)), sizeof(code));
+    keylen = int(server_key.length());
+    CHECK_EQ(conn.SendAll(&keylen, sizeof(keylen)), sizeof(keylen));
+    CHECK_EQ(conn.SendAll(server_key.c_str(), keylen), keylen);
+    LOG(INFO) << "Connection success " << addr.AsString();
 #ifndef __ANDROID__
-        ssin >> *opts;
+    ssin >> *opts;
 #else
-        *opts = getNextString(&ssin);
+    *opts = getNextString(&ssin);
 #endif
-        *conn_sock = conn;
-        return;
-      }
-    }
+    *matchkey = *it;
+    return true;
   }
 
   /*!
@@ -338,6 +478,7 @@ class RPCServer {
   std::string tracker_addr_;
   std::string key_;
   std::string custom_addr_;
+  int num_workers_;
   support::TCPSocket listen_sock_;
   support::TCPSocket tracker_sock_;
 };
@@ -366,22 +507,24 @@ void ServerLoopFromChild(SOCKET socket) {
  * \param tracker_addr The address of RPC tracker in host:port format e.g. 10.77.1.234:9190
  * Default="" \param key The key used to identify the device type in tracker. Default="" \param
  * custom_addr Custom IP Address to Report to RPC Tracker. Default="" \param silent Whether run in
- * silent mode. Default=True
+ * silent mode. Default=True \param num_workers Number of sessions served at the same time.
+ * Default=1
  */
 void RPCServerCreate(std::string host, int port, int port_end, std::string tracker_addr,
-                     std::string key, std::string custom_addr, bool silent) {
+                     std::string key, std::string custom_addr, bool silent, int num_workers) {
   if (silent) {
     // Only errors and fatal is logged
     dmlc::InitLogging("--minloglevel=2");
   }
   // Start the rpc server
   RPCServer rpc(std::move(host), port, port_end, std::move(tracker_addr), std::move(key),
-                std::move(custom_addr));
+                std::move(custom_addr), num_workers);
   rpc.Start();
 }
 
 TVM_REGISTER_GLOBAL("rpc.ServerCreate").set_body([](TVMArgs args, TVMRetValue* rv) {
-  RPCServerCreate(args[0], args[1], args[2], args[3], args[4], args[5], args[6]);
+  int num_workers = args.size() > 7 ? args[7] : 1;
+  RPCServerCreate(args[0], args[1], args[2], args[3], args[4], args[5], args[6], num_workers);
 });
 }  // namespace runtime
 }  // namespace tvm
@@ -49,10 +49,11 @@ void ServerLoopFromChild(SOCKET socket);
  * \param key The key used to identify the device type in tracker. Default=""
  * \param custom_addr Custom IP Address to Report to RPC Tracker. Default=""
  * \param silent Whether run in silent mode. Default=True
+ * \param num_workers Number of sessions served at the same time by a pool of workers. Default=1
  */
 void RPCServerCreate(std::string host = "", int port = 9090, int port_end = 9099,
                      std::string tracker_addr = "", std::string key = "",
-                     std::string custom_addr = "", bool silent = true);
+                     std::string custom_addr = "", bool silent = true, int num_workers = 1);
 }  // namespace runtime
 }  // namespace tvm
 #endif  // TVM_APPS_CPP_RPC_SERVER_H_
@@ -123,6 +123,36 @@ class TrackerClient {
     }
   }
 
+  /*!
+   * \brief ReportLoad Report the load of the server to tracker, which places new sessions on
+   *        the least loaded server of a key.
+   * \param load The number of sessions being served.
+   * \param capacity The number of sessions the server can serve at the same time.
+   */
+  void ReportLoad(int load, int capacity) {
+    if (!tracker_sock_.IsClosed()) {
+      std::ostringstream ss;
+      ss << "[" << static_cast<int>(TrackerCode::kUpdateInfo) << ", {\"load\": " << load
+         << ", \"capacity\": " << capacity << "}]";
+      tracker_sock_.SendBytes(ss.str());
+
+      // Receive status and validate
+      std::string remote_status = tracker_sock_.RecvBytes();
+      CHECK_EQ(std::stoi(remote_status), static_cast<int>(TrackerCode::kSuccess));
+    }
+  }
+
+  /*!
+   * \brief GetPendingMatchKeys Get the match keys that tracker has not given to a client yet.
+   * \return The pending keys in json format.
+   */
+  std::string GetPendingMatchKeys() {
+    std::ostringstream ss;
+    ss << "[" << static_cast<int>(TrackerCode::kGetPendingMatchKeys) << "]";
+    tracker_sock_.SendBytes(ss.str());
+    return tracker_sock_.RecvBytes();
+  }
+
   /*!
    * \brief ReportResourceAndGetKey Report resource to tracker.
    * \param listen_sock Listen socket details for select.
@@ -140,12 +170,7 @@ class TrackerClient {
         poller.WatchRead(listen_sock.sockfd);
         poller.Poll(ping_period * 1000);
         if (!poller.CheckRead(listen_sock.sockfd)) {
-          std::ostringstream ss;
-          ss << "[" << int(TrackerCode::kGetPendingMatchKeys) << "]";
-          tracker_sock_.SendBytes(ss.str());
-
-          // Receive status and validate
-          std::string pending_keys = tracker_sock_.RecvBytes();
+          std::string pending_keys = GetPendingMatchKeys();
           old_keyset_.insert(*matchkey);
 
           // if match key not in pending key set
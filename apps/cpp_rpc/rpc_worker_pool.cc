@@ -0,0 +1,327 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file rpc_worker_pool.cc
+ * \brief A pool of warm worker processes that serve RPC sessions.
+ */
+#include "rpc_worker_pool.h"
+
+#if defined(__linux__) || defined(__ANDROID__)
+#include <dirent.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <tvm/runtime/device_api.h>
+#include <tvm/runtime/registry.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "../../src/runtime/rpc/rpc_socket_impl.h"
+#include "rpc_env.h"
+
+namespace tvm {
+namespace runtime {
+
+namespace {
+/*!
+ * \brief WorkerDir The directory a worker keeps the files of its sessions in.
+ * \param index The index of the worker.
+ */
+std::string WorkerDir(int index) { return "rpc_worker" + std::to_string(index); }
+
+/*!
+ * \brief RemoveWorkerDir Remove the directory of a stopped worker, with what a killed session
+ *        left in it.
+ * \param index The index of the worker.
+ */
+void RemoveWorkerDir(int index) {
+  std::string dir = WorkerDir(index);
+  // The worker keeps the files in the rpc directory of RPCEnv.
+  std::string env_dir = dir + "/rpc";
+  struct stat st;
+  if (stat(env_dir.c_str(), &st) == 0) {
+    CleanDir(env_dir);
+    rmdir(env_dir.c_str());
+  }
+  if (rmdir(dir.c_str()) != 0 && errno != ENOENT) {
+    LOG(WARNING) << "Remove directory " << dir << " failed";
+  }
+}
+
+/*!
+ * \brief LivePools The pools of the server, stopped when it exits without unwinding, e.g. on
+ *        Ctrl+C.
+ */
+std::vector<RPCWorkerPool*>* LivePools() {
+  static auto* pools = new std::vector<RPCWorkerPool*>();
+  return pools;
+}
+
+void StopLivePools() {
+  for (RPCWorkerPool* pool : *LivePools()) {
+    pool->Stop();
+  }
+}
+
+/*!
+ * \brief CloseInheritedFds Close the descriptors a forked worker inherits from the server,
+ *        so the listen and tracker sockets close when the server closes them.
+ * \param keep_fd The descriptor to keep open.
+ */
+void CloseInheritedFds(int keep_fd) {
+  std::vector<int> fds;
+  DIR* dp = opendir("/proc/self/fd");
+  if (dp == nullptr) return;
+  while (dirent* d = readdir(dp)) {
+    int fd = atoi(d->d_name);
+    if (fd > 2 && fd != keep_fd && fd != dirfd(dp)) fds.push_back(fd);
+  }
+  closedir(dp);
+  for (int fd : fds) close(fd);
+}
+
+/*!
+ * \brief WarmUpDevices Initialize the device APIs, so sessions do not pay for it.
+ */
+void WarmUpDevices() {
+  const PackedFunc* get_attr = Registry::Get("runtime.GetDeviceAttr");
+  if (get_attr == nullptr) return;
+  for (int device_type : {kDLGPU, kDLOpenCL, kDLVulkan, kDLMetal, kDLROCM}) {
+    (*get_attr)(device_type, 0, static_cast<int>(kExist));
+  }
+}
+
+/*!
+ * \brief RecvSession Receive the socket of a session from the server.
+ * \param ctrl_fd The control socket.
+ * \param addr The address of the client.
+ * \return The socket, -1 if the server closed the control socket.
+ */
+int RecvSession(int ctrl_fd, std::string* addr) {
+  char buf[256];
+  char cbuf[CMSG_SPACE(sizeof(int))];
+  iovec iov{buf, sizeof(buf)};
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = cbuf;
+  msg.msg_controllen = sizeof(cbuf);
+  ssize_t n;
+  while ((n = recvmsg(ctrl_fd, &msg, 0)) == -1 && errno == EINTR) {
+  }
+  if (n <= 0) return -1;
+  cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  CHECK(cmsg != nullptr && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+      << "Worker expects a socket from the server";
+  int fd;
+  memcpy(&fd, CMSG_DATA(cmsg), sizeof(fd));
+  addr->assign(buf, n);
+  return fd;
+}
+
+/*!
+ * \brief SendSession Pass the socket of a session to a worker.
+ * \param ctrl_fd The control socket.
+ * \param fd The socket of the session.
+ * \param addr The address of the client.
+ * \return Whether the worker got the socket.
+ */
+bool SendSession(int ctrl_fd, int fd, std::string addr) {
+  if (addr.empty()) addr = "unknown";
+  addr = addr.substr(0, 255);
+  char cbuf[CMSG_SPACE(sizeof(int))];
+  memset(cbuf, 0, sizeof(cbuf));
+  iovec iov{&addr[0], addr.length()};
+  msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = cbuf;
+  msg.msg_controllen = sizeof(cbuf);
+  cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &fd, sizeof(fd));
+  ssize_t n;
+  while ((n = sendmsg(ctrl_fd, &msg, MSG_NOSIGNAL)) == -1 && errno == EINTR) {
+  }
+  return n == static_cast<ssize_t>(addr.length());
+}
+}  // namespace
+
+RPCWorkerPool::RPCWorkerPool(int num_workers) : workers_(num_workers) {
+  CHECK_GT(num_workers, 0);
+  static bool stop_at_exit = std::atexit(StopLivePools) == 0;
+  CHECK(stop_at_exit) << "Cannot register the worker cleanup";
+  LivePools()->push_back(this);
+  for (int i = 0; i < num_workers; ++i) {
+    StartWorker(i);
+  }
+}
+
+RPCWorkerPool::~RPCWorkerPool() {
+  Stop();
+  auto* pools = LivePools();
+  pools->erase(std::remove(pools->begin(), pools->end(), this), pools->end());
+}
+
+void RPCWorkerPool::Stop() {
+  std::lock_guard<std::mutex> lock(mu_);
+  // The listen loop may still be running, it must not restart the workers.
+  stopped_ = true;
+  for (int i = 0; i < size(); ++i) {
+    StopWorker(i);
+    RemoveWorkerDir(i);
+  }
+}
+
+int RPCWorkerPool::NumIdle() const {
+  std::lock_guard<std::mutex> lock(mu_);
+  int num_idle = 0;
+  for (const Worker& w : workers_) {
+    if (!w.busy) ++num_idle;
+  }
+  return num_idle;
+}
+
+void RPCWorkerPool::Dispatch(support::TCPSocket conn, const std::string& addr, int timeout) {
+  std::lock_guard<std::mutex> lock(mu_);
+  for (int i = 0; i < size(); ++i) {
+    Worker& w = workers_[i];
+    if (w.busy) continue;
+    if (!SendSession(w.ctrl_fd, conn.sockfd, addr)) {
+      LOG(WARNING) << "Worker pid=" << w.pid << " cannot take a session, restarting it";
+      StopWorker(i);
+      StartWorker(i);
+      continue;
+    }
+    w.busy = true;
+    w.addr = addr;
+    w.has_deadline = timeout != 0;
+    w.deadline = std::chrono::steady_clock::now() + std::chrono::seconds(timeout);
+    LOG(INFO) << "Worker pid=" << w.pid << " serves " << addr;
+    break;
+  }
+  // The worker holds its own copy of the socket.
+  conn.Close();
+}
+
+void RPCWorkerPool::WatchRead(support::PollHelper* poller) const {
+  std::lock_guard<std::mutex> lock(mu_);
+  for (const Worker& w : workers_) {
+    poller->WatchRead(w.ctrl_fd);
+  }
+}
+
+bool RPCWorkerPool::Update(const support::PollHelper& poller) {
+  std::lock_guard<std::mutex> lock(mu_);
+  bool any_idle = false;
+  auto now = std::chrono::steady_clock::now();
+  for (int i = 0; i < size(); ++i) {
+    Worker& w = workers_[i];
+    if (poller.CheckRead(w.ctrl_fd)) {
+      char done;
+      if (read(w.ctrl_fd, &done, 1) == 1) {
+        LOG(INFO) << "Worker pid=" << w.pid << " finished serving " << w.addr;
+        w.busy = false;
+      } else {
+        LOG(WARNING) << "Worker pid=" << w.pid << " exited, restarting it";
+        StopWorker(i);
+        StartWorker(i);
+      }
+      any_idle = true;
+    } else if (w.busy && w.has_deadline && now >= w.deadline) {
+      LOG(INFO) << "Worker pid=" << w.pid << " killed for session timeout, restarting it";
+      StopWorker(i);
+      StartWorker(i);
+      any_idle = true;
+    }
+  }
+  return any_idle;
+}
+
+void RPCWorkerPool::StartWorker(int index) {
+  if (stopped_) return;
+  int fds[2];
+  CHECK_EQ(socketpair(AF_UNIX, SOCK_SEQPACKET, 0, fds), 0)
+      << "Cannot create worker socket: " << strerror(errno);
+  pid_t pid = fork();
+  CHECK_GE(pid, 0) << "Cannot fork worker: " << strerror(errno);
+  if (pid == 0) {
+    // The server stops the workers and cleans up after them.
+    signal(SIGINT, SIG_DFL);
+    LivePools()->clear();
+    CloseInheritedFds(fds[1]);
+    try {
+      WorkerLoop(fds[1], index);
+    } catch (const std::exception& e) {
+      // The server starts a new worker.
+      LOG(WARNING) << "Worker exits: " << e.what();
+    }
+    // Skip the exit handlers and static destructors of the server state the fork copied.
+    _exit(0);
+  }
+  close(fds[1]);
+  Worker& w = workers_[index];
+  w = Worker();
+  w.pid = pid;
+  w.ctrl_fd = fds[0];
+}
+
+void RPCWorkerPool::StopWorker(int index) {
+  Worker& w = workers_[index];
+  if (w.pid <= 0) return;
+  kill(w.pid, SIGKILL);
+  while (waitpid(w.pid, nullptr, 0) == -1 && errno == EINTR) {
+  }
+  close(w.ctrl_fd);
+  w = Worker();
+}
+
+void RPCWorkerPool::WorkerLoop(int ctrl_fd, int index) {
+  // Workers serve concurrently, each keeps the files of its sessions in its own directory.
+  std::string dir = WorkerDir(index);
+  mkdir(dir.c_str(), 0777);
+  CHECK_EQ(chdir(dir.c_str()), 0) << "Cannot enter " << dir << ": " << strerror(errno);
+  // Remove what a killed session left behind.
+  RPCEnv().CleanUp();
+  WarmUpDevices();
+
+  std::string addr;
+  int fd;
+  while ((fd = RecvSession(ctrl_fd, &addr)) >= 0) {
+    const auto env = RPCEnv();
+    RPCServerLoop(fd);
+    LOG(INFO) << "Finish serving " << addr;
+    env.CleanUp();
+    char done = 1;
+    if (write(ctrl_fd, &done, 1) != 1) break;
+  }
+}
+
+}  // namespace runtime
+}  // namespace tvm
+#endif  // defined(__linux__) || defined(__ANDROID__)
@@ -0,0 +1,132 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file rpc_worker_pool.h
+ * \brief A pool of warm worker processes that serve RPC sessions.
+ */
+#ifndef TVM_APPS_CPP_RPC_WORKER_POOL_H_
+#define TVM_APPS_CPP_RPC_WORKER_POOL_H_
+
+#if defined(__linux__) || defined(__ANDROID__)
+#include <sys/types.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../../src/support/socket.h"
+
+namespace tvm {
+namespace runtime {
+
+/*!
+ * \brief RPCWorkerPool A pool of worker processes that serve RPC sessions.
+ *
+ *  The workers start ahead of the sessions and initialize the devices once. The server passes
+ *  the socket of each accepted session to an idle worker, which serves it and reports back
+ *  when the session ends. A worker that exits or runs over the session timeout is replaced.
+ */
+class RPCWorkerPool {
+ public:
+  /*!
+   * \brief Constructor, starts the workers.
+   * \param num_workers The number of workers, which is the number of concurrent sessions.
+   */
+  explicit RPCWorkerPool(int num_workers);
+  /*!
+   * \brief Destructor, stops the workers.
+   */
+  ~RPCWorkerPool();
+  /*!
+   * \brief Stop Stop the workers for good and remove their directories. The server does this
+   *        when it exits.
+   */
+  void Stop();
+  /*!
+   * \return The number of workers.
+   */
+  int size() const { return static_cast<int>(workers_.size()); }
+  /*!
+   * \return The number of workers without a session.
+   */
+  int NumIdle() const;
+  /*!
+   * \brief Dispatch Serve a session on an idle worker.
+   * \param conn The connection of the session, closed on this side afterwards.
+   * \param addr The address of the client.
+   * \param timeout The session timeout in seconds, 0 for no timeout.
+   */
+  void Dispatch(support::TCPSocket conn, const std::string& addr, int timeout);
+  /*!
+   * \brief WatchRead Watch the workers for finished sessions.
+   * \param poller The poller to add the workers to.
+   */
+  void WatchRead(support::PollHelper* poller) const;
+  /*!
+   * \brief Update Handle the finished sessions, timeouts and exited workers.
+   * \param poller The poller after a poll that watched the workers.
+   * \return Whether any worker became idle.
+   */
+  bool Update(const support::PollHelper& poller);
+
+ private:
+  /*! \brief A worker process. */
+  struct Worker {
+    /*! \brief The process id. */
+    pid_t pid{-1};
+    /*! \brief The socket to pass sessions to the worker and get notified when they end. */
+    int ctrl_fd{-1};
+    /*! \brief Whether the worker is serving a session. */
+    bool busy{false};
+    /*! \brief The address of the client being served. */
+    std::string addr;
+    /*! \brief When the session times out, if it has a timeout. */
+    std::chrono::steady_clock::time_point deadline;
+    bool has_deadline{false};
+  };
+  /*!
+   * \brief Start the worker process of a slot.
+   * \param index The index of the worker.
+   */
+  void StartWorker(int index);
+  /*!
+   * \brief Stop the worker process of a slot.
+   * \param index The index of the worker.
+   */
+  void StopWorker(int index);
+  /*!
+   * \brief The loop of a worker process.
+   * \param ctrl_fd The control socket of the worker.
+   * \param index The index of the worker.
+   */
+  static void WorkerLoop(int ctrl_fd, int index);
+
+  std::vector<Worker> workers_;
+  /*! \brief Guards the workers against Stop at exit, which runs on another thread. */
+  mutable std::mutex mu_;
+  /*! \brief Whether the pool is stopped, no worker is started anymore. */
+  bool stopped_{false};
+};
+
+}  // namespace runtime
+}  // namespace tvm
+#endif  // defined(__linux__) || defined(__ANDROID__)
+#endif  // TVM_APPS_CPP_RPC_WORKER_POOL_H_
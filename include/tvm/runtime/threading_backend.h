@@ -24,6 +24,7 @@
 #ifndef TVM_RUNTIME_THREADING_BACKEND_H_
 #define TVM_RUNTIME_THREADING_BACKEND_H_
 
+#include <cstddef>
 #include <functional>
 #include <memory>
 #include <vector>
@@ -80,6 +81,32 @@ class ThreadGroup {
    */
   int Configure(AffinityMode mode, int nthreads, bool exclude_worker0);
 
+  /*!
+   * \brief configure the CPU id affinity to the cores of one NUMA node
+   *
+   * \param numa_node The NUMA node to pin the workers to.
+   * \param nthreads The number of threads to use (0 = one per physical core of the node).
+   * \param exclude_worker0 Whether to use the main thread as a worker.
+   *        If `true`, the main thread is allowed to run on any core of the node.
+   *
+   * \return The number of workers to use.
+   * \note The big cores are used when the cores of the node cannot be found.
+   */
+  int ConfigureNumaNode(int numa_node, int nthreads, bool exclude_worker0);
+
+  /*!
+   * \brief configure the CPU id affinity to one of several disjoint slices of the big cores
+   *
+   * \param slice The index of the slice to pin the workers to.
+   * \param num_slices The number of slices the big cores are split into.
+   * \param exclude_worker0 Whether to use the main thread as a worker.
+   *        If `true`, the main thread is allowed to run on any core of the slice.
+   *
+   * \return The number of workers to use, which is the number of cores of the slice.
+   * \note Slices share cores round robin when there are more slices than cores.
+   */
+  int ConfigureCoreSlice(int slice, int num_slices, bool exclude_worker0);
+
  private:
   Impl* impl_;
 };
@@ -94,6 +121,54 @@ void Yield();
  */
 int MaxConcurrency();
 
+/*!
+ * \return the number of NUMA nodes of this system, 1 if unknown.
+ */
+int NumNumaNodes();
+
+/*!
+ * \brief Set the NUMA node the calling thread prefers to allocate memory from.
+ * \param numa_node The NUMA node, -1 means no preference.
+ */
+void SetPreferredNumaNode(int numa_node);
+
+/*!
+ * \return the NUMA node the calling thread prefers to allocate memory from, -1 if none.
+ */
+int PreferredNumaNode();
+
+/*!
+ * \brief Ask the OS to place the pages of a not yet touched memory range on a NUMA node.
+ *  This is a no-op on systems without NUMA support.
+ * \param ptr The start of the range, must be aligned to the page size.
+ * \param nbytes The size of the range.
+ * \param numa_node The NUMA node.
+ * \return Whether the placement policy is applied.
+ */
+bool BindMemoryToNumaNode(void* ptr, size_t nbytes, int numa_node);
+
+/*!
+ * \brief Limit the number of tasks of the parallel launches from the calling
+ *  thread that leave the task count to the runtime.
+ * \param max_tasks The limit, 0 means no limit.
+ */
+void SetMaxParallelTasks(int max_tasks);
+
+/*!
+ * \return the task limit of the calling thread, 0 if none.
+ */
+int MaxParallelTasks();
+
+/*!
+ * \brief Pin the thread pool of the calling thread, and the thread itself, to one of
+ *  num_slices disjoint slices of the big cores, so that threads launching at the same
+ *  time run on different cores. This is a no-op while the shared thread pool is used.
+ * \param slice The index of the slice.
+ * \param num_slices The number of slices.
+ * \return The number of workers the launches from the calling thread use.
+ */
+int ConfigureThreadPoolCoreSlice(int slice, int num_slices);
+
 }  // namespace threading
 }  // namespace runtime
 }  // namespace tvm
@@ -81,6 +81,29 @@ class Executable : public ModuleNode {
    */
   static runtime::Module Load(const std::string& code, const runtime::Module lib);
 
+  /*!
+   * \brief Save the executable to a file that can be memory mapped.
+   *
+   *  The file is a parameter file holding the serialized executable, without its
+   *  constants, followed by the constants at aligned offsets.
+   *
+   * \param path The file path.
+   */
+  void SaveToMappableFile(const std::string& path);
+
+  /*!
+   * \brief Load an executable saved by SaveToMappableFile. The constants are
+   *  views over a private mapping of the file, so loading does not read them and
+   *  processes loading the same file share their pages.
+   *
+   * \param path The file path.
+   * \param lib The compiled runtime library.
+   *
+   * \return exe The constructed executable.
+   */
+  static runtime::Module LoadFromMappableFile(const std::string& path,
+                                              const runtime::Module lib);
+
   /*!
    * \brief Get the serialized form of the `functions`. This is
    * essentially bytecode serialization.
@@ -144,6 +167,31 @@ class Executable : public ModuleNode {
    */
   std::string GetFunctionParameterName(std::string func, uint32_t index) const;
 
+  /*!
+   * \brief Move the large constants to a parameter file. The saved executable
+   *  then leaves them out and they have to be loaded with
+   *  LoadLateBoundConstantsFromFile before running it. Constants that are
+   *  already late bound are written to the new file too, so they must be loaded.
+   * \param path The path of the parameter file.
+   * \param byte_limit Constants of at least this many bytes are moved.
+   */
+  void MoveLateBoundConstantsToFile(const std::string& path, size_t byte_limit);
+
+  /*!
+   * \brief Load the late bound constants from a parameter file. The constants
+   *  are views over a mapping of the file, whose pages are only read when the
+   *  constants are first used.
+   * \param path The path of the parameter file.
+   */
+  void LoadLateBoundConstantsFromFile(const std::string& path);
+
+  /*!
+   * \brief Get the name of a constant, as in the late bound constant file.
+   * \param index The constant index.
+   * \return The name.
+   */
+  std::string GetConstantName(Index index) const;
+
   virtual ~Executable() {}
 
   const char* type_key() const final { return "VMExecutable"; }
@@ -151,8 +199,13 @@ class Executable : public ModuleNode {
   /*! \brief The runtime module/library that contains both the host and also the device
    * code when executing on non-CPU devices. */
   runtime::Module lib;
-  /*! \brief The global constant pool. */
+  /*! \brief The global constant pool, late bound constants are undefined until loaded. */
   std::vector<ObjectRef> constants;
+  /*!
+   * \brief The names of the late bound constants in their file, empty for the
+   *  constants that are part of the executable.
+   */
+  std::vector<std::string> late_bound_constant_names;
   /*! \brief A map from globals (as strings) to their index in the function map. */
   std::unordered_map<std::string, Index> global_map;
   /*! \brief A mapping from the packed function (as string) to the index that
@@ -67,6 +67,8 @@ struct Buffer {
 enum AllocatorType {
   kNaive = 1,
   kPooled,
+  kBestFit,
+  kArena,
 };
 
 class Allocator {
@@ -97,6 +99,10 @@ class Allocator {
    *  \return The amount of memory currently allocated.
    */
   virtual size_t UsedMemory() const = 0;
+  /*! \brief Notify the allocator that a VM invocation using it has finished.
+   *  Allocators that recycle memory per invocation reset their state here.
+   */
+  virtual void EndInvocation() {}
 
  private:
   AllocatorType type_;
@@ -106,25 +112,34 @@ class MemoryManager {
  public:
   static MemoryManager* Global();
   /*!
-   * \brief Get or create an allocator given the context and allocator type.
+   * \brief Create an allocator that is not shared with anyone else.
+   * \param ctx The TVM context
+   * \param type The allocator type
+   * \return The memory allocator.
+   */
+  static std::shared_ptr<Allocator> CreateAllocator(TVMContext ctx, AllocatorType type);
+  /*!
+   * \brief Get or create the allocator of a type that is shared on a context.
    * \param ctx The TVM context
    * \param type The allocator type
    * \return The memory allocator.
    */
-  static Allocator* GetOrCreateAllocator(TVMContext ctx, AllocatorType type);
+  static std::shared_ptr<Allocator> GetOrCreateAllocator(TVMContext ctx, AllocatorType type);
   /*!
-   * \brief Get an allocator given the context.
+   * \brief Get the shared allocator of a type on a context.
    * \param ctx The TVM context
+   * \param type The allocator type
    * \return The memory allocator.
    */
-  static Allocator* GetAllocator(TVMContext ctx);
+  static Allocator* GetAllocator(TVMContext ctx, AllocatorType type);
 
  private:
   MemoryManager() {}
 
  private:
   std::mutex mu_;
-  std::unordered_map<TVMContext, std::unique_ptr<Allocator>> allocators_;
+  /*! \brief The shared allocators, by context and then by allocator type. */
+  std::unordered_map<TVMContext, std::unordered_map<int, std::shared_ptr<Allocator>>> allocators_;
 };
 
 /*! \brief An object representing a storage allocation. */
@@ -132,6 +147,8 @@ class StorageObj : public Object {
  public:
   /*! \brief The index into the VM function table. */
   Buffer buffer;
+  /*! \brief The allocator the buffer is returned to. */
+  std::shared_ptr<Allocator> allocator;
 
   /*! \brief Allocate an NDArray from a given piece of storage. */
   NDArray AllocNDArray(size_t offset, std::vector<int64_t> shape, DLDataType dtype);
@@ -139,10 +156,7 @@ class StorageObj : public Object {
   /*! \brief The deleter for an NDArray when allocated from underlying storage. */
   static void Deleter(Object* ptr);
 
-  ~StorageObj() {
-    auto alloc = MemoryManager::Global()->GetAllocator(buffer.ctx);
-    alloc->Free(buffer);
-  }
+  ~StorageObj() { allocator->Free(buffer); }
 
   static constexpr const uint32_t _type_index = TypeIndex::kDynamic;
   static constexpr const char* _type_key = "vm.Storage";
@@ -34,6 +34,7 @@
 #include <tvm/runtime/vm/memory_manager.h>
 
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -96,6 +97,16 @@ struct VMFunction {
   friend std::ostream& operator<<(std::ostream& os, const VMFunction&);
 };
 
+/*!
+ * \brief The constants copied to the device, shared by a virtual machine and its forks.
+ */
+struct VMConstantPool {
+  /*! \brief Guards the constants. */
+  std::mutex mu;
+  /*! \brief The device copies, undefined until first loaded. */
+  std::vector<ObjectRef> constants;
+};
+
 /*!
  * \brief A representation of a stack frame.
  *
@@ -172,6 +183,42 @@ class VirtualMachine : public runtime::ModuleNode {
    */
   virtual void LoadExecutable(const Executable* exec);
 
+  /*!
+   * \brief Create a virtual machine that shares the executable, packed functions, contexts
+   *  and device constants of this one, but has its own execution state.
+   *
+   *  A virtual machine runs one invocation at a time; forks of it can run concurrently on
+   *  different threads.
+   *
+   * \return The new virtual machine.
+   */
+  ObjectPtr<VirtualMachine> Fork() const;
+
+  /*!
+   * \brief Start an asynchronous invocation, which runs as Resume is called.
+   * \param func The function.
+   * \param args The arguments to the function.
+   */
+  void InvokeAsync(const VMFunction& func, const std::vector<ObjectRef>& args);
+
+  /*!
+   * \brief Run the asynchronous invocation until the next packed function call is
+   *  issued or the invocation returns.
+   *
+   *  Kernels on devices run asynchronously to the host, so the host thread can
+   *  resume other invocations while the kernel issued last runs.
+   *
+   * \param result The result, set when the invocation returned.
+   * \return Whether the invocation returned.
+   */
+  bool Resume(ObjectRef* result);
+
+  /*!
+   * \brief Abandon the asynchronous invocation in progress, if any, so that the
+   *  VM can be invoked again.
+   */
+  void CancelAsync();
+
  protected:
   /*! \brief Push a call frame on to the call stack. */
   void PushFrame(Index arg_count, Index ret_pc, const VMFunction& vm_func);
@@ -182,6 +229,9 @@ class VirtualMachine : public runtime::ModuleNode {
    */
   Index PopFrame();
 
+  /*! \brief Notify the allocators that the current invocation has finished. */
+  void EndInvocation();
+
   /*!
    * \brief Write to a VM register.
    * \param reg The register to write to.
@@ -194,7 +244,7 @@ class VirtualMachine : public runtime::ModuleNode {
    * \param reg The register to read from.
    * \return The read object.
    */
-  inline ObjectRef ReadRegister(RegName reg) const;
+  inline const ObjectRef& ReadRegister(RegName reg) const;
 
   /*!
    * \brief Read a VM register and cast it to int32_t
@@ -203,6 +253,14 @@ class VirtualMachine : public runtime::ModuleNode {
    */
   inline int64_t LoadScalarInt(RegName reg) const;
 
+  /*!
+   * \brief Get the device copy of a constant from the pool shared with forks, copying it to the
+   *  device on first use.
+   * \param const_index The index of the constant.
+   * \return The device copy.
+   */
+  ObjectRef LoadSharedConstant(Index const_index);
+
   /*!
    * \brief Invoke a VM function.
    * \param func The function.
@@ -234,6 +292,28 @@ class VirtualMachine : public runtime::ModuleNode {
   virtual void InvokePacked(Index packed_index, const PackedFunc& func, Index arg_count,
                             Index output_size, const std::vector<ObjectRef>& args);
 
+  /*!
+   * \brief Invoke a shape function, reusing the outputs of an earlier call with the same inputs.
+   *
+   * \param packed_index The offset of the shape function in all functions.
+   * \param func The shape function to be invoked.
+   * \param arg_count The number of arguments to the shape function.
+   * \param output_size The number of outputs of the shape function.
+   * \param args Arguments to the shape function.
+   */
+  void InvokeShapeFunc(Index packed_index, const PackedFunc& func, Index arg_count,
+                       Index output_size, const std::vector<ObjectRef>& args);
+
+  /*!
+   * \brief Allocate the storage of an AllocStorage instruction, reusing the storage the same
+   *  instruction allocated last time when nothing else refers to it any more.
+   *
+   * \param instr The AllocStorage instruction.
+   * \param size The number of bytes to allocate.
+   * \return The storage.
+   */
+  Storage AllocStorage(const Instruction& instr, int64_t size);
+
   /*!
    * \brief Initialize the virtual machine for a set of contexts.
    * \param contexts The set of TVM contexts.
@@ -244,6 +324,44 @@ class VirtualMachine : public runtime::ModuleNode {
   /*! \brief Run VM dispatch loop. */
   void RunLoop();
 
+  /*!
+   * \brief Run VM dispatch loop from the current pc.
+   * \param frame_start The number of frames when the invoked function was entered.
+   * \param suspend_after_packed Whether to return after each packed function call.
+   * \return Whether the invoked function returned, rather than being suspended.
+   */
+  bool RunLoop(Index frame_start, bool suspend_after_packed);
+
+  /*!
+   * \brief The dispatch loop of RunLoop.
+   * \tparam kProfile Whether to call OnInstruction before each instruction. The loop without
+   *  it has no profiling overhead.
+   */
+  template <bool kProfile>
+  bool RunLoopImpl(Index frame_start, bool suspend_after_packed);
+
+  /*!
+   * \brief Called before each instruction when profile_instructions_ is set, the previous
+   *  instruction has completed by then.
+   * \param instr The instruction about to be executed in the function func_index_.
+   */
+  virtual void OnInstruction(const Instruction& instr) {}
+
+  /*!
+   * \brief Called when a dispatch loop with profile_instructions_ set exits.
+   * \param returned Whether the invoked function returned, rather than being suspended or
+   *  throwing.
+   */
+  virtual void OnRunLoopExit(bool returned) {}
+
+  /*!
+   * \brief Get a function of the executable and the inputs set for it.
+   * \param name The function's name.
+   * \param args The inputs.
+   * \return The function.
+   */
+  const VMFunction& GetFunctionInputs(const std::string& name, std::vector<ObjectRef>* args) const;
+
   /*! \brief Get device context for params. */
   TVMContext GetParamsContext() const;
 
@@ -274,12 +392,50 @@ class VirtualMachine : public runtime::ModuleNode {
   /*! \brief The set of TVM contexts the VM is currently executing on. */
   std::vector<TVMContext> ctxs_;
   /*! \brief The mapping from TVM context to memory allocator. */
-  std::unordered_map<TVMContext, Allocator*> allocators_;
+  std::unordered_map<TVMContext, std::shared_ptr<Allocator>> allocators_;
   /*!
    * \brief The constant pool for runtime. It caches the device dependent
    * object to avoid rellocation of constants during inference.
    */
   std::vector<ObjectRef> const_pool_;
+  /*! \brief The device constants shared with forks, backing const_pool_. */
+  std::shared_ptr<VMConstantPool> shared_const_pool_;
+  /*! \brief Whether the dispatch loop reports every instruction to OnInstruction. */
+  bool profile_instructions_{false};
+  /*! \brief Whether an asynchronous invocation is in progress. */
+  bool async_running_{false};
+  /*! \brief The number of frames when the asynchronous invocation was entered. */
+  Index async_frame_start_{0};
+  /*! \brief Argument buffer reused by InvokePacked and AllocADT instructions. */
+  std::vector<ObjectRef> arg_buffer_;
+  /*! \brief Register files of returned frames, reused by later calls. */
+  std::vector<std::vector<ObjectRef>> free_register_files_;
+  /*! \brief Whether each packed function is a shape function. */
+  std::vector<bool> is_shape_func_;
+  /*!
+   * \brief The outputs of each shape function, keyed by the shapes and contents of its inputs.
+   */
+  std::vector<std::unordered_map<std::string, std::vector<std::string>>> shape_cache_;
+  /*! \brief The number of input signatures cached per shape function, zero disables it. */
+  size_t shape_cache_capacity_{64};
+  /*! \brief Storage kept by an AllocStorage instruction for the next run. */
+  struct CachedStorage {
+    Storage storage;
+    /*! \brief The size the instruction requested. */
+    int64_t size;
+  };
+  /*! \brief The storage last allocated by each AllocStorage instruction. */
+  std::unordered_map<const Instruction*, CachedStorage> storage_cache_;
+  /*!
+   * \brief The number of bytes storage_cache_ may keep from the allocator. Zero, the
+   *  default, disables storage reuse.
+   */
+  size_t storage_cache_limit_{0};
+  /*! \brief The number of bytes storage_cache_ keeps. */
+  size_t storage_cache_bytes_{0};
+  /*! \brief Shape cache and storage reuse counters. */
+  int64_t shape_cache_hits_{0}, shape_cache_misses_{0};
+  int64_t storage_reuses_{0}, storage_allocs_{0};
 };
 
 }  // namespace vm
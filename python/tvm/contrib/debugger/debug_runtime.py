@@ -241,6 +241,48 @@ class GraphModuleDebug(graph_runtime.GraphModule):
         ret = self._run_individual(number, repeat, min_repeat_ms)
         return ret.strip(",").split(",") if ret else []
 
+    def enable_perf_counters(self, enable=True):
+        """Count hardware events of each operator in run_individual.
+
+        Parameters
+        ----------
+        enable : bool, optional
+            Whether to count them.
+
+        Returns
+        -------
+        enabled : bool
+            Whether the counters could be opened, perf_event_open is only
+            available on Linux when perf_event_paranoid allows it.
+        """
+        return bool(self.module["enable_perf_counters"](enable))
+
+    def set_op_flops(self, op_flops):
+        """Set the floating point operations of operators for the bytes per FLOP ratio.
+
+        Parameters
+        ----------
+        op_flops : dict of str to int
+            The floating point operations of one call, keyed by node or function
+            name, e.g. from autotvm.task.task.compute_flop.
+        """
+        args = []
+        for name, flops in op_flops.items():
+            args += [name, float(flops)]
+        self.module["set_op_flops"](*args)
+
+    def get_perf_counters(self):
+        """Get the hardware event counts per call of each operator in the last
+        iteration of run_individual, with the instructions per cycle and the
+        bytes of the arguments per floating point operation.
+
+        Returns
+        -------
+        report : str
+            The table of counts.
+        """
+        return self.module["get_perf_counters"]()
+
     def exit(self):
         """Exits the dump folder and all its contents"""
         self._remove_dump_root()
@@ -60,6 +60,46 @@ def create(graph_json_str, libmod, ctx):
     return GraphModule(fcreate(graph_json_str, libmod, *device_type_id))
 
 
+def create_pipeline(graph_json_str, libmod, ctx, num_contexts=2, threads_per_request=0):
+    """Create a runtime that serves concurrent requests of a graph.
+
+    Parameters
+    ----------
+    graph_json_str : str
+        The graph to be deployed in json format output by json graph.
+
+    libmod : tvm.runtime.Module
+        The module of the corresponding function
+
+    ctx : TVMContext or list of TVMContext
+        The context to deploy the module, see :py:func:`create`.
+
+    num_contexts : int, optional
+        The number of requests that can be in flight. Each of them has its own
+        activations, the parameters are shared.
+
+    threads_per_request : int, optional
+        The number of tasks each operator of a request may parallelize over,
+        0 divides the cores among the contexts.
+
+    Returns
+    -------
+    pipeline : GraphPipeline
+        Runtime that accepts requests with submit.
+    """
+    assert isinstance(graph_json_str, string_types)
+
+    ctx, num_rpc_ctx, device_type_id = get_device_ctx(libmod, ctx)
+
+    if num_rpc_ctx == len(ctx):
+        fcreate = ctx[0]._rpc_sess.get_function("tvm.graph_runtime.create_pipeline")
+    else:
+        fcreate = tvm._ffi.get_global_func("tvm.graph_runtime.create_pipeline")
+
+    return GraphPipeline(fcreate(graph_json_str, libmod, num_contexts, threads_per_request,
+                                 *device_type_id))
+
+
 def get_device_ctx(libmod, ctx):
     """Parse and validate all the device context(s).
 
@@ -181,6 +221,78 @@ class GraphModule(object):
             self.set_input(**input_dict)
         self._run()
 
+    def freeze(self, small_op_bytes=0):
+        """Freeze the operator sequence to cut the per operator dispatch cost.
+
+        Run then calls the compiled functions directly with pre-packed
+        arguments. Inputs set with set_input_zero_copy are still picked up.
+
+        Parameters
+        ----------
+        small_op_bytes : int, optional
+            Operators whose arguments total at most this many bytes run on the
+            calling thread only, instead of paying a thread pool launch each.
+            0 disables it.
+        """
+        self.module["freeze"](small_op_bytes)
+
+    def set_trace_config(self, sample_rate, capacity=65536):
+        """Trace the operators of a sample of the runs.
+
+        Parameters
+        ----------
+        sample_rate : float
+            The fraction of runs to trace, rounded to one in N runs. 0 disables
+            tracing.
+
+        capacity : int, optional
+            The number of operator events kept, older ones are overwritten.
+
+        Note
+        ----
+        Operators on devices are asynchronous, their events only cover the launch.
+        """
+        self.module["set_trace_config"](sample_rate, capacity)
+
+    def get_trace(self, fmt="chrome", reset=False):
+        """Get the collected trace.
+
+        Parameters
+        ----------
+        fmt : str, optional
+            "chrome" for Chrome trace event JSON that chrome://tracing and
+            Perfetto load, "histogram" for the per node duration histograms
+            with log2 nanosecond buckets.
+
+        reset : bool, optional
+            Whether to drop the collected events afterwards.
+
+        Returns
+        -------
+        trace : str
+            The trace as JSON.
+        """
+        return self.module["get_trace"](fmt, reset)
+
+    def set_inter_op_parallelism(self, num_streams, threads_per_op=0):
+        """Run independent operators of the graph concurrently.
+
+        Compile the graph with the "relay.backend.parallel_memory_plan" pass
+        config so that operators that may run at the same time do not share
+        storage. Other graphs still run correctly, with less concurrency.
+
+        Parameters
+        ----------
+        num_streams : int
+            The number of operators that may run at the same time,
+            1 restores sequential execution.
+
+        threads_per_op : int, optional
+            The number of tasks each operator may parallelize over,
+            0 splits the cores evenly among the streams.
+        """
+        self.module["set_inter_op_parallelism"](num_streams, threads_per_op)
+
     def get_num_outputs(self):
         """Get the number of outputs from the graph
 
@@ -259,6 +371,33 @@ class GraphModule(object):
         """
         self._load_params(bytearray(params_bytes))
 
+    def load_params_file(self, path, lazy=False):
+        """Load parameters from a parameter file saved by relay.save_param_file.
+
+        Parameters on the CPU use the memory mapped file directly instead of
+        being copied into the runtime.
+
+        Parameters
+        ----------
+        path : str
+            The path of the parameter file.
+
+        lazy : bool, optional
+            Whether to copy parameters on other devices only when an operator
+            first reads them, and to record which parameters are read.
+        """
+        self.module["load_params_file"](path, lazy)
+
+    def get_param_usage(self):
+        """Get which of the lazily loaded parameters were read.
+
+        Returns
+        -------
+        usage : str
+            The parameter names and sizes as JSON.
+        """
+        return self.module["get_param_usage"]()
+
     def share_params(self, other, params_bytes):
         """Share parameters from pre-existing GraphRuntime instance.
 
@@ -281,3 +420,91 @@ class GraphModule(object):
             The key to the module.
         """
         return self.module[key]
+
+
+class GraphPipelineRequest(object):
+    """A request submitted to a GraphPipeline."""
+
+    def __init__(self, pipeline, ticket):
+        self._pipeline = pipeline
+        self._ticket = ticket
+        self._outputs = None
+
+    def result(self):
+        """Wait for the request to finish.
+
+        Returns
+        -------
+        outputs : list of NDArray
+            The outputs of the graph.
+        """
+        if self._outputs is None:
+            self._outputs = list(self._pipeline._wait(self._ticket))
+        return self._outputs
+
+
+class GraphPipeline(object):
+    """Runs requests of a graph on several execution contexts.
+
+    Requests are queued by submit and picked up by the next free context, so
+    the input copy of one request overlaps with the compute of others.
+
+    Parameters
+    ----------
+    module : tvm.runtime.Module
+        The internal tvm module that holds the pipeline.
+    """
+
+    def __init__(self, module):
+        self.module = module
+        self._submit = module["submit"]
+        self._wait = module["wait"]
+        self._load_params = module["load_params"]
+        self._get_num_contexts = module["get_num_contexts"]
+
+    def load_params(self, params_bytes):
+        """Load parameters shared by all contexts.
+
+        Parameters
+        ----------
+        params_bytes : bytearray
+            The serialized parameter dict.
+        """
+        self._load_params(bytearray(params_bytes))
+
+    def get_num_contexts(self):
+        """Get the number of requests that can be in flight."""
+        return self._get_num_contexts()
+
+    def submit(self, *args, **inputs):
+        """Queue a request.
+
+        Parameters
+        ----------
+        args : list of NDArray or numpy.ndarray
+            The inputs in the order of the graph inputs.
+
+        inputs : dict of str to NDArray or numpy.ndarray
+            The inputs by name, cannot be combined with args.
+
+        Returns
+        -------
+        request : GraphPipelineRequest
+            The request, whose result() returns the outputs.
+        """
+        def to_ndarray(value):
+            if isinstance(value, tvm.runtime.NDArray):
+                return value
+            return tvm.nd.array(value)
+
+        if args and inputs:
+            raise ValueError("Pass the inputs either by position or by name")
+        if inputs:
+            flat = []
+            for key, value in inputs.items():
+                flat.append(key)
+                flat.append(to_ndarray(value))
+            ticket = self._submit(*flat)
+        else:
+            ticket = self._submit(*[to_ndarray(value) for value in args])
+        return GraphPipelineRequest(self, ticket)
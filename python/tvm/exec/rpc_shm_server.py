@@ -0,0 +1,49 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+# pylint: disable=redefined-outer-name, invalid-name
+"""Serve a shared memory RPC session, started by tvm.rpc.ShmSession.
+
+The last three command line arguments are the shared memory file descriptor,
+the eventfd the server waits on and the eventfd the client waits on.
+"""
+import argparse
+import sys
+from tvm.rpc import _ffi_api
+from tvm.rpc import server
+
+
+def main(args):
+    """Main function
+
+    Parameters
+    ----------
+    args : argparse.Namespace
+        parsed args from command-line invocation
+    """
+    temp = server._server_env(args.load_library)
+    _ffi_api.ShmServerLoop(args.shm_fd, args.wait_fd, args.notify_fd)
+    temp.remove()
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--load-library', type=str,
+                        help="Additional library to load")
+    parser.add_argument('shm_fd', type=int)
+    parser.add_argument('wait_fd', type=int)
+    parser.add_argument('notify_fd', type=int)
+    main(parser.parse_args(sys.argv[1:]))
@@ -22,6 +22,8 @@ import tvm._ffi
 
 _save_param_dict = tvm._ffi.get_global_func("tvm.relay._save_param_dict")
 _load_param_dict = tvm._ffi.get_global_func("tvm.relay._load_param_dict")
+_save_param_file = tvm._ffi.get_global_func("runtime.SaveParamFile")
+_load_param_file = tvm._ffi.get_global_func("runtime.LoadParamFile")
 
 def save_param_dict(params):
     """Save parameter dictionary to binary bytes.
@@ -76,3 +78,44 @@ def load_param_dict(param_bytes):
         param_bytes = bytearray(param_bytes)
     load_arr = _load_param_dict(param_bytes)
     return {v.name : v.array for v in load_arr}
+
+
+def save_param_file(params, path):
+    """Save parameter dictionary to a parameter file that can be memory mapped.
+
+    The file can be loaded by the GraphModule with API "load_params_file",
+    or with load_param_file.
+
+    Parameters
+    ----------
+    params : dict of str to NDArray
+        The parameter dictionary.
+
+    path : str
+        The path of the file.
+    """
+    args = [path]
+    for k, v in params.items():
+        args.append(k)
+        args.append(tvm.nd.array(v))
+    _save_param_file(*args)
+
+
+def load_param_file(path):
+    """Load parameter dictionary from a parameter file without copying it.
+
+    The arrays are views over a private memory mapping of the file. Processes
+    loading the same file share its pages until they write to them.
+
+    Parameters
+    ----------
+    path : str
+        The path of the file.
+
+    Returns
+    -------
+    params : dict of str to NDArray
+        The parameter dictionary, on the CPU.
+    """
+    load_arr = _load_param_file(path)
+    return {load_arr[i] : load_arr[i + 1] for i in range(0, len(load_arr), 2)}
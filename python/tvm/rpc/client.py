@@ -19,12 +19,14 @@ import os
 import stat
 import socket
 import struct
+import sys
 import time
 
 import tvm._ffi
 from tvm.contrib import util
 from tvm._ffi.base import TVMError
 from tvm.runtime import ndarray as nd
+from tvm.runtime.module import ProfileResult
 
 from . import base
 from . import server
@@ -71,6 +73,29 @@ class RPCSession(object):
         """
         return self._sess.get_function(name)
 
+    def get_async_function(self, name, mod=None):
+        """Get a function whose calls do not wait for the remote to return.
+
+        Each call sends the request and returns a function that waits for the
+        result and returns it. Several calls can then be in flight on the one
+        session. The remote runs them in order.
+
+        Parameters
+        ----------
+        name : str
+            The name of the function
+
+        mod : runtime.Module, optional
+            The remote module to get the function from, the global functions
+            of the session by default.
+
+        Returns
+        -------
+        f : Function
+            The result function.
+        """
+        return _ffi_api.GetAsyncFunction(mod if mod is not None else self._sess, name)
+
     def context(self, dev_type, dev_id=0):
         """Construct a remote context.
 
@@ -91,6 +116,101 @@ class RPCSession(object):
         ctx._rpc_sess = self
         return ctx
 
+    def copy_arrays(self, copies):
+        """Copy a batch of arrays between local cpu memory and the remote.
+
+        The copies are pipelined, so a batch of small copies costs about one
+        round trip instead of one per copy.
+
+        Parameters
+        ----------
+        copies : list of tuple of (NDArray, NDArray)
+            The source and target of each copy, one of which is a local cpu
+            array and the other an array of this session.
+        """
+        args = []
+        for src, dst in copies:
+            args += [src, dst]
+        _ffi_api.CopyArrays(self._sess, *args)
+
+    def set_copy_window(self, chunk_bytes=1 << 20, window=8):
+        """Set how copies to and from the remote are split and pipelined.
+
+        Parameters
+        ----------
+        chunk_bytes : int, optional
+            The maximum size of a chunk in bytes, 0 sends each copy whole.
+
+        window : int, optional
+            The maximum number of chunk requests in flight.
+        """
+        _ffi_api.SetCopyWindow(self._sess, chunk_bytes, window)
+
+    def batch_evaluate(self, modules, func_name, ctx, args, number=10, repeat=1,
+                       min_repeat_ms=0, f_preproc='', callback=None):
+        """Time a batch of compiled modules on the remote.
+
+        All modules go to the remote in one request. The evaluations are then
+        requested without waiting, so the remote runs them back to back and
+        the results come back as each one finishes.
+
+        Parameters
+        ----------
+        modules : List[str]
+            The paths of the exported modules on the local host. The remote
+            saves each under its position in the batch and the base name of
+            its path, so modules may share a base name.
+
+        func_name : str
+            The name of the function to time in each module.
+
+        ctx : TVMContext
+            The remote context to run the function on.
+
+        args : List
+            The arguments of the function, the same for all modules.
+
+        number : int, optional
+            The number of runs averaged in one repeat, see Module.time_evaluator.
+
+        repeat : int, optional
+            The number of repeats of the measurement.
+
+        min_repeat_ms : int, optional
+            The minimum duration of one repeat in milliseconds.
+
+        f_preproc : str, optional
+            The global function on the remote to call before each repeat.
+
+        callback : function(int, Union[ProfileResult, str]), optional
+            Called with the index and result of each module as it finishes.
+
+        Returns
+        -------
+        results : List[Union[ProfileResult, str]]
+            The time costs of each module, or the error message if the module
+            failed to load or run.
+        """
+        binaries = []
+        for path in modules:
+            with open(path, "rb") as infile:
+                binaries += [os.path.basename(path), bytearray(infile.read())]
+        batch = self.get_function("tvm.rpc.server.batch_evaluate")(
+            func_name, ctx.device_type % base.RPC_SESS_MASK, ctx.device_id,
+            number, repeat, min_repeat_ms, f_preproc, *binaries)
+        feval = self.get_async_function("next", mod=batch)
+        pending = [feval(*args) for _ in modules]
+        results = []
+        for i, wait in enumerate(pending):
+            ret = wait()
+            if not isinstance(ret, str):
+                costs = struct.unpack("@" + ("d" * repeat), ret)
+                ret = ProfileResult(mean=sum(costs) / float(repeat), results=costs)
+            if callback is not None:
+                callback(i, ret)
+            results.append(ret)
+        return results
+
     def upload(self, data, target=None):
         """Upload file to remote runtime temp folder
 
@@ -239,6 +359,26 @@ class PopenSession(RPCSession):
         RPCSession.__init__(self, _popen_session(binary))
 
 
+class ShmSession(RPCSession):
+    """RPCSession with a server process on the same host.
+
+    The messages go through rings in shared memory instead of a socket,
+    which saves the system calls and kernel copies of each message.
+    Only available on Linux.
+
+    Parameters
+    ----------
+    cmd : Optional[List[str]]
+        The command that starts the server. The shared memory and eventfd
+        descriptors are appended to it. Defaults to tvm.exec.rpc_shm_server
+        in the current python interpreter.
+    """
+    def __init__(self, cmd=None):
+        if cmd is None:
+            cmd = [sys.executable, "-m", "tvm.exec.rpc_shm_server"]
+        RPCSession.__init__(self, _ffi_api.CreateShmClient(*cmd))
+
+
 class TrackerSession(object):
     """Tracker client session.
 
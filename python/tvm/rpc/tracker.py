@@ -35,6 +35,11 @@ List of available APIs:
   - input: [TrackerCode.PUT, [port, match-key]]
   - return: TrackerCode.SUCCESS
   - note: match-key is a randomly generated identify the resource during connection.
+- UPDATE_INFO: update the information of the connection
+  - input: [TrackerCode.UPDATE_INFO, info-dict]
+  - return: TrackerCode.SUCCESS
+  - note: a server that serves several sessions reports "load" and "capacity",
+    the tracker gives new requests to the least loaded server of a key.
 - REQUEST: request a new resource from tracker
   - input: [TrackerCode.REQUEST, [key, user, priority]]
   - return: [TrackerCode.SUCCESS, [url, port, match-key]]
@@ -110,15 +115,25 @@ class Scheduler(object):
 
 
 class PriorityScheduler(Scheduler):
-    """Priority based scheduler, FIFO based on time"""
+    """Priority based scheduler, FIFO based on time.
+
+    Among the free resources, the one of the least loaded server is used first.
+    """
     def __init__(self, key):
         self._key = key
         self._values = []
         self._requests = []
 
+    @staticmethod
+    def _load(value):
+        info = value[0].summary()
+        return float(info.get("load", 0)) / max(int(info.get("capacity", 1)), 1)
+
     def _schedule(self):
         while self._requests and self._values:
-            value = self._values.pop(0)
+            # min returns the first of the equally loaded values, FIFO otherwise
+            value = min(self._values, key=self._load)
+            self._values.remove(value)
             item = heapq.heappop(self._requests)
             callback = item[-1]
             if callback(value[1:]):
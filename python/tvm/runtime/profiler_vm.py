@@ -60,3 +60,71 @@ class VirtualMachineProfiler(vm.VirtualMachine):
 
     def reset(self):
         self._reset()
+
+    def enable_instruction_profile(self, enable=True):
+        """Time every instruction the virtual machine executes.
+
+        The packed functions are called once without a warm-up run while it
+        is enabled, so that the instruction times add up to the time of the
+        invocation.
+
+        Parameters
+        ----------
+        enable : bool, optional
+            Whether to time them.
+        """
+        self.module["enable_instruction_profile"](enable)
+
+    def get_instruction_stat(self):
+        """Get the count and time of each opcode grouped by Relay function,
+        followed by the time spent in kernels, shape functions, memory
+        allocation and the interpreter, and the call frames pushed and popped.
+
+        Returns
+        -------
+        report : str
+            The instruction statistics.
+        """
+        return self.module["get_instruction_stat"]()
+
+    def enable_perf_counters(self, enable=True):
+        """Count hardware events of each packed function call.
+
+        Parameters
+        ----------
+        enable : bool, optional
+            Whether to count them.
+
+        Returns
+        -------
+        enabled : bool
+            Whether the counters could be opened, perf_event_open is only
+            available on Linux when perf_event_paranoid allows it.
+        """
+        return bool(self.module["enable_perf_counters"](enable))
+
+    def set_op_flops(self, op_flops):
+        """Set the floating point operations of packed functions for the bytes
+        per FLOP ratio.
+
+        Parameters
+        ----------
+        op_flops : dict of str to int
+            The floating point operations of one call, keyed by function name.
+        """
+        args = []
+        for name, flops in op_flops.items():
+            args += [name, float(flops)]
+        self.module["set_op_flops"](*args)
+
+    def get_perf_counters(self):
+        """Get the hardware event counts per call of each packed function, with
+        the instructions per cycle and the bytes of the arguments per floating
+        point operation.
+
+        Returns
+        -------
+        report : str
+            The table of counts.
+        """
+        return self.module["get_perf_counters"]()
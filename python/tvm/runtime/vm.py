@@ -166,6 +166,42 @@ class Executable(object):
 
         return Executable(_ffi_api.Load_Executable(bytecode, lib))
 
+    def save_to_mappable_file(self, path):
+        """Save the executable, without its library, to a file that can be memory mapped.
+
+        The constants are stored at aligned offsets after the serialized
+        executable, so that :py:meth:`load_from_mappable_file` maps them instead
+        of reading them.
+
+        Parameters
+        ----------
+        path : str
+            The file path.
+        """
+        self.mod["save_to_mappable_file"](path)
+
+    @staticmethod
+    def load_from_mappable_file(path, lib):
+        """Load an executable saved by :py:meth:`save_to_mappable_file`.
+
+        The constants are views over a private memory mapping of the file, so
+        processes loading the same file share their pages.
+
+        Parameters
+        ----------
+        path : str
+            The file path.
+
+        lib : :py:class:`~tvm.runtime.Module`
+            The runtime module that contains the generated code.
+
+        Returns
+        -------
+        exec: Executable
+            The loaded executable.
+        """
+        return Executable(_ffi_api.Load_ExecutableFromMappableFile(path, lib))
+
     @property
     def lib(self):
         """Get the library that contains hardware dependent code.
@@ -270,6 +306,37 @@ class Executable(object):
         self._function_params[func_name] = params
         return params
 
+    def move_late_bound_consts(self, path, byte_limit):
+        """Move the large constants to a parameter file.
+
+        The saved executable leaves them out, so it stays small and its
+        constants are only read from the file when they are first used.
+        Constants moved by an earlier call are written to the new file as
+        well, so they have to be loaded first.
+
+        Parameters
+        ----------
+        path : str
+            The path of the parameter file.
+
+        byte_limit : int
+            Constants of at least this many bytes are moved.
+        """
+        self.mod["move_late_bound_consts"](path, byte_limit)
+
+    def load_late_bound_consts(self, path):
+        """Load the late bound constants from a parameter file.
+
+        The constants are views over a memory mapping of the file, so pages of
+        constants that no run uses are never read.
+
+        Parameters
+        ----------
+        path : str
+            The path of the parameter file.
+        """
+        self.mod["load_late_bound_consts"](path)
+
 
 class VirtualMachine(object):
     """Relay VM runtime.
@@ -284,7 +351,7 @@ class VirtualMachine(object):
 
     memory_cfg : str or Dict[tvm.runtime.TVMContext, str], optional
         Config the type of memory allocator. The allocator type can be ["naive",
-        "pooled"]. If memory_cfg is None, all contexts will use pooled allocator
+        "pooled", "best_fit", "arena"]. If memory_cfg is None, all contexts will use pooled allocator
         by default. If memory_cfg is string, all contexts will use the specified
         allocator type. If memory_cfg is a dict, each context uses the allocator
         type specified in the dict, or pooled allocator if not specified in the
@@ -293,17 +360,29 @@ class VirtualMachine(object):
 
     NAIVE_ALLOCATOR = 1
     POOLED_ALLOCATOR = 2
+    BEST_FIT_ALLOCATOR = 3
+    ARENA_ALLOCATOR = 4
+    _ALLOCATOR_TYPES = {
+        "naive": NAIVE_ALLOCATOR,
+        "pooled": POOLED_ALLOCATOR,
+        "best_fit": BEST_FIT_ALLOCATOR,
+        "arena": ARENA_ALLOCATOR,
+    }
 
     def __init__(self, exe, ctx, memory_cfg=None):
         if not isinstance(exe, Executable):
             raise TypeError("exe is expected to be the type of Executable, " +
                             "but received {}".format(type(exe)))
-        self.module = _ffi_api._VirtualMachine(exe.module)
+        self._bind(_ffi_api._VirtualMachine(exe.module), exe)
+        self._setup_ctx(ctx, memory_cfg)
+
+    def _bind(self, mod, exe):
+        """Bind to the runtime virtual machine module running the executable."""
+        self.module = mod
         self._exec = exe
         self._init = self.module["init"]
         self._invoke = self.module["invoke"]
         self._set_input = self.module["set_input"]
-        self._setup_ctx(ctx, memory_cfg)
 
     def _setup_ctx(self, ctx, memory_cfg):
         """Init context and allocators."""
@@ -313,9 +392,8 @@ class VirtualMachine(object):
         if memory_cfg is None:
             memory_cfg = {}
         elif isinstance(memory_cfg, str):
-            assert memory_cfg in ["naive", "pooled"]
-            if memory_cfg == "naive":
-                default_alloc_type = VirtualMachine.NAIVE_ALLOCATOR
+            assert memory_cfg in VirtualMachine._ALLOCATOR_TYPES
+            default_alloc_type = VirtualMachine._ALLOCATOR_TYPES[memory_cfg]
             memory_cfg = {}
         elif not isinstance(memory_cfg, dict):
             raise TypeError("memory_cfg is expected be string or dictionary, " +
@@ -325,9 +403,37 @@ class VirtualMachine(object):
             init_args.append(context.device_type)
             init_args.append(context.device_id)
             alloc_type = memory_cfg[context] if context in memory_cfg else default_alloc_type
+            if isinstance(alloc_type, str):
+                alloc_type = VirtualMachine._ALLOCATOR_TYPES[alloc_type]
             init_args.append(alloc_type)
         self._init(*init_args)
 
+    @staticmethod
+    def set_allocator_cache_limit(nbytes):
+        """Bound the free memory cached by "best_fit" allocators.
+
+        Device allocations that are entirely free are returned to the device,
+        least recently used first, once the cached bytes exceed the limit.
+
+        Parameters
+        ----------
+        nbytes : int
+            The limit in bytes. A negative value removes the limit.
+        """
+        _ffi_api.SetBestFitAllocatorCacheLimit(nbytes)
+
+    def get_allocator_stats(self):
+        """Get the allocator this virtual machine allocates storage with.
+
+        Virtual machines with the same memory_cfg share the allocator on a context.
+
+        Returns
+        -------
+        stats : str
+            The allocator type and the bytes it holds on the device as JSON.
+        """
+        return self.module["get_allocator_stats"]()
+
     def set_input(self, func_name, *args, **kwargs):
         """Set the input to a function.
 
@@ -386,6 +492,117 @@ class VirtualMachine(object):
             self.set_input(func_name, *args, **kwargs)
         return self._invoke(func_name)
 
+    def invoke_async(self, func_name, *args, **kwargs):
+        """Invoke a function asynchronously.
+
+        The returned generator runs the function up to the next kernel launch
+        each time it is advanced. Kernels on devices run asynchronously to the
+        host, so a thread can advance the invocations of several forked virtual
+        machines in turn, see :py:func:`run_interleaved`.
+
+        Parameters
+        ----------
+        func_name : str
+            The name of the function.
+
+        args : list[tvm.runtime.NDArray] or list[np.ndarray]
+            The arguments to the function.
+
+        kwargs: dict of str to tvm.runtime.NDArray or np.ndarray
+            Named arguments to the function.
+
+        Returns
+        -------
+        invocation : generator
+            A generator that returns the output once the function returned.
+            Closing it early cancels the invocation.
+        """
+        module = self.module
+
+        def run():
+            # The invocation starts with the first advance, so that a generator
+            # dropped before that leaves the virtual machine untouched, and one
+            # dropped halfway frees it for the next invocation. The inputs are
+            # set only then as well, so that the generators created before
+            # cannot overwrite them.
+            if args or kwargs:
+                self.set_input(func_name, *args, **kwargs)
+            module["invoke_async"](func_name)
+            try:
+                result = module["resume"]()
+                while result is None:
+                    yield
+                    result = module["resume"]()
+                return result
+            finally:
+                module["cancel_async"]()
+        return run()
+
+    def get_param_usage(self):
+        """Get which constants the runs so far used.
+
+        Returns
+        -------
+        usage : str
+            The constant names and sizes as JSON. Late bound constants that no
+            run loaded are listed as unloaded and count no bytes.
+        """
+        return self.module["get_param_usage"]()
+
+    def fork(self):
+        """Create a virtual machine that shares the executable, contexts and device constants
+        of this one, but has its own execution state.
+
+        A virtual machine runs one invocation at a time. Forks of it can be invoked
+        concurrently from different threads without loading the executable again.
+
+        Returns
+        -------
+        vm : VirtualMachine
+            The new virtual machine.
+        """
+        vm = VirtualMachine.__new__(VirtualMachine)
+        vm._bind(self.module["fork"](), self._exec)
+        return vm
+
+    def set_shape_cache(self, capacity):
+        """Configure the shape cache.
+
+        Shape function outputs are cached per input signature, so that repeated input
+        shapes skip the shape functions.
+
+        Parameters
+        ----------
+        capacity : int
+            The number of input signatures cached per shape function. 0 disables the cache.
+        """
+        self.module["set_shape_cache"](capacity)
+
+    def set_storage_cache(self, max_bytes):
+        """Configure storage reuse across runs.
+
+        Each storage allocation keeps its buffer for the same allocation of the next run,
+        which reuses it once the tensors allocated from it are gone and the size matches.
+        Kept buffers are not returned to the allocator, so they add to the memory a run
+        needs. Reuse is skipped with the arena allocator.
+
+        Parameters
+        ----------
+        max_bytes : int
+            The number of bytes the kept buffers may take. 0, the default, disables reuse.
+        """
+        self.module["set_storage_cache"](max_bytes)
+
+    def get_shape_cache_stats(self):
+        """Get the shape cache hit, miss and storage reuse counts.
+
+        Returns
+        -------
+        stats : str
+            The counts as JSON.
+        """
+        return self.module["get_shape_cache_stats"]()
+
     def run(self, *args, **kwargs):
         """Run the main function.
 
@@ -403,3 +620,31 @@ class VirtualMachine(object):
             The output.
         """
         return self.invoke("main", *args, **kwargs)
+
+
+def run_interleaved(invocations):
+    """Run asynchronous invocations on the calling thread, advancing each in turn.
+
+    Parameters
+    ----------
+    invocations : list[generator]
+        Invocations created by :py:meth:`VirtualMachine.invoke_async` on
+        different virtual machines.
+
+    Returns
+    -------
+    results : list[Object]
+        The outputs, in the order of the invocations.
+    """
+    results = [None] * len(invocations)
+    pending = list(enumerate(invocations))
+    while pending:
+        still_pending = []
+        for i, invocation in pending:
+            try:
+                next(invocation)
+                still_pending.append((i, invocation))
+            except StopIteration as stop:
+                results[i] = stop.value
+        pending = still_pending
+    return results
@@ -25,6 +25,7 @@
 #include <tvm/relay/analysis.h>
 #include <tvm/relay/expr.h>
 #include <tvm/relay/expr_functor.h>
+#include <tvm/relay/transform.h>
 #include <tvm/tir/op.h>
 
 #include "../../support/arena.h"
@@ -46,8 +47,16 @@ struct StorageToken {
   int device_type{0};
   /*! \brief The storage id */
   int64_t storage_id{-1};
+  /*!
+   * \brief The calls that wrote or read the storage since it was last assigned,
+   *  the first one being the writer. Only tracked for parallel plans.
+   */
+  std::vector<int> users;
 };
 
+// Plan storage so that ops that can run concurrently never share storage.
+TVM_REGISTER_PASS_CONFIG_OPTION("relay.backend.parallel_memory_plan", Bool);
+
 class StorageAllocaBaseVisitor : public ExprVisitor {
  public:
   // run the visitor on a function.
@@ -212,6 +221,9 @@ class StorageAllocator : public StorageAllocaBaseVisitor {
 
   // Run storage allocation for a function.
   Map<Expr, Array<IntegerArray> > Plan(const Function& func) {
+    parallel_ = transform::PassContext::Current()
+                    ->GetConfig<Bool>("relay.backend.parallel_memory_plan", Bool(false))
+                    .value();
     prototype_ = StorageAllocaInit(&arena_).GetInitTokenMap(func);      // 遍历整个网络，获得一个初始的Expr->StorageToken的Map，存在Prototype_
     this->Run(func);                                                    // 遍历整个网络，更新了这个Map->StorageToken的Map，存在token_map_中
                                                                         // 其中相关VisitExpr_()被重载了，所以相同的Run()跑出了不同的结果
@@ -255,7 +267,7 @@ class StorageAllocator : public StorageAllocaBaseVisitor {
     std::vector<StorageToken*> tokens;
     for (StorageToken* tok : it->second) {    // 从StorageAllocaInit的结果中找到这个初始的StorageToken  
       if (can_realloc) {
-        tokens.push_back(Request(tok));       // 对于可以内存复用的Node的处理   -----   未看完 0112 - (8)
+        tokens.push_back(SetWriter(Request(tok)));       // 对于可以内存复用的Node的处理   -----   未看完 0112 - (8)
       } else {
         // Allocate a new token,              // 对这个StorageToken做进一步处理，别看这里有这么多指针，其实都是指向最开始这个InitStorageToken
         StorageToken* allocated_tok = Alloc(tok, GetMemorySize(tok));   // 并不是真正的分配memory，StorageToken只是维护这个Node占用Memory的大小，生存期等相关信息
@@ -276,6 +288,24 @@ class StorageAllocator : public StorageAllocaBaseVisitor {
         args.push_back(tok);
       }
     }
+    if (parallel_) {
+      // The call runs after the writers of its inputs and everything they depend on.
+      current_call_ = static_cast<int>(ancestors_.size());
+      std::vector<bool> ancestors(current_call_ + 1, false);
+      for (StorageToken* tok : args) {
+        if (tok->users.empty()) continue;
+        int writer = tok->users.front();
+        ancestors[writer] = true;
+        for (int i = 0; i < writer; ++i) {
+          if (ancestors_[writer][i]) ancestors[i] = true;
+        }
+      }
+      ancestors_.push_back(std::move(ancestors));
+      // Parameters and constants have no writer and are never released.
+      for (StorageToken* tok : args) {
+        if (!tok->users.empty()) tok->users.push_back(current_call_);
+      }
+    }
     // create token for the call node.
     CreateToken(op, true);              // CallNode的这个Can_release被设为true
     // check if there is orphaned output that can be released immediately.
@@ -332,6 +362,7 @@ class StorageAllocator : public StorageAllocaBaseVisitor {
     for (auto it = mid; it != end; ++it) {
       StorageToken* tok = it->second;
       if (tok->device_type != prototype->device_type) continue;
+      if (!IsOrderedAfterUsers(tok)) continue;
       CHECK_EQ(tok->ref_counter, 0);
       // Use exect matching strategy
       tok->max_bytes = std::max(size, tok->max_bytes);
@@ -345,6 +376,7 @@ class StorageAllocator : public StorageAllocaBaseVisitor {
       --it;
       StorageToken* tok = it->second;
       if (tok->device_type != prototype->device_type) continue;
+      if (!IsOrderedAfterUsers(tok)) continue;
       CHECK_EQ(tok->ref_counter, 0);
       // Use exect matching strategy
       tok->max_bytes = std::max(size, tok->max_bytes);
@@ -367,6 +399,30 @@ class StorageAllocator : public StorageAllocaBaseVisitor {
     data_.push_back(prototype);
     return prototype;
   }
+  /*!
+   * \brief Check whether the current call depends on every call that used the
+   *  storage of a released token, so it cannot overwrite the storage while
+   *  they run. Always true for sequential plans.
+   * \param tok The released token.
+   */
+  bool IsOrderedAfterUsers(const StorageToken* tok) const {
+    if (!parallel_) return true;
+    const std::vector<bool>& ancestors = ancestors_[current_call_];
+    for (int user : tok->users) {
+      if (!ancestors[user]) return false;
+    }
+    return true;
+  }
+  /*!
+   * \brief Record the current call as the writer of a token.
+   * \param tok The token assigned to the output of the current call.
+   */
+  StorageToken* SetWriter(StorageToken* tok) {
+    if (parallel_) {
+      tok->users.assign(1, current_call_);
+    }
+    return tok;
+  }
   /*!
    * \brief Check if we can release token.
    * \tok The token to be released.
@@ -384,6 +440,12 @@ class StorageAllocator : public StorageAllocaBaseVisitor {
   support::Arena arena_;
   // scale used for rough match
   size_t match_range_{16};
+  // whether ops that may run concurrently must not share storage
+  bool parallel_{false};
+  // index of the call being planned, -1 outside of calls
+  int current_call_{-1};
+  // ancestors_[i][j] tells whether call i depends on call j
+  std::vector<std::vector<bool> > ancestors_;
   // free list of storage entry
   std::multimap<size_t, StorageToken*> free_;
   // all the storage resources available
@@ -24,9 +24,14 @@
 #include <dmlc/thread_local.h>
 #include <tvm/runtime/device_api.h>
 #include <tvm/runtime/registry.h>
+#include <tvm/runtime/threading_backend.h>
 
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
 
 #include "workspace_pool.h"
 
@@ -34,8 +39,60 @@
 #include <android/api-level.h>
 #endif
 
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
 namespace tvm {
 namespace runtime {
+
+// allocations smaller than this are not bound to a NUMA node.
+constexpr size_t kNumaPageSize = 4 << 10;
+
+#if defined(__linux__)
+/*!
+ * \brief Buffers placed on a NUMA node. They are mapped fresh, so that no page is touched
+ *  before the placement policy is set, and unmapped when freed.
+ */
+class NumaMappedBuffers {
+ public:
+  void* Alloc(size_t nbytes, int numa_node) {
+    void* ptr = mmap(nullptr, nbytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) return nullptr;
+    threading::BindMemoryToNumaNode(ptr, nbytes, numa_node);
+    std::lock_guard<std::mutex> lock(mutex_);
+    sizes_[ptr] = nbytes;
+    used_.store(true, std::memory_order_relaxed);
+    return ptr;
+  }
+
+  bool Free(void* ptr) {
+    // Skip the lookup in processes that never bound memory to a node.
+    if (!used_.load(std::memory_order_relaxed)) return false;
+    size_t nbytes;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = sizes_.find(ptr);
+      if (it == sizes_.end()) return false;
+      nbytes = it->second;
+      sizes_.erase(it);
+    }
+    munmap(ptr, nbytes);
+    return true;
+  }
+
+  static NumaMappedBuffers* Global() {
+    static NumaMappedBuffers* inst = new NumaMappedBuffers();
+    return inst;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::unordered_map<void*, size_t> sizes_;
+  std::atomic<bool> used_{false};
+};
+#endif
+
 class CPUDeviceAPI final : public DeviceAPI {
  public:
   void SetDevice(TVMContext ctx) final {}
@@ -54,6 +111,15 @@ class CPUDeviceAPI final : public DeviceAPI {
     ptr = memalign(alignment, nbytes);
     if (ptr == nullptr) throw std::bad_alloc();
 #else
+#if defined(__linux__)
+    // Place large buffers on the NUMA node preferred by the calling thread.
+    // The mapping is untouched, so the OS faults its pages in on that node.
+    int numa_node = threading::PreferredNumaNode();
+    if (numa_node >= 0 && nbytes >= kNumaPageSize && alignment <= kNumaPageSize) {
+      ptr = NumaMappedBuffers::Global()->Alloc(nbytes, numa_node);
+      if (ptr != nullptr) return ptr;
+    }
+#endif
     // posix_memalign is available in android ndk since __ANDROID_API__ >= 17
     int ret = posix_memalign(&ptr, alignment, nbytes);
     if (ret != 0) throw std::bad_alloc();
@@ -65,6 +131,9 @@ class CPUDeviceAPI final : public DeviceAPI {
 #if _MSC_VER
     _aligned_free(ptr);
 #else
+#if defined(__linux__)
+    if (NumaMappedBuffers::Global()->Free(ptr)) return;
+#endif
     free(ptr);
 #endif
   }
@@ -98,6 +167,20 @@ void CPUDeviceAPI::FreeWorkspace(TVMContext ctx, void* data) {
   dmlc::ThreadLocalStore<CPUWorkspacePool>::Get()->FreeWorkspace(ctx, data);
 }
 
+// Statistics of the CPU workspace pool of the calling thread.
+TVM_REGISTER_GLOBAL("runtime.cpu_workspace_pool_stats").set_body([](TVMArgs args, TVMRetValue* rv) {
+  TVMContext ctx;
+  ctx.device_type = kDLCPU;
+  ctx.device_id = 0;
+  WorkspacePool::Stats stats = dmlc::ThreadLocalStore<CPUWorkspacePool>::Get()->GetStats(ctx);
+  std::ostringstream os;
+  os << "{\"bytes_in_use\": " << stats.bytes_in_use
+     << ", \"peak_bytes_in_use\": " << stats.peak_bytes_in_use
+     << ", \"bytes_reserved\": " << stats.bytes_reserved << ", \"num_allocs\": " << stats.num_allocs
+     << ", \"num_reuses\": " << stats.num_reuses << "}";
+  *rv = os.str();
+});
+
 TVM_REGISTER_GLOBAL("device_api.cpu").set_body([](TVMArgs args, TVMRetValue* rv) {
   DeviceAPI* ptr = CPUDeviceAPI::Global().get();
   *rv = static_cast<void*>(ptr);
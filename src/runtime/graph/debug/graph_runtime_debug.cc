@@ -27,7 +27,10 @@
 
 #include <chrono>
 #include <sstream>
+#include <unordered_map>
+#include <utility>
 
+#include "../../perf_counters.h"
 #include "../graph_runtime.h"
 
 namespace tvm {
@@ -66,6 +69,7 @@ class GraphRuntimeDebug : public GraphRuntime {
       double duration_ms = 0.0;
       do {
         std::fill(time_per_op.begin(), time_per_op.end(), 0);
+        perf_stats_.assign(op_execs_.size(), PerfCounterStats());
         if (duration_ms > 0.0) {
           number = static_cast<int>(std::max((min_repeat_ms / (duration_ms / number) + 1),
                                              number * 1.618));  // 1.618 is chosen by random
@@ -75,10 +79,12 @@ class GraphRuntimeDebug : public GraphRuntime {
           for (size_t index = 0; index < op_execs_.size(); ++index) {
             if (op_execs_[index]) {
               const TVMContext& ctx = data_entry_[entry_id(index, 0)]->ctx;
+              if (perf_counters_.is_open()) perf_counters_.Start();
               auto op_tbegin = std::chrono::high_resolution_clock::now();
               op_execs_[index]();
               TVMSynchronize(ctx.device_type, ctx.device_id, nullptr);
               auto op_tend = std::chrono::high_resolution_clock::now();
+              if (perf_counters_.is_open()) perf_counters_.Stop(&perf_stats_[index]);
               double op_duration =
                   std::chrono::duration_cast<std::chrono::duration<double> >(op_tend - op_tbegin)
                       .count();
@@ -108,6 +114,50 @@ class GraphRuntimeDebug : public GraphRuntime {
     return os.str();
   }
 
+  /*!
+   * \brief Count hardware events of each operator in RunIndividual.
+   * \param enable Whether to count them.
+   * \return Whether the counters could be opened.
+   */
+  bool EnablePerfCounters(bool enable) {
+    perf_counters_.Close();
+    if (!enable) return false;
+    std::string error;
+    if (!perf_counters_.Open(&error)) {
+      LOG(WARNING) << "Cannot count hardware events: " << error;
+      return false;
+    }
+    return true;
+  }
+
+  /*!
+   * \brief Set the floating point operations of operators.
+   * \param name The node or function name.
+   * \param flops The floating point operations of one call.
+   */
+  void SetOpFlops(const std::string& name, double flops) { op_flops_[name] = flops; }
+
+  /*!
+   * \brief Get the hardware event counts per call of each operator in the last
+   *  iteration of RunIndividual.
+   * \return The report table.
+   */
+  std::string GetPerfCounters() {
+    std::vector<std::pair<std::string, PerfCounterStats>> rows;
+    for (size_t index = 0; index < perf_stats_.size(); ++index) {
+      if (!op_execs_[index]) continue;
+      PerfCounterStats stats = perf_stats_[index];
+      for (const DLTensor& t : op_args_[index]->args) {
+        stats.bytes += static_cast<int64_t>(GetDataSize(t));
+      }
+      auto it = op_flops_.find(GetNodeName(index));
+      if (it == op_flops_.end()) it = op_flops_.find(nodes_[index].param.func_name);
+      if (it != op_flops_.end()) stats.flops = it->second;
+      rows.emplace_back(GetNodeName(index), stats);
+    }
+    return FormatPerfCounterReport(rows);
+  }
+
   /*!
    * \brief Run each operation and get the output.
    * \param index The index of op which needs to be returned.
@@ -158,6 +208,14 @@ class GraphRuntimeDebug : public GraphRuntime {
 
     data_entry_[eid].CopyTo(data_out);
   }
+
+ private:
+  /*! \brief The hardware counters, closed unless enabled. */
+  PerfCounters perf_counters_;
+  /*! \brief The hardware event counts of each node. */
+  std::vector<PerfCounterStats> perf_stats_;
+  /*! \brief The floating point operations of node or function names. */
+  std::unordered_map<std::string, double> op_flops_;
 };
 
 /*!
@@ -190,6 +248,20 @@ PackedFunc GraphRuntimeDebug::GetFunction(const std::string& name,
       CHECK_GE(min_repeat_ms, 0);
       *rv = this->RunIndividual(number, repeat, min_repeat_ms);
     });
+  } else if (name == "enable_perf_counters") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      *rv = this->EnablePerfCounters(args[0]);
+    });
+  } else if (name == "set_op_flops") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      CHECK_EQ(args.num_args % 2, 0) << "set_op_flops expects pairs of name and flops";
+      for (int i = 0; i < args.num_args; i += 2) {
+        this->SetOpFlops(args[i], args[i + 1]);
+      }
+    });
+  } else if (name == "get_perf_counters") {
+    return PackedFunc(
+        [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { *rv = this->GetPerfCounters(); });
   } else {
     return GraphRuntime::GetFunction(name, sptr_to_self);
   }
@@ -28,16 +28,26 @@
 #include <tvm/runtime/packed_func.h>
 #include <tvm/runtime/registry.h>
 #include <tvm/runtime/serializer.h>
+#include <tvm/runtime/threading_backend.h>
 
 #include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <numeric>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include "../library_module.h"
+#include "../param_file.h"
+#include "graph_tracer.h"
+
 namespace tvm {
 namespace runtime {
 namespace details {
@@ -49,14 +59,248 @@ inline size_t GetDataAlignment(const DLTensor& arr) {
 }  // namespace details
 
 /*!
- * \brief Run all the operations one by one.
+ * \brief Runs the operators of a graph as soon as their dependencies finish.
+ *
+ *  num_streams helper threads take ready operators from a shared queue while
+ *  the calling thread waits. Each stream pins its thread pool to its own slice
+ *  of the cores and limits the parallel launches of an operator to
+ *  threads_per_op tasks, so that concurrent operators split the cores instead
+ *  of each asking for all of them.
+ */
+class InterOpExecutor {
+ public:
+  InterOpExecutor(int num_streams, int threads_per_op) : threads_per_op_(threads_per_op) {
+    for (int i = 0; i < num_streams; ++i) {
+      threads_.emplace_back([this, i, num_streams]() { this->StreamLoop(i, num_streams); });
+    }
+  }
+
+  ~InterOpExecutor() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      exit_now_ = true;
+    }
+    ready_cv_.notify_all();
+    for (auto& t : threads_) t.join();
+  }
+
+  void Run(const std::vector<std::function<void()>>& op_execs,
+           const std::vector<std::vector<uint32_t>>& successors,
+           const std::vector<uint32_t>& num_predecessors, GraphTracer* tracer, int64_t run) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    op_execs_ = &op_execs;
+    successors_ = &successors;
+    tracer_ = run < 0 ? nullptr : tracer;
+    run_ = run;
+    pending_ = num_predecessors;
+    num_remaining_ = 0;
+    error_.clear();
+    for (uint32_t nid = 0; nid < op_execs.size(); ++nid) {
+      if (!op_execs[nid]) continue;
+      ++num_remaining_;
+      if (pending_[nid] == 0) ready_.push_back(nid);
+    }
+    ready_cv_.notify_all();
+    done_cv_.wait(lock, [this]() { return num_remaining_ == 0; });
+    op_execs_ = nullptr;
+    successors_ = nullptr;
+    std::string error = std::move(error_);
+    lock.unlock();
+    if (!error.empty()) {
+      LOG(FATAL) << error;
+    }
+  }
+
+ private:
+  void StreamLoop(int stream, int num_streams) {
+    threading::ConfigureThreadPoolCoreSlice(stream, num_streams);
+    threading::SetMaxParallelTasks(threads_per_op_);
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      ready_cv_.wait(lock, [this]() { return exit_now_ || !ready_.empty(); });
+      if (exit_now_) return;
+      RunOne(&lock);
+    }
+  }
+
+  // Run the first ready operator, requires the lock to be held.
+  void RunOne(std::unique_lock<std::mutex>* lock) {
+    uint32_t nid = ready_.front();
+    ready_.pop_front();
+    // Once an operator failed the remaining ones are only drained.
+    if (error_.empty()) {
+      const std::function<void()>& fexec = (*op_execs_)[nid];
+      GraphTracer* tracer = tracer_;
+      lock->unlock();
+      std::string error;
+      int64_t start_ns = tracer != nullptr ? GraphTracer::Now() : 0;
+      try {
+        fexec();
+      } catch (const std::exception& e) {
+        error = e.what();
+      }
+      if (tracer != nullptr) tracer->Record(run_, nid, start_ns, GraphTracer::Now());
+      lock->lock();
+      if (!error.empty() && error_.empty()) error_ = std::move(error);
+    }
+    size_t num_ready = ready_.size();
+    for (uint32_t succ : (*successors_)[nid]) {
+      if (--pending_[succ] == 0) ready_.push_back(succ);
+    }
+    for (size_t i = num_ready; i < ready_.size(); ++i) {
+      ready_cv_.notify_one();
+    }
+    if (--num_remaining_ == 0) {
+      done_cv_.notify_one();
+    }
+  }
+
+  int threads_per_op_;
+  std::vector<std::thread> threads_;
+  // the state below is guarded by mutex_
+  std::mutex mutex_;
+  std::condition_variable ready_cv_;
+  std::condition_variable done_cv_;
+  std::deque<uint32_t> ready_;
+  std::vector<uint32_t> pending_;
+  size_t num_remaining_{0};
+  const std::vector<std::function<void()>>* op_execs_{nullptr};
+  const std::vector<std::vector<uint32_t>>* successors_{nullptr};
+  GraphTracer* tracer_{nullptr};
+  int64_t run_{-1};
+  std::string error_;
+  bool exit_now_{false};
+};
+
+GraphRuntime::GraphRuntime() {}
+
+GraphRuntime::~GraphRuntime() {}
+
+/*!
+ * \brief Run all the operations one by one, or as soon as their inputs are
+ *  ready when inter-operator parallelism is enabled.
  */
 void GraphRuntime::Run() {
+  GraphTracer* tracer = tracer_.get();
+  int64_t run = tracer != nullptr ? tracer->BeginRun() : -1;
+  if (inter_op_executor_ != nullptr) {
+    inter_op_executor_->Run(op_execs_, op_successors_, op_num_predecessors_, tracer, run);
+    return;
+  }
+  if (!frozen_ops_.empty()) {
+    // Restores the task budget of the caller when leaving a run of small operators.
+    struct BudgetGuard {
+      int saved{threading::MaxParallelTasks()};
+      bool serial{false};
+      void Set(bool s) {
+        if (s == serial) return;
+        serial = s;
+        threading::SetMaxParallelTasks(serial ? 1 : saved);
+      }
+      ~BudgetGuard() { Set(false); }
+    } budget;
+    for (const FrozenOp& op : frozen_ops_) {
+      budget.Set(op.serial);
+      int64_t start_ns = run >= 0 ? GraphTracer::Now() : 0;
+      if (op.faddr == nullptr) {
+        op_execs_[op.nid]();
+      } else {
+        TVMValue ret_value;
+        int ret_type_code = kTVMNullptr;
+        int ret = (*op.faddr)(op.arg_values, op.arg_tcodes, op.num_args, &ret_value,
+                              &ret_type_code, nullptr);
+        CHECK_EQ(ret, 0) << TVMGetLastError();
+      }
+      if (run >= 0) tracer->Record(run, op.nid, start_ns, GraphTracer::Now());
+    }
+    return;
+  }
+  if (run >= 0) {
+    for (size_t i = 0; i < op_execs_.size(); ++i) {
+      if (!op_execs_[i]) continue;
+      int64_t start_ns = GraphTracer::Now();
+      op_execs_[i]();
+      tracer->Record(run, static_cast<uint32_t>(i), start_ns, GraphTracer::Now());
+    }
+    return;
+  }
   // setup the array and requirements.
   for (size_t i = 0; i < op_execs_.size(); ++i) {
     if (op_execs_[i]) op_execs_[i]();
   }
 }
+
+void GraphRuntime::SetTraceConfig(double sample_rate, size_t capacity) {
+  CHECK_GE(sample_rate, 0.0) << "sample_rate must be in [0, 1]";
+  CHECK_LE(sample_rate, 1.0) << "sample_rate must be in [0, 1]";
+  tracer_.reset();
+  if (sample_rate == 0.0) return;
+  std::vector<std::string> node_names;
+  for (const Node& node : nodes_) {
+    node_names.push_back(node.name);
+  }
+  uint64_t sample_period = std::max<uint64_t>(1, static_cast<uint64_t>(1.0 / sample_rate + 0.5));
+  tracer_.reset(new GraphTracer(std::move(node_names), sample_period, capacity));
+}
+
+std::string GraphRuntime::GetTrace(const std::string& format, bool reset) {
+  CHECK(tracer_ != nullptr) << "Tracing is not enabled, call set_trace_config first";
+  std::string trace;
+  if (format == "chrome") {
+    trace = tracer_->ChromeTrace();
+  } else if (format == "histogram") {
+    trace = tracer_->Histograms();
+  } else {
+    LOG(FATAL) << "Unknown trace format " << format << ", expected chrome or histogram";
+  }
+  if (reset) tracer_->Reset();
+  return trace;
+}
+
+void GraphRuntime::SetInterOpParallelism(int num_streams, int threads_per_op) {
+  CHECK_GE(num_streams, 1) << "num_streams must be positive";
+  CHECK_GE(threads_per_op, 0) << "threads_per_op must be non-negative";
+  inter_op_executor_.reset();
+  if (num_streams > 1) {
+    // Concurrent operators share the cores, so by default each gets an even slice of them.
+    if (threads_per_op == 0) {
+      threads_per_op = std::max(1, threading::MaxConcurrency() / num_streams);
+    }
+    inter_op_executor_.reset(new InterOpExecutor(num_streams, threads_per_op));
+  }
+}
+
+void GraphRuntime::Freeze(size_t small_op_bytes) {
+  frozen_ = true;
+  small_op_bytes_ = small_op_bytes;
+  frozen_ops_.clear();
+  for (uint32_t nid = 0; nid < this->GetNumOfNodes(); ++nid) {
+    if (!op_execs_[nid]) continue;
+    const TVMOpParam& param = nodes_[nid].param;
+    if (param.func_name == "__nop") continue;
+    OpArgs* args = op_args_[nid].get();
+    FrozenOp op;
+    op.faddr = nullptr;
+    // Operators reading lazy parameters load them through op_execs_.
+    if (param.func_name != "__copy" && PendingLazyInputs(nid).empty()) {
+      // Functions that do not come from a compiled library keep the PackedFunc call.
+      op.faddr = GetWrappedPackedCFunc(module_.GetFunction(param.func_name, true));
+    }
+    op.arg_values = args->arg_values.data();
+    op.arg_tcodes = args->arg_tcodes.data();
+    op.num_args = static_cast<int>(args->arg_values.size());
+    op.nid = nid;
+    op.serial = false;
+    if (small_op_bytes != 0) {
+      size_t nbytes = 0;
+      for (const DLTensor& t : args->args) {
+        nbytes += GetDataSize(t);
+      }
+      op.serial = nbytes <= small_op_bytes;
+    }
+    frozen_ops_.push_back(op);
+  }
+}
 /*!
  * \brief Initialize the graph executor with graph and context.
  * \param graph_json The execution graph.
@@ -101,6 +345,8 @@ int GraphRuntime::GetInputIndex(const std::string& name) {
 void GraphRuntime::SetInput(int index, DLTensor* data_in) {
   CHECK_LT(static_cast<size_t>(index), input_nodes_.size());
   uint32_t eid = this->entry_id(input_nodes_[index], 0);
+  auto lazy_it = lazy_params_.find(eid);
+  if (lazy_it != lazy_params_.end()) SettleLazyParam(lazy_it->second.get(), false);
   data_entry_[eid].CopyFrom(data_in);
 }
 /*!
@@ -123,6 +369,8 @@ void GraphRuntime::SetInputZeroCopy(int index, DLTensor* data_ref) {
     CHECK_EQ(old_t->shape[i], data_ref->shape[i]);
   }
 
+  auto lazy_it = lazy_params_.find(eid);
+  if (lazy_it != lazy_params_.end()) SettleLazyParam(lazy_it->second.get(), false);
   // Update the data pointer for each argument of each op
   for (DLTensor* t : input_dltensors_[eid]) {
     t->data = data_ref->data;
@@ -149,6 +397,8 @@ int GraphRuntime::NumInputs() const { return input_nodes_.size(); }
 NDArray GraphRuntime::GetInput(int index) const {
   CHECK_LT(static_cast<size_t>(index), input_nodes_.size());
   uint32_t eid = this->entry_id(input_nodes_[index], 0);
+  auto lazy_it = lazy_params_.find(eid);
+  if (lazy_it != lazy_params_.end()) SettleLazyParam(lazy_it->second.get(), true);
   return data_entry_[eid];
 }
 /*!
@@ -219,6 +469,88 @@ void GraphRuntime::LoadParams(dmlc::Stream* strm) {
   }
 }
 
+void GraphRuntime::LoadParamFile(const std::string& path, bool lazy) {
+  bool rebind = false;
+  for (auto& kv : runtime::LoadParamFile(path)) {
+    int in_idx = GetInputIndex(kv.first);
+    if (in_idx < 0) continue;
+    uint32_t eid = this->entry_id(input_nodes_[in_idx], 0);
+    CHECK_LT(eid, data_entry_.size());
+    // a parameter loaded again replaces the pending one.
+    if (lazy_params_.erase(eid) != 0) rebind = true;
+    const DLTensor* entry = data_entry_[eid].operator->();
+    const DLTensor* param = kv.second.operator->();
+    bool same_layout = entry->ndim == param->ndim && TypeEqual(entry->dtype, param->dtype) &&
+                       std::equal(entry->shape, entry->shape + entry->ndim, param->shape);
+    std::unique_ptr<LazyParam> lazy_param(new LazyParam());
+    lazy_param->name = kv.first;
+    lazy_param->eid = eid;
+    if (entry->ctx.device_type == kDLCPU && same_layout) {
+      // Use the mapped parameter in place of the planned storage.
+      data_entry_[eid] = kv.second;
+      data_alignment_[eid] = details::GetDataAlignment(*param);
+      rebind = true;
+    } else if (lazy) {
+      lazy_param->source = kv.second;
+    } else {
+      data_entry_[eid].CopyFrom(kv.second);
+    }
+    if (lazy) lazy_params_[eid] = std::move(lazy_param);
+  }
+  // Release the planned storage that only parameters bound to the file used.
+  for (NDArray& storage : storage_pool_) {
+    if (storage.defined() && storage.use_count() == 1) storage = NDArray();
+  }
+  if (rebind || lazy) this->SetupOpExecs();
+}
+
+void GraphRuntime::SettleLazyParam(LazyParam* param, bool load) const {
+  std::call_once(param->once, [this, param, load]() {
+    if (load && param->source.defined()) {
+      NDArray entry = data_entry_[param->eid];
+      entry.CopyFrom(param->source);
+    }
+    param->source = NDArray();
+    param->used.store(true, std::memory_order_release);
+  });
+}
+
+std::vector<GraphRuntime::LazyParam*> GraphRuntime::PendingLazyInputs(uint32_t nid) const {
+  std::vector<LazyParam*> pending;
+  if (lazy_params_.empty()) return pending;
+  for (const auto& e : nodes_[nid].inputs) {
+    auto it = lazy_params_.find(this->entry_id(e));
+    if (it == lazy_params_.end() || it->second->used.load(std::memory_order_acquire)) continue;
+    LazyParam* param = it->second.get();
+    if (std::find(pending.begin(), pending.end(), param) == pending.end()) {
+      pending.push_back(param);
+    }
+  }
+  return pending;
+}
+
+std::string GraphRuntime::GetParamUsage() const {
+  std::ostringstream os;
+  int64_t num_used = 0, bytes_used = 0, bytes_total = 0;
+  std::ostringstream used, unused;
+  for (const auto& kv : lazy_params_) {
+    const LazyParam* param = kv.second.get();
+    int64_t nbytes = static_cast<int64_t>(GetDataSize(*data_entry_[param->eid].operator->()));
+    bytes_total += nbytes;
+    std::ostringstream& names = param->used.load() ? used : unused;
+    if (names.tellp() != 0) names << ", ";
+    names << "\"" << param->name << "\"";
+    if (param->used.load()) {
+      ++num_used;
+      bytes_used += nbytes;
+    }
+  }
+  os << "{\"num_params\": " << lazy_params_.size() << ", \"num_used\": " << num_used
+     << ", \"bytes_total\": " << bytes_total << ", \"bytes_used\": " << bytes_used
+     << ", \"used\": [" << used.str() << "], \"unused\": [" << unused.str() << "]}";
+  return os.str();
+}
+
 void GraphRuntime::ShareParams(const GraphRuntime& other, dmlc::Stream* strm) {
   uint64_t header, reserved;
   CHECK(strm->Read(&header)) << "Invalid parameters file format";
@@ -311,7 +643,8 @@ void GraphRuntime::SetupStorage() {
 
 void GraphRuntime::SetupOpExecs() {
   op_execs_.resize(this->GetNumOfNodes());
-  input_dltensors_.resize(num_node_entries());
+  op_args_.assign(this->GetNumOfNodes(), nullptr);
+  input_dltensors_.assign(num_node_entries(), {});
   std::unordered_set<uint32_t> input_node_eids;
   for (size_t i = 0; i < input_nodes_.size(); i++) {
     uint32_t nid = input_nodes_[i];
@@ -335,6 +668,15 @@ void GraphRuntime::SetupOpExecs() {
 
     std::shared_ptr<OpArgs> op_args = nullptr;
     std::tie(op_execs_[nid], op_args) = CreateTVMOp(inode.param, args, inode.inputs.size());
+    op_args_[nid] = op_args;
+    std::vector<LazyParam*> lazy_inputs = PendingLazyInputs(nid);
+    if (!lazy_inputs.empty()) {
+      std::function<void()> fexec = std::move(op_execs_[nid]);
+      op_execs_[nid] = [this, lazy_inputs, fexec]() {
+        for (LazyParam* param : lazy_inputs) this->SettleLazyParam(param, true);
+        fexec();
+      };
+    }
 
     for (size_t i = 0; i < inode.inputs.size(); i++) {
       uint32_t eid = this->entry_id(inode.inputs[i]);
@@ -344,6 +686,42 @@ void GraphRuntime::SetupOpExecs() {
       }
     }
   }
+  this->SetupOpDependencies();
+  if (frozen_) this->Freeze(small_op_bytes_);
+}
+
+void GraphRuntime::SetupOpDependencies() {
+  uint32_t num_nodes = this->GetNumOfNodes();
+  op_successors_.assign(num_nodes, {});
+  op_num_predecessors_.assign(num_nodes, 0);
+  // The last writer of each storage and the readers since then, in program order.
+  std::vector<int> last_writer(storage_pool_.size(), -1);
+  std::vector<std::vector<uint32_t>> readers(storage_pool_.size());
+  std::vector<uint32_t> preds;
+  for (uint32_t nid = 0; nid < num_nodes; ++nid) {
+    if (!op_execs_[nid]) continue;
+    const auto& inode = nodes_[nid];
+    preds.clear();
+    for (const auto& e : inode.inputs) {
+      uint32_t sid = attrs_.storage_id[this->entry_id(e)];
+      if (last_writer[sid] >= 0) preds.push_back(last_writer[sid]);
+      readers[sid].push_back(nid);
+    }
+    for (uint32_t index = 0; index < inode.param.num_outputs; ++index) {
+      uint32_t sid = attrs_.storage_id[this->entry_id(nid, index)];
+      if (last_writer[sid] >= 0) preds.push_back(last_writer[sid]);
+      preds.insert(preds.end(), readers[sid].begin(), readers[sid].end());
+      last_writer[sid] = nid;
+      readers[sid].clear();
+    }
+    std::sort(preds.begin(), preds.end());
+    preds.erase(std::unique(preds.begin(), preds.end()), preds.end());
+    for (uint32_t pred : preds) {
+      if (pred == nid) continue;
+      op_successors_[pred].push_back(nid);
+      ++op_num_predecessors_[nid];
+    }
+  }
 }
 
 std::pair<std::function<void()>, std::shared_ptr<GraphRuntime::OpArgs> > GraphRuntime::CreateTVMOp(
@@ -444,10 +822,41 @@ PackedFunc GraphRuntime::GetFunction(const std::string& name,
         [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { *rv = this->NumInputs(); });
   } else if (name == "run") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { this->Run(); });
+  } else if (name == "freeze") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      int64_t small_op_bytes = args.num_args > 0 ? args[0].operator int64_t() : 0;
+      CHECK_GE(small_op_bytes, 0) << "small_op_bytes must be non-negative";
+      this->Freeze(static_cast<size_t>(small_op_bytes));
+    });
+  } else if (name == "set_trace_config") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      int64_t capacity = args.num_args > 1 ? args[1].operator int64_t() : 65536;
+      CHECK_GT(capacity, 0) << "capacity must be positive";
+      this->SetTraceConfig(args[0], static_cast<size_t>(capacity));
+    });
+  } else if (name == "get_trace") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      std::string format = args.num_args > 0 ? args[0].operator std::string() : "chrome";
+      bool reset = args.num_args > 1 ? args[1] : false;
+      *rv = this->GetTrace(format, reset);
+    });
+  } else if (name == "set_inter_op_parallelism") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      int threads_per_op = args.num_args > 1 ? args[1] : 0;
+      this->SetInterOpParallelism(args[0], threads_per_op);
+    });
   } else if (name == "load_params") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
       this->LoadParams(args[0].operator std::string());
     });
+  } else if (name == "load_params_file") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      bool lazy = args.num_args > 1 ? args[1] : false;
+      this->LoadParamFile(args[0].operator std::string(), lazy);
+    });
+  } else if (name == "get_param_usage") {
+    return PackedFunc(
+        [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { *rv = this->GetParamUsage(); });
   } else if (name == "share_params") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
       const auto& module = args[0].operator Module();
@@ -28,10 +28,14 @@
 #include <dlpack/dlpack.h>
 #include <dmlc/json.h>
 #include <dmlc/memory_io.h>
+#include <tvm/runtime/c_backend_api.h>
 #include <tvm/runtime/ndarray.h>
 #include <tvm/runtime/packed_func.h>
 
+#include <atomic>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -50,6 +54,9 @@ namespace runtime {
 /*! \brief Magic number for NDArray list file  */
 constexpr uint64_t kTVMNDArrayListMagic = 0xF7E58D4F05049CB7;
 
+class InterOpExecutor;
+class GraphTracer;
+
 /*! \brief operator attributes about tvm op */
 struct TVMOpParam {
   std::string func_name;
@@ -87,6 +94,47 @@ class TVM_DLL GraphRuntime : public ModuleNode {
   const char* type_key() const final { return "GraphRuntime"; }
   void Run();
 
+  GraphRuntime();
+  ~GraphRuntime();
+
+  /*!
+   * \brief Run independent operators concurrently.
+   * \param num_streams The number of operators that may run at the same time,
+   *  1 restores sequential execution.
+   * \param threads_per_op The number of tasks each operator may parallelize
+   *  over, 0 splits the cores evenly among the streams.
+   */
+  void SetInterOpParallelism(int num_streams, int threads_per_op);
+
+  /*!
+   * \brief Freeze the operator sequence. Run then calls the compiled functions
+   *  directly with their pre-packed arguments instead of going through
+   *  std::function and PackedFunc for every operator.
+   * \param small_op_bytes Operators whose arguments total at most this many
+   *  bytes run on the calling thread only, so that runs of tiny operators do
+   *  not pay a thread pool launch each. 0 disables it.
+   * \note The frozen sequence is not used while inter-operator parallelism is enabled.
+   */
+  void Freeze(size_t small_op_bytes);
+
+  /*!
+   * \brief Trace the operators of a sample of the runs.
+   * \param sample_rate The fraction of runs to trace, rounded to one in N runs.
+   *  0 disables tracing.
+   * \param capacity The number of operator events kept, older ones are overwritten.
+   * \note Operators on devices are asynchronous, their events only cover the launch.
+   */
+  void SetTraceConfig(double sample_rate, size_t capacity);
+
+  /*!
+   * \brief Get the collected trace.
+   * \param format "chrome" for Chrome trace event JSON, "histogram" for the
+   *  per node duration histograms.
+   * \param reset Whether to drop the collected events afterwards.
+   * \return The trace as JSON.
+   */
+  std::string GetTrace(const std::string& format, bool reset);
+
   /*!
    * \brief Initialize the graph executor with graph and context.
    * \param graph_json The execution graph.
@@ -161,6 +209,22 @@ class TVM_DLL GraphRuntime : public ModuleNode {
    */
   void LoadParams(const std::string& param_blob);
 
+  /*!
+   * \brief Load parameters from a parameter file. Parameters on the CPU use
+   *  the memory mapped file directly, others are copied from it once.
+   * \param path The path of the parameter file.
+   * \param lazy Whether to copy parameters on other devices only when an
+   *  operator first reads them, and to record which parameters are read.
+   *  Mapped pages are only read from the file when touched either way.
+   */
+  void LoadParamFile(const std::string& path, bool lazy);
+
+  /*!
+   * \brief Get which of the lazily loaded parameters were read.
+   * \return The parameter names and sizes as JSON.
+   */
+  std::string GetParamUsage() const;
+
   /*!
    * \brief Share parameters from pre-existing GraphRuntime instance.
    * \param other A GraphRuntime instance, previously with |LoadParams| called with the
@@ -366,6 +430,30 @@ class TVM_DLL GraphRuntime : public ModuleNode {
   void SetupStorage();
   /*! \brief Setup the executors. */
   void SetupOpExecs();
+  /*! \brief A parameter loaded when an operator first reads it. */
+  struct LazyParam {
+    std::string name;
+    uint32_t eid;
+    /*! \brief The mapped parameter to copy, null when it is bound directly. */
+    NDArray source;
+    std::once_flag once;
+    /*! \brief Whether the parameter was read or overwritten. */
+    std::atomic<bool> used{false};
+  };
+  /*!
+   * \brief Make sure a lazy parameter is in place.
+   * \param param The parameter.
+   * \param load Whether to load it, false when it is about to be overwritten.
+   */
+  void SettleLazyParam(LazyParam* param, bool load) const;
+  /*! \return The lazy parameters that an operator reads and are not settled yet. */
+  std::vector<LazyParam*> PendingLazyInputs(uint32_t nid) const;
+  /*!
+   * \brief Build the dependencies between operators. Besides data flow, an
+   *  operator waits for the earlier users of the storage it writes, so the
+   *  schedule is safe for any storage plan.
+   */
+  void SetupOpDependencies();
   /*!
    * \brief Create an execution function given input.
    * \param attrs The node attributes.
@@ -407,6 +495,35 @@ class TVM_DLL GraphRuntime : public ModuleNode {
   std::vector<size_t> data_alignment_;
   /*! \brief Operator on each node. */
   std::vector<std::function<void()>> op_execs_;
+  /*! \brief Operators that depend on each node. */
+  std::vector<std::vector<uint32_t>> op_successors_;
+  /*! \brief Number of operators each node depends on. */
+  std::vector<uint32_t> op_num_predecessors_;
+  /*! \brief Executor of inter-operator parallel runs, null when running sequentially. */
+  std::unique_ptr<InterOpExecutor> inter_op_executor_;
+  /*! \brief A direct call to a compiled function. */
+  struct FrozenOp {
+    /*! \brief The function, nullptr to call op_execs_[nid] instead. */
+    TVMBackendPackedCFunc faddr;
+    TVMValue* arg_values;
+    int* arg_tcodes;
+    int num_args;
+    uint32_t nid;
+    /*! \brief Whether the operator is small enough to run without the thread pool. */
+    bool serial;
+  };
+  /*! \brief Arguments of each node, kept alive for the frozen calls. */
+  std::vector<std::shared_ptr<OpArgs>> op_args_;
+  /*! \brief The frozen operator sequence, empty when not frozen. */
+  std::vector<FrozenOp> frozen_ops_;
+  /*! \brief Whether Freeze was called, so that SetupOpExecs freezes again. */
+  bool frozen_{false};
+  /*! \brief The small operator threshold of Freeze. */
+  size_t small_op_bytes_{0};
+  /*! \brief The parameters loaded lazily, by entry id. */
+  std::map<uint32_t, std::unique_ptr<LazyParam>> lazy_params_;
+  /*! \brief The tracer of sampled runs, null when tracing is off. */
+  std::unique_ptr<GraphTracer> tracer_;
 };
 
 std::vector<TVMContext> GetAllContext(const TVMArgs& args);
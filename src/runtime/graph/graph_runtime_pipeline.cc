@@ -0,0 +1,280 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file graph_runtime_pipeline.cc
+ * \brief Serve concurrent requests with several execution contexts of one graph.
+ */
+#include <tvm/runtime/container.h>
+#include <tvm/runtime/ndarray.h>
+#include <tvm/runtime/packed_func.h>
+#include <tvm/runtime/registry.h>
+#include <tvm/runtime/threading_backend.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "graph_runtime.h"
+
+namespace tvm {
+namespace runtime {
+
+/*!
+ * \brief Runs submitted requests on a fixed set of graph execution contexts.
+ *
+ *  Every context is a GraphRuntime with its own activations, served by its own
+ *  thread whose thread pool is pinned to its own slice of the cores. The
+ *  parameters are loaded once and shared by all contexts. While one context
+ *  computes, the others copy the inputs of the next requests in and the
+ *  outputs of finished ones out, so requests overlap end to end.
+ */
+class GraphRuntimePipeline : public ModuleNode {
+ public:
+  const char* type_key() const final { return "GraphRuntimePipeline"; }
+
+  /*!
+   * \brief Initialize the pipeline.
+   * \param graph_json The execution graph.
+   * \param module The module containing the compiled functions.
+   * \param ctxs The contexts of the host and devices.
+   * \param num_contexts The number of requests that can be in flight.
+   * \param threads_per_request The number of tasks each operator of a request
+   *  may parallelize over, 0 divides the cores among the contexts.
+   */
+  void Init(const std::string& graph_json, Module module, const std::vector<TVMContext>& ctxs,
+            int num_contexts, int threads_per_request) {
+    CHECK_GE(num_contexts, 1) << "num_contexts must be positive";
+    CHECK_GE(threads_per_request, 0) << "threads_per_request must be non-negative";
+    if (threads_per_request == 0) {
+      threads_per_request = std::max(1, threading::MaxConcurrency() / num_contexts);
+    }
+    for (int i = 0; i < num_contexts; ++i) {
+      auto exec = make_object<GraphRuntime>();
+      exec->Init(graph_json, module, ctxs);
+      contexts_.push_back(exec.get());
+      modules_.emplace_back(exec);
+    }
+    for (int i = 0; i < num_contexts; ++i) {
+      threads_.emplace_back([this, i, num_contexts, threads_per_request]() {
+        threading::ConfigureThreadPoolCoreSlice(i, num_contexts);
+        threading::SetMaxParallelTasks(threads_per_request);
+        this->ContextLoop(contexts_[i]);
+      });
+    }
+  }
+
+  ~GraphRuntimePipeline() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      exit_now_ = true;
+    }
+    queue_cv_.notify_all();
+    for (auto& t : threads_) t.join();
+  }
+
+  /*!
+   * \brief Load parameters into the first context and share them with the others.
+   * \param param_blob A binary blob of parameters.
+   */
+  void LoadParams(const std::string& param_blob) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    CHECK_EQ(num_running_, 0) << "Cannot load parameters while requests are running";
+    contexts_[0]->LoadParams(param_blob);
+    // Once shared, the parameters are updated in place for all contexts.
+    if (params_shared_) return;
+    for (size_t i = 1; i < contexts_.size(); ++i) {
+      dmlc::MemoryStringStream strm(const_cast<std::string*>(&param_blob));
+      contexts_[i]->ShareParams(*contexts_[0], &strm);
+    }
+    params_shared_ = true;
+  }
+
+  /*!
+   * \brief Queue a request.
+   * \param inputs The inputs, indexed by input index.
+   * \return The ticket to wait for the outputs with.
+   */
+  int64_t Submit(std::vector<std::pair<int, NDArray>> inputs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t ticket = next_ticket_++;
+    queue_.push_back(Request{ticket, std::move(inputs)});
+    results_[ticket];
+    queue_cv_.notify_one();
+    return ticket;
+  }
+
+  /*!
+   * \brief Wait for a request to finish.
+   * \param ticket The ticket returned by Submit.
+   * \return The outputs of the request.
+   */
+  ADT Wait(int64_t ticket) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    CHECK(results_.count(ticket)) << "Unknown or already collected request " << ticket;
+    done_cv_.wait(lock, [this, ticket]() {
+      auto it = results_.find(ticket);
+      return it == results_.end() || it->second.done;
+    });
+    auto it = results_.find(ticket);
+    CHECK(it != results_.end()) << "Request " << ticket << " was collected by another caller";
+    Result result = std::move(it->second);
+    results_.erase(it);
+    lock.unlock();
+    if (!result.error.empty()) {
+      LOG(FATAL) << result.error;
+    }
+    return ADT::Tuple(result.outputs);
+  }
+
+  /*!
+   * \brief Get the input index given the name of input.
+   * \param name The name of the input.
+   * \return The index of input, -1 if not found.
+   */
+  int GetInputIndex(const std::string& name) { return contexts_[0]->GetInputIndex(name); }
+
+  PackedFunc GetFunction(const std::string& name, const ObjectPtr<Object>& sptr_to_self) final {
+    if (name == "submit") {
+      // Either submit(input0, input1, ...) or submit(name0, value0, name1, value1, ...).
+      return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+        std::vector<std::pair<int, NDArray>> inputs;
+        if (args.num_args > 0 && String::CanConvertFrom(args[0])) {
+          CHECK_EQ(args.num_args % 2, 0) << "submit expects name and value pairs";
+          for (int i = 0; i < args.num_args; i += 2) {
+            int in_idx = this->GetInputIndex(args[i].operator String());
+            if (in_idx >= 0) inputs.emplace_back(in_idx, args[i + 1].operator NDArray());
+          }
+        } else {
+          for (int i = 0; i < args.num_args; ++i) {
+            inputs.emplace_back(i, args[i].operator NDArray());
+          }
+        }
+        *rv = this->Submit(std::move(inputs));
+      });
+    } else if (name == "wait") {
+      return PackedFunc(
+          [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { *rv = this->Wait(args[0]); });
+    } else if (name == "load_params") {
+      return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+        this->LoadParams(args[0].operator std::string());
+      });
+    } else if (name == "get_num_contexts") {
+      return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+        *rv = static_cast<int>(contexts_.size());
+      });
+    } else if (name == "get_input_index") {
+      return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+        *rv = this->GetInputIndex(args[0].operator String());
+      });
+    } else {
+      return PackedFunc();
+    }
+  }
+
+ private:
+  struct Request {
+    int64_t ticket;
+    std::vector<std::pair<int, NDArray>> inputs;
+  };
+  struct Result {
+    bool done{false};
+    std::vector<ObjectRef> outputs;
+    std::string error;
+  };
+
+  void ContextLoop(GraphRuntime* exec) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      queue_cv_.wait(lock, [this]() { return exit_now_ || !queue_.empty(); });
+      if (exit_now_) return;
+      Request request = std::move(queue_.front());
+      queue_.pop_front();
+      ++num_running_;
+      lock.unlock();
+      Result result;
+      try {
+        for (auto& input : request.inputs) {
+          exec->SetInput(input.first, const_cast<DLTensor*>(input.second.operator->()));
+        }
+        // release the caller's inputs as soon as they are copied.
+        request.inputs.clear();
+        exec->Run();
+        // copy the outputs out so that the context can take the next request.
+        for (int i = 0; i < exec->NumOutputs(); ++i) {
+          NDArray out = exec->GetOutput(i);
+          std::vector<int64_t> shape(out->shape, out->shape + out->ndim);
+          NDArray copy = NDArray::Empty(shape, out->dtype, out->ctx);
+          copy.CopyFrom(out);
+          result.outputs.push_back(copy);
+        }
+      } catch (const std::exception& e) {
+        result.error = e.what();
+      }
+      result.done = true;
+      lock.lock();
+      --num_running_;
+      results_[request.ticket] = std::move(result);
+      done_cv_.notify_all();
+    }
+  }
+
+  /*! \brief The execution contexts, owned by modules_. */
+  std::vector<GraphRuntime*> contexts_;
+  std::vector<Module> modules_;
+  std::vector<std::thread> threads_;
+  // the state below is guarded by mutex_
+  std::mutex mutex_;
+  std::condition_variable queue_cv_;
+  std::condition_variable done_cv_;
+  std::deque<Request> queue_;
+  std::unordered_map<int64_t, Result> results_;
+  int64_t next_ticket_{0};
+  int num_running_{0};
+  bool params_shared_{false};
+  bool exit_now_{false};
+};
+
+// Arguments: graph_json, module, num_contexts, threads_per_request, then the
+// device type and id of each context as in tvm.graph_runtime.create.
+TVM_REGISTER_GLOBAL("tvm.graph_runtime.create_pipeline")
+    .set_body([](TVMArgs args, TVMRetValue* rv) {
+      CHECK_GE(args.num_args, 6) << "The expected number of arguments for "
+                                    "graph_runtime.create_pipeline is at least 6, but it has "
+                                 << args.num_args;
+      std::vector<TVMContext> ctxs;
+      for (int i = 4; i + 1 < args.num_args; i += 2) {
+        TVMContext ctx;
+        ctx.device_type = static_cast<DLDeviceType>(args[i].operator int());
+        ctx.device_id = args[i + 1];
+        ctxs.push_back(ctx);
+      }
+      auto exec = make_object<GraphRuntimePipeline>();
+      exec->Init(args[0], args[1], ctxs, args[2], args[3]);
+      *rv = Module(exec);
+    });
+}  // namespace runtime
+}  // namespace tvm
@@ -0,0 +1,168 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file graph_tracer.cc
+ * \brief Sampling tracer of operator execution in the graph runtime.
+ */
+#include "graph_tracer.h"
+
+#include <dmlc/logging.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+
+namespace tvm {
+namespace runtime {
+
+namespace {
+// A small id of the calling thread for the trace.
+uint32_t TraceThreadId() {
+  static std::atomic<uint32_t> next_id{0};
+  static thread_local uint32_t id = next_id.fetch_add(1);
+  return id;
+}
+
+// Write a string as a JSON string literal.
+void WriteJSONString(std::ostream& os, const std::string& s) {
+  os << '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\') {
+      os << '\\' << c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      os << ' ';
+    } else {
+      os << c;
+    }
+  }
+  os << '"';
+}
+}  // namespace
+
+GraphTracer::GraphTracer(std::vector<std::string> node_names, uint64_t sample_period,
+                         size_t capacity)
+    : node_names_(std::move(node_names)),
+      sample_period_(sample_period),
+      capacity_(capacity),
+      events_(new Event[capacity]),
+      node_stats_(new NodeStats[node_names_.size()]) {
+  CHECK_GT(sample_period_, 0U) << "sample_period must be positive";
+  CHECK_GT(capacity_, 0U) << "The trace capacity must be positive";
+}
+
+void GraphTracer::Record(int64_t run, uint32_t nid, int64_t start_ns, int64_t end_ns) {
+  uint64_t index = num_events_.fetch_add(1, std::memory_order_relaxed);
+  Event& e = events_[index % capacity_];
+  e.seq.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  e.run.store(run, std::memory_order_relaxed);
+  e.start_ns.store(start_ns, std::memory_order_relaxed);
+  e.end_ns.store(end_ns, std::memory_order_relaxed);
+  e.nid.store(nid, std::memory_order_relaxed);
+  e.tid.store(TraceThreadId(), std::memory_order_relaxed);
+  e.seq.store(2 * index + 2, std::memory_order_release);
+
+  NodeStats& stats = node_stats_[nid];
+  uint64_t duration = static_cast<uint64_t>(std::max<int64_t>(end_ns - start_ns, 0));
+  int bucket = 0;
+  while (bucket + 1 < kNumBuckets && (duration >> (bucket + 1)) != 0) ++bucket;
+  stats.count.fetch_add(1, std::memory_order_relaxed);
+  stats.total_ns.fetch_add(duration, std::memory_order_relaxed);
+  stats.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+  uint64_t max_ns = stats.max_ns.load(std::memory_order_relaxed);
+  while (duration > max_ns &&
+         !stats.max_ns.compare_exchange_weak(max_ns, duration, std::memory_order_relaxed)) {
+  }
+}
+
+std::string GraphTracer::ChromeTrace() const {
+  uint64_t end = num_events_.load(std::memory_order_acquire);
+  uint64_t begin = end > capacity_ ? end - capacity_ : 0;
+  std::ostringstream os;
+  // timestamps are in microseconds, keep the nanoseconds.
+  os << std::fixed << std::setprecision(3);
+  os << "{\"traceEvents\": [";
+  bool first = true;
+  for (uint64_t index = begin; index < end; ++index) {
+    const Event& e = events_[index % capacity_];
+    uint64_t seq = e.seq.load(std::memory_order_acquire);
+    int64_t run = e.run.load(std::memory_order_relaxed);
+    int64_t start_ns = e.start_ns.load(std::memory_order_relaxed);
+    int64_t end_ns = e.end_ns.load(std::memory_order_relaxed);
+    uint32_t nid = e.nid.load(std::memory_order_relaxed);
+    uint32_t tid = e.tid.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // skip events that are being written or were overwritten meanwhile.
+    if (seq != 2 * index + 2 || e.seq.load(std::memory_order_relaxed) != seq) continue;
+    if (!first) os << ", ";
+    first = false;
+    os << "{\"name\": ";
+    WriteJSONString(os, node_names_[nid]);
+    os << ", \"cat\": \"op\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << tid
+       << ", \"ts\": " << start_ns / 1000.0 << ", \"dur\": " << (end_ns - start_ns) / 1000.0
+       << ", \"args\": {\"nid\": " << nid << ", \"run\": " << run << "}}";
+  }
+  os << "], \"displayTimeUnit\": \"ns\"}";
+  return os.str();
+}
+
+std::string GraphTracer::Histograms() const {
+  std::ostringstream os;
+  os << "{\"num_runs\": " << num_runs_.load() << ", \"sample_period\": " << sample_period_
+     << ", \"bucket_unit\": \"log2_ns\", \"nodes\": [";
+  bool first = true;
+  for (size_t nid = 0; nid < node_names_.size(); ++nid) {
+    const NodeStats& stats = node_stats_[nid];
+    uint64_t count = stats.count.load(std::memory_order_relaxed);
+    if (count == 0) continue;
+    if (!first) os << ", ";
+    first = false;
+    os << "{\"nid\": " << nid << ", \"name\": ";
+    WriteJSONString(os, node_names_[nid]);
+    os << ", \"count\": " << count << ", \"total_ns\": " << stats.total_ns.load()
+       << ", \"max_ns\": " << stats.max_ns.load() << ", \"buckets\": [";
+    for (int b = 0; b < kNumBuckets; ++b) {
+      if (b != 0) os << ", ";
+      os << stats.buckets[b].load(std::memory_order_relaxed);
+    }
+    os << "]}";
+  }
+  os << "]}";
+  return os.str();
+}
+
+void GraphTracer::Reset() {
+  uint64_t end = num_events_.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < capacity_ && i < end; ++i) {
+    events_[i].seq.store(0, std::memory_order_relaxed);
+  }
+  num_events_.store(0, std::memory_order_release);
+  for (size_t nid = 0; nid < node_names_.size(); ++nid) {
+    NodeStats& stats = node_stats_[nid];
+    stats.count.store(0, std::memory_order_relaxed);
+    stats.total_ns.store(0, std::memory_order_relaxed);
+    stats.max_ns.store(0, std::memory_order_relaxed);
+    for (auto& b : stats.buckets) b.store(0, std::memory_order_relaxed);
+  }
+}
+
+}  // namespace runtime
+}  // namespace tvm
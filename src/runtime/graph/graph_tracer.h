@@ -0,0 +1,131 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file graph_tracer.h
+ * \brief Sampling tracer of operator execution in the graph runtime.
+ */
+#ifndef TVM_RUNTIME_GRAPH_GRAPH_TRACER_H_
+#define TVM_RUNTIME_GRAPH_GRAPH_TRACER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+
+/*!
+ * \brief Records when the operators of sampled runs start and end.
+ *
+ *  One run in sample_period is traced. Events go to a fixed size ring buffer
+ *  that writers claim slots of with a single atomic increment, so tracing never
+ *  blocks a run and the newest events overwrite the oldest. Per node duration
+ *  histograms accumulate over all sampled runs.
+ *
+ *  Operators on devices other than the CPU are asynchronous, their events
+ *  cover the kernel launch only.
+ */
+class GraphTracer {
+ public:
+  /*! \brief Number of histogram buckets, bucket i holds durations in [2^i, 2^(i+1)) ns. */
+  static constexpr int kNumBuckets = 40;
+
+  /*!
+   * \param node_names The name of each node of the graph.
+   * \param sample_period Trace one run in this many.
+   * \param capacity The number of events kept.
+   */
+  GraphTracer(std::vector<std::string> node_names, uint64_t sample_period, size_t capacity);
+
+  /*!
+   * \brief Decide whether to trace the run that is starting.
+   * \return The run id when traced, -1 otherwise.
+   */
+  int64_t BeginRun() {
+    uint64_t run = num_runs_.fetch_add(1, std::memory_order_relaxed);
+    if (run % sample_period_ != 0) return -1;
+    return static_cast<int64_t>(run);
+  }
+
+  /*! \return The current time in nanoseconds. */
+  static int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  /*!
+   * \brief Record the execution of an operator.
+   * \param run The run id returned by BeginRun.
+   * \param nid The node id.
+   * \param start_ns The start time.
+   * \param end_ns The end time.
+   */
+  void Record(int64_t run, uint32_t nid, int64_t start_ns, int64_t end_ns);
+
+  /*! \return The buffered events in the Chrome trace event format, which Perfetto reads too. */
+  std::string ChromeTrace() const;
+
+  /*! \return The per node duration histograms as JSON. */
+  std::string Histograms() const;
+
+  /*! \brief Drop the buffered events and histograms. */
+  void Reset();
+
+ private:
+  /*!
+   * \brief A buffered event. seq is odd while the slot is written and
+   *  2 * (index + 1) once event index is complete, so readers can skip slots
+   *  that are torn or overwritten.
+   */
+  struct Event {
+    std::atomic<uint64_t> seq{0};
+    std::atomic<int64_t> run{0};
+    std::atomic<int64_t> start_ns{0};
+    std::atomic<int64_t> end_ns{0};
+    std::atomic<uint32_t> nid{0};
+    std::atomic<uint32_t> tid{0};
+  };
+  struct NodeStats {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+    std::atomic<uint64_t> buckets[kNumBuckets];
+    NodeStats() {
+      for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+    }
+  };
+
+  std::vector<std::string> node_names_;
+  uint64_t sample_period_;
+  size_t capacity_;
+  std::atomic<uint64_t> num_runs_{0};
+  std::atomic<uint64_t> num_events_{0};
+  std::unique_ptr<Event[]> events_;
+  std::unique_ptr<NodeStats[]> node_stats_;
+};
+
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_RUNTIME_GRAPH_GRAPH_TRACER_H_
@@ -69,8 +69,12 @@ class ModuleInternal {
   static std::vector<Module>* GetImportsAddr(ModuleNode* node) { return &(node->imports_); }
 };
 
-PackedFunc WrapPackedFunc(TVMBackendPackedCFunc faddr, const ObjectPtr<Object>& sptr_to_self) {
-  return PackedFunc([faddr, sptr_to_self](TVMArgs args, TVMRetValue* rv) {
+// A named functor, so that GetWrappedPackedCFunc can recover the address.
+struct PackedCFuncWrapper {
+  TVMBackendPackedCFunc faddr;
+  ObjectPtr<Object> sptr_to_self;
+
+  void operator()(TVMArgs args, TVMRetValue* rv) const {
     TVMValue ret_value;
     int ret_type_code = kTVMNullptr;
     int ret = (*faddr)(const_cast<TVMValue*>(args.values), const_cast<int*>(args.type_codes),
@@ -79,7 +83,17 @@ PackedFunc WrapPackedFunc(TVMBackendPackedCFunc faddr, const ObjectPtr<Object>&
     if (ret_type_code != kTVMNullptr) {
       *rv = TVMRetValue::MoveFromCHost(ret_value, ret_type_code);
     }
-  });
+  }
+};
+
+PackedFunc WrapPackedFunc(TVMBackendPackedCFunc faddr, const ObjectPtr<Object>& sptr_to_self) {
+  return PackedFunc(PackedCFuncWrapper{faddr, sptr_to_self});
+}
+
+TVMBackendPackedCFunc GetWrappedPackedCFunc(const PackedFunc& pf) {
+  PackedFunc::FType body = pf.body();
+  const PackedCFuncWrapper* wrapper = body.target<PackedCFuncWrapper>();
+  return wrapper == nullptr ? nullptr : wrapper->faddr;
 }
 
 void InitContextFunctions(std::function<void*(const char*)> fgetsymbol) {
@@ -60,6 +60,15 @@ class Library : public Object {
  */
 PackedFunc WrapPackedFunc(TVMBackendPackedCFunc faddr, const ObjectPtr<Object>& mptr);
 
+/*!
+ * \brief Get the function address wrapped by WrapPackedFunc.
+ *  Callers can then invoke the function without going through PackedFunc,
+ *  as long as they keep the module alive.
+ * \param pf The packed function.
+ * \return The function address, nullptr if pf was not created by WrapPackedFunc.
+ */
+TVMBackendPackedCFunc GetWrappedPackedCFunc(const PackedFunc& pf);
+
 /*!
  * \brief Utility to initialize conext function symbols during startup
  * \param fgetsymbol A symbol lookup function.
@@ -0,0 +1,257 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file param_file.cc
+ * \brief A parameter file format that can be memory mapped.
+ */
+#include "param_file.h"
+
+#include <dmlc/logging.h>
+#include <tvm/runtime/container.h>
+#include <tvm/runtime/device_api.h>
+#include <tvm/runtime/registry.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+namespace tvm {
+namespace runtime {
+
+namespace {
+/*! \brief The contents of a parameter file, shared by the arrays viewing it. */
+class ParamFileMapping {
+ public:
+  explicit ParamFileMapping(const std::string& path) {
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    CHECK_GE(fd, 0) << "Cannot open parameter file " << path << ": " << strerror(errno);
+    struct stat st;
+    CHECK_EQ(fstat(fd, &st), 0) << "Cannot stat parameter file " << path;
+    size_ = static_cast<size_t>(st.st_size);
+    if (size_ != 0) {
+      // A private writable mapping shares the clean pages with other processes,
+      // and a write to a parameter copies the page instead of changing the file.
+      void* addr = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+      CHECK(addr != MAP_FAILED) << "Cannot map parameter file " << path << ": " << strerror(errno);
+      data_ = static_cast<char*>(addr);
+    }
+    close(fd);
+#else
+    std::ifstream fs(path, std::ios::in | std::ios::binary);
+    CHECK(!fs.fail()) << "Cannot open parameter file " << path;
+    fs.seekg(0, std::ios::end);
+    size_ = static_cast<size_t>(fs.tellg());
+    fs.seekg(0, std::ios::beg);
+    buffer_.reset(new char[size_ + kAllocAlignment]);
+    data_ = buffer_.get() + kAllocAlignment -
+            reinterpret_cast<uintptr_t>(buffer_.get()) % kAllocAlignment;
+    fs.read(data_, size_);
+#endif
+  }
+
+  ~ParamFileMapping() {
+#ifndef _WIN32
+    if (data_ != nullptr) munmap(data_, size_);
+#endif
+  }
+
+  char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  char* data_{nullptr};
+  size_t size_{0};
+#ifdef _WIN32
+  std::unique_ptr<char[]> buffer_;
+#endif
+};
+
+/*! \brief Reads the table of a parameter file with bounds checks. */
+class TableReader {
+ public:
+  TableReader(const char* data, size_t size) : data_(data), size_(size) {}
+
+  template <typename T>
+  T Read() {
+    CHECK_LE(sizeof(T), size_ - pos_) << "Invalid parameter file, the table is truncated";
+    T value;
+    std::memcpy(&value, data_ + pos_, sizeof(T));
+    pos_ += sizeof(T);
+    return value;
+  }
+
+  std::string ReadString() {
+    uint64_t len = Read<uint64_t>();
+    CHECK_LE(len, size_ - pos_) << "Invalid parameter file, the table is truncated";
+    std::string s(data_ + pos_, len);
+    pos_ += len;
+    return s;
+  }
+
+ private:
+  const char* data_;
+  size_t size_;
+  size_t pos_{0};
+};
+
+template <typename T>
+void Append(std::string* out, T value) {
+  out->append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void ParamFileArrayDeleter(Object* obj) {
+  auto* ptr = static_cast<NDArray::Container*>(obj);
+  delete static_cast<std::shared_ptr<ParamFileMapping>*>(ptr->manager_ctx);
+  delete ptr;
+}
+}  // namespace
+
+void SaveParamFile(const std::string& path,
+                   const std::vector<std::pair<std::string, NDArray>>& params) {
+  CHECK(DMLC_IO_NO_ENDIAN_SWAP) << "Parameter files are only written on little endian hosts";
+  const uint64_t alignment = kAllocAlignment;
+  // the table size is needed for the data offsets, so build it in two passes.
+  std::string table;
+  std::vector<uint64_t> offsets(params.size());
+  for (int pass = 0; pass < 2; ++pass) {
+    uint64_t offset = 4 * sizeof(uint64_t) + table.size();
+    table.clear();
+    for (size_t i = 0; i < params.size(); ++i) {
+      const DLTensor* t = params[i].second.operator->();
+      CHECK(t->strides == nullptr) << "Can only save compact parameters";
+      uint64_t nbytes = GetDataSize(*t);
+      offset = (offset + alignment - 1) / alignment * alignment;
+      offsets[i] = offset;
+      offset += nbytes;
+      Append<uint64_t>(&table, params[i].first.size());
+      table += params[i].first;
+      Append<uint8_t>(&table, t->dtype.code);
+      Append<uint8_t>(&table, t->dtype.bits);
+      Append<uint16_t>(&table, t->dtype.lanes);
+      Append<uint32_t>(&table, static_cast<uint32_t>(t->ndim));
+      for (int d = 0; d < t->ndim; ++d) {
+        Append<int64_t>(&table, t->shape[d]);
+      }
+      Append<uint64_t>(&table, offsets[i]);
+      Append<uint64_t>(&table, nbytes);
+    }
+  }
+  // Write next to the file and replace it at the end, since the arrays may be views over a
+  // mapping of the file being replaced.
+  std::string tmp_path = path + ".tmp";
+  std::ofstream fs(tmp_path, std::ios::out | std::ios::binary);
+  CHECK(!fs.fail()) << "Cannot open " << tmp_path;
+  std::string header;
+  Append<uint64_t>(&header, kTVMParamFileMagic);
+  Append<uint64_t>(&header, kTVMParamFileVersion);
+  Append<uint64_t>(&header, alignment);
+  Append<uint64_t>(&header, params.size());
+  fs.write(header.data(), header.size());
+  fs.write(table.data(), table.size());
+  uint64_t pos = header.size() + table.size();
+  std::vector<char> buffer;
+  for (size_t i = 0; i < params.size(); ++i) {
+    const NDArray& arr = params[i].second;
+    buffer.assign(offsets[i] - pos, 0);
+    fs.write(buffer.data(), buffer.size());
+    buffer.resize(GetDataSize(*arr.operator->()));
+    arr.CopyToBytes(buffer.data(), buffer.size());
+    fs.write(buffer.data(), buffer.size());
+    pos = offsets[i] + buffer.size();
+  }
+  fs.close();
+  CHECK(fs.good()) << "Failed to write " << tmp_path;
+#ifdef _WIN32
+  std::remove(path.c_str());
+#endif
+  CHECK_EQ(std::rename(tmp_path.c_str(), path.c_str()), 0)
+      << "Cannot replace " << path << ": " << strerror(errno);
+}
+
+std::vector<std::pair<std::string, NDArray>> LoadParamFile(const std::string& path) {
+  CHECK(DMLC_IO_NO_ENDIAN_SWAP) << "Parameter files are only read on little endian hosts";
+  auto mapping = std::make_shared<ParamFileMapping>(path);
+  TableReader reader(mapping->data(), mapping->size());
+  CHECK_EQ(reader.Read<uint64_t>(), kTVMParamFileMagic) << "Invalid parameter file " << path;
+  uint64_t version = reader.Read<uint64_t>();
+  CHECK_EQ(version, kTVMParamFileVersion) << "Unsupported parameter file version " << version;
+  uint64_t alignment = reader.Read<uint64_t>();
+  CHECK(alignment != 0 && alignment % kAllocAlignment == 0)
+      << "Invalid parameter file alignment " << alignment;
+  uint64_t num_params = reader.Read<uint64_t>();
+  std::vector<std::pair<std::string, NDArray>> params;
+  for (uint64_t i = 0; i < num_params; ++i) {
+    std::string name = reader.ReadString();
+    DLDataType dtype;
+    dtype.code = reader.Read<uint8_t>();
+    dtype.bits = reader.Read<uint8_t>();
+    dtype.lanes = reader.Read<uint16_t>();
+    uint32_t ndim = reader.Read<uint32_t>();
+    std::vector<int64_t> shape;
+    for (uint32_t d = 0; d < ndim; ++d) {
+      shape.push_back(reader.Read<int64_t>());
+    }
+    uint64_t offset = reader.Read<uint64_t>();
+    uint64_t nbytes = reader.Read<uint64_t>();
+    CHECK_EQ(offset % alignment, 0U) << "Invalid parameter file, " << name << " is misaligned";
+    CHECK(offset <= mapping->size() && nbytes <= mapping->size() - offset)
+        << "Invalid parameter file, the data of " << name << " is truncated";
+    auto* data = new NDArray::Container(mapping->data() + offset, std::move(shape), dtype,
+                                        DLContext{kDLCPU, 0});
+    data->manager_ctx = new std::shared_ptr<ParamFileMapping>(mapping);
+    data->SetDeleter(ParamFileArrayDeleter);
+    NDArray arr(GetObjectPtr<Object>(data));
+    CHECK_EQ(GetDataSize(*arr.operator->()), nbytes)
+        << "Invalid parameter file, the size of " << name << " does not match its shape";
+    params.emplace_back(std::move(name), std::move(arr));
+  }
+  return params;
+}
+
+TVM_REGISTER_GLOBAL("runtime.SaveParamFile").set_body([](TVMArgs args, TVMRetValue* rv) {
+  CHECK_EQ(args.size() % 2, 1) << "Expect the path followed by pairs of name and array";
+  std::vector<std::pair<std::string, NDArray>> params;
+  for (int i = 1; i < args.size(); i += 2) {
+    params.emplace_back(args[i].operator std::string(), args[i + 1].operator NDArray());
+  }
+  SaveParamFile(args[0], params);
+});
+
+TVM_REGISTER_GLOBAL("runtime.LoadParamFile").set_body_typed([](std::string path) {
+  Array<ObjectRef> ret;
+  for (auto& kv : LoadParamFile(path)) {
+    ret.push_back(String(kv.first));
+    ret.push_back(kv.second);
+  }
+  return ret;
+});
+
+}  // namespace runtime
+}  // namespace tvm
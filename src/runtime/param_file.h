@@ -0,0 +1,74 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file param_file.h
+ * \brief A parameter file format that can be memory mapped.
+ *
+ *  Unlike the serialized parameter dict, whose tensors have to be
+ *  deserialized into new arrays, the tensors of a parameter file are aligned
+ *  in the file and loaded as views over a mapping of it. Processes loading
+ *  the same file share its pages through the page cache.
+ *
+ *  Layout, all integers little endian:
+ *
+ *    uint64 magic, uint64 version, uint64 alignment, uint64 num_params
+ *    num_params entries of
+ *      uint64 name length, name bytes,
+ *      uint8 dtype code, uint8 dtype bits, uint16 dtype lanes, uint32 ndim,
+ *      int64 shape[ndim], uint64 data offset from the file start, uint64 data bytes
+ *    the tensor data, each at an offset that is a multiple of alignment
+ */
+#ifndef TVM_RUNTIME_PARAM_FILE_H_
+#define TVM_RUNTIME_PARAM_FILE_H_
+
+#include <tvm/runtime/ndarray.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+
+/*! \brief Magic number of parameter files. */
+constexpr uint64_t kTVMParamFileMagic = 0xF7E58D4F05049CB9;
+/*! \brief Version of the parameter file format. */
+constexpr uint64_t kTVMParamFileVersion = 1;
+
+/*!
+ * \brief Save parameters to a parameter file.
+ * \param path The file path.
+ * \param params The names and the arrays, which may be on any device.
+ */
+void SaveParamFile(const std::string& path,
+                   const std::vector<std::pair<std::string, NDArray>>& params);
+
+/*!
+ * \brief Load the parameters of a parameter file.
+ * \param path The file path.
+ * \return The names and CPU arrays viewing a private mapping of the file,
+ *  the mapping lives as long as any of the arrays.
+ */
+std::vector<std::pair<std::string, NDArray>> LoadParamFile(const std::string& path);
+
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_RUNTIME_PARAM_FILE_H_
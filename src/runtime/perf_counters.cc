@@ -0,0 +1,201 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file perf_counters.cc
+ * \brief Hardware performance counters of the debug runtimes.
+ */
+#include "perf_counters.h"
+
+#include <dmlc/logging.h>
+#include <tvm/runtime/c_backend_api.h>
+
+#if defined(__linux__)
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+namespace tvm {
+namespace runtime {
+
+#if defined(__linux__)
+namespace {
+std::vector<pid_t> ListThreads() {
+  std::vector<pid_t> tids;
+  DIR* dir = opendir("/proc/self/task");
+  if (dir == nullptr) return tids;
+  while (dirent* entry = readdir(dir)) {
+    if (entry->d_name[0] == '.') continue;
+    tids.push_back(static_cast<pid_t>(std::atoi(entry->d_name)));
+  }
+  closedir(dir);
+  return tids;
+}
+
+int OpenCounter(PerfEvent event, pid_t tid) {
+  static const uint64_t configs[kNumPerfEvents] = {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+      PERF_COUNT_HW_BRANCH_MISSES};
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = configs[event];
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  // scale the counts when the kernel multiplexes the counters.
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(__NR_perf_event_open, &attr, tid, -1, -1, 0));
+}
+}  // namespace
+
+bool PerfCounters::Open(std::string* error) {
+  Close();
+  // start the thread pool, threads created later are not counted.
+  TVMBackendParallelLaunch([](int task_id, TVMParallelGroupEnv* penv, void* cdata) { return 0; },
+                           nullptr, 0);
+  std::vector<pid_t> tids = ListThreads();
+  if (tids.empty()) {
+    *error = "cannot list the threads of the process";
+    return false;
+  }
+  for (int event = 0; event < kNumPerfEvents; ++event) {
+    for (pid_t tid : tids) {
+      int fd = OpenCounter(static_cast<PerfEvent>(event), tid);
+      if (fd < 0) {
+        if (event == kPerfCycles && tid == tids[0]) {
+          *error = std::string("perf_event_open failed: ") + std::strerror(errno);
+          return false;
+        }
+        continue;
+      }
+      supported_[event] = true;
+      fds_.emplace_back(static_cast<PerfEvent>(event), fd);
+    }
+  }
+  return true;
+}
+
+void PerfCounters::Close() {
+  for (const auto& kv : fds_) {
+    close(kv.second);
+  }
+  fds_.clear();
+  for (bool& s : supported_) s = false;
+}
+
+void PerfCounters::Start() {
+  for (const auto& kv : fds_) {
+    ioctl(kv.second, PERF_EVENT_IOC_RESET, 0);
+    ioctl(kv.second, PERF_EVENT_IOC_ENABLE, 0);
+  }
+}
+
+void PerfCounters::Stop(PerfCounterStats* stats) {
+  for (const auto& kv : fds_) {
+    ioctl(kv.second, PERF_EVENT_IOC_DISABLE, 0);
+  }
+  for (int event = 0; event < kNumPerfEvents; ++event) {
+    if (!supported_[event]) stats->counts[event] = -1;
+  }
+  for (const auto& kv : fds_) {
+    // value, time enabled, time running.
+    uint64_t data[3];
+    if (read(kv.second, data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) continue;
+    uint64_t value = data[0];
+    if (data[2] != 0 && data[2] < data[1]) {
+      value = static_cast<uint64_t>(static_cast<double>(value) * data[1] / data[2]);
+    }
+    stats->counts[kv.first] += static_cast<int64_t>(value);
+  }
+  stats->calls += 1;
+}
+#else
+bool PerfCounters::Open(std::string* error) {
+  *error = "hardware performance counters are only supported on Linux";
+  return false;
+}
+
+void PerfCounters::Close() {}
+
+void PerfCounters::Start() {}
+
+void PerfCounters::Stop(PerfCounterStats* stats) {}
+#endif
+
+std::string FormatPerfCounterReport(
+    const std::vector<std::pair<std::string, PerfCounterStats>>& rows) {
+  std::ostringstream os;
+  os << std::setw(30) << std::left << "#OpName"
+     << "\t#Calls\t#Cycles\t#Instructions\t#IPC\t#LLCMisses\t#BranchMisses\t#Bytes\t#FLOP"
+     << "\t#Bytes/FLOP" << std::endl;
+  auto per_call = [](const PerfCounterStats& s, PerfEvent event) {
+    return static_cast<double>(s.counts[event]) / s.calls;
+  };
+  for (const auto& kv : rows) {
+    const PerfCounterStats& s = kv.second;
+    if (s.calls == 0) continue;
+    os << std::setw(30) << std::left << kv.first << "\t" << s.calls;
+    for (PerfEvent event : {kPerfCycles, kPerfInstructions}) {
+      os << "\t";
+      if (s.counts[event] < 0) {
+        os << "-";
+      } else {
+        os << std::fixed << std::setprecision(0) << per_call(s, event);
+      }
+    }
+    os << "\t";
+    if (s.counts[kPerfCycles] > 0 && s.counts[kPerfInstructions] >= 0) {
+      os << std::fixed << std::setprecision(2)
+         << static_cast<double>(s.counts[kPerfInstructions]) / s.counts[kPerfCycles];
+    } else {
+      os << "-";
+    }
+    for (PerfEvent event : {kPerfCacheMisses, kPerfBranchMisses}) {
+      os << "\t";
+      if (s.counts[event] < 0) {
+        os << "-";
+      } else {
+        os << std::fixed << std::setprecision(0) << per_call(s, event);
+      }
+    }
+    os << "\t" << s.bytes << "\t";
+    if (s.flops > 0) {
+      os << std::fixed << std::setprecision(0) << s.flops << "\t" << std::setprecision(3)
+         << s.bytes / s.flops;
+    } else {
+      os << "-\t-";
+    }
+    os << std::endl;
+  }
+  return os.str();
+}
+
+}  // namespace runtime
+}  // namespace tvm
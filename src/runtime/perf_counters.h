@@ -0,0 +1,113 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file perf_counters.h
+ * \brief Hardware performance counters of the debug runtimes.
+ */
+#ifndef TVM_RUNTIME_PERF_COUNTERS_H_
+#define TVM_RUNTIME_PERF_COUNTERS_H_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+
+/*! \brief The hardware events counted by PerfCounters. */
+enum PerfEvent : int {
+  kPerfCycles = 0,
+  kPerfInstructions = 1,
+  /*! \brief Misses of the last level cache. */
+  kPerfCacheMisses = 2,
+  kPerfBranchMisses = 3,
+  kNumPerfEvents = 4,
+};
+
+/*! \brief Counts of hardware events accumulated over the calls of an operator. */
+struct PerfCounterStats {
+  /*! \brief The event counts, -1 when an event is not supported. */
+  int64_t counts[kNumPerfEvents] = {0, 0, 0, 0};
+  /*! \brief The number of calls. */
+  int64_t calls = 0;
+  /*! \brief The bytes of the arguments of one call. */
+  int64_t bytes = 0;
+  /*! \brief The floating point operations of one call, 0 when unknown. */
+  double flops = 0;
+};
+
+/*!
+ * \brief Counts hardware events of all threads of the process with
+ *  perf_event_open.
+ *
+ *  Only threads that exist when the counters are opened are counted, opening
+ *  them starts the thread pool. Work on devices other than the CPU is not
+ *  counted.
+ */
+class PerfCounters {
+ public:
+  PerfCounters() = default;
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+  ~PerfCounters() { Close(); }
+
+  /*!
+   * \brief Open the counters.
+   * \param error The reason when the counters cannot be opened.
+   * \return Whether the counters are open.
+   */
+  bool Open(std::string* error);
+
+  /*! \brief Close the counters. */
+  void Close();
+
+  /*! \return Whether the counters are open. */
+  bool is_open() const { return !fds_.empty(); }
+
+  /*! \brief Reset and start the counters. */
+  void Start();
+
+  /*!
+   * \brief Stop the counters and add the counts since Start.
+   * \param stats The stats to add the counts and one call to.
+   */
+  void Stop(PerfCounterStats* stats);
+
+ private:
+  /*! \brief The open counters with their event. */
+  std::vector<std::pair<PerfEvent, int>> fds_;
+  /*! \brief Whether each event could be opened. */
+  bool supported_[kNumPerfEvents] = {false, false, false, false};
+};
+
+/*!
+ * \brief Format a table of per operator averages with the derived
+ *  instructions per cycle and bytes per floating point operation.
+ * \param rows The operator names and their stats.
+ * \return The table.
+ */
+std::string FormatPerfCounterReport(
+    const std::vector<std::pair<std::string, PerfCounterStats>>& rows);
+
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_RUNTIME_PERF_COUNTERS_H_
@@ -656,23 +656,25 @@ RPCCode RPCEndpoint::HandleUntilReturnEvent(bool client_mode, RPCSession::FEncod
   return code;
 }
 
+void RPCEndpoint::FlushWriter() {
+  while (writer_.bytes_available() != 0) {
+    size_t n = writer_.ReadWithCallback(
+        [this](const void* data, size_t size) { return channel_->Send(data, size); },
+        writer_.bytes_available());
+    if (n == 0) break;
+  }
+}
+
 void RPCEndpoint::Init() {
   // callback to flush the writer.
-  auto flush_writer = [this]() {
-    while (writer_.bytes_available() != 0) {
-      size_t n = writer_.ReadWithCallback(
-          [this](const void* data, size_t size) { return channel_->Send(data, size); },
-          writer_.bytes_available());
-      if (n == 0) break;
-    }
-  };
+  auto flush_writer = [this]() { this->FlushWriter(); };
 
   // Event handler
   handler_ = std::make_shared<EventHandler>(&reader_, &writer_, name_, &remote_key_, flush_writer);
 
   // Quick function to for syscall remote.
   syscall_remote_ = PackedFunc([this](TVMArgs all_args, TVMRetValue* rv) {
-    std::lock_guard<std::mutex> lock(mutex_);
+    ReturnLock lock(this);
     RPCCode code = static_cast<RPCCode>(all_args[0].operator int());
     TVMArgs args(all_args.values + 1, all_args.type_codes + 1, all_args.num_args - 1);
 
@@ -684,6 +686,7 @@ void RPCEndpoint::Init() {
     handler_->Write(code);
     handler_->SendPackedSeq(args.values, args.type_codes, args.num_args, true);
 
+    ReadPendingReturns();
     code = HandleUntilReturnEvent(true, [rv](TVMArgs args) {
       CHECK_EQ(args.size(), 1);
       *rv = args[0];
@@ -780,8 +783,73 @@ void RPCEndpoint::InitRemoteSession(TVMArgs args) {
 void RPCEndpoint::CallFunc(RPCSession::PackedFuncHandle h, const TVMValue* arg_values,
                            const int* arg_type_codes, int num_args,
                            RPCSession::FEncodeReturn encode_return) {
-  std::lock_guard<std::mutex> lock(mutex_);
+  ReturnLock lock(this);
+
+  WriteCallFunc(h, arg_values, arg_type_codes, num_args);
+  ReadPendingReturns();
+  RPCCode code = HandleUntilReturnEvent(true, encode_return);
+  CHECK(code == RPCCode::kReturn) << "code=" << static_cast<int>(code);
+}
+
+uint64_t RPCEndpoint::StartCallFunc(RPCSession::PackedFuncHandle h, const TVMValue* arg_values,
+                                    const int* arg_type_codes, int num_args,
+                                    RPCSession::FEncodeReturn encode_return) {
+  // The remote blocks writing returns nobody reads once the channel is full, so bound them.
+  const uint64_t kMaxReturnsInFlight = 64;
+  ReturnLock lock(this);
+
+  if (next_ticket_ - next_return_ticket_ >= kMaxReturnsInFlight) {
+    ReadReturnsUntil(next_return_ticket_);
+  }
+  WriteCallFunc(h, arg_values, arg_type_codes, num_args);
+  FlushWriter();
+  uint64_t ticket = next_ticket_++;
+  pending_returns_[ticket].encode_return = encode_return;
+  return ticket;
+}
 
+void RPCEndpoint::WaitReturn(uint64_t ticket) {
+  ReturnLock lock(this);
+  auto it = pending_returns_.find(ticket);
+  CHECK(it != pending_returns_.end() && !it->second.discarded)
+      << "The return of call " << ticket << " is already taken";
+  if (!it->second.received) {
+    ReadReturnsUntil(ticket);
+  }
+  std::exception_ptr error = it->second.error;
+  RetireReturn(it);
+  if (error) std::rethrow_exception(error);
+}
+
+void RPCEndpoint::DiscardReturn(uint64_t ticket) {
+  ReturnLock lock(this);
+  auto it = pending_returns_.find(ticket);
+  if (it == pending_returns_.end()) return;
+  if (it->second.received) {
+    RetireReturn(it);
+  } else {
+    it->second.discarded = true;
+  }
+}
+
+void RPCEndpoint::ReadReturnsUntil(uint64_t ticket) {
+  while (next_return_ticket_ <= ticket) {
+    auto it = pending_returns_.find(next_return_ticket_++);
+    CHECK(it != pending_returns_.end());
+    PendingReturn& pending = it->second;
+    try {
+      RPCCode code = HandleUntilReturnEvent(true, pending.encode_return);
+      CHECK(code == RPCCode::kReturn) << "code=" << static_cast<int>(code);
+    } catch (const std::runtime_error&) {
+      pending.error = std::current_exception();
+    }
+    pending.received = true;
+    if (pending.discarded) RetireReturn(it);
+  }
+}
+
+void RPCEndpoint::WriteCallFunc(RPCSession::PackedFuncHandle h, const TVMValue* arg_values,
+                                const int* arg_type_codes, int num_args) {
   handler_->ValidateArguments(arg_values, arg_type_codes, num_args);
   RPCCode code = RPCCode::kCallFunc;
   uint64_t handle = reinterpret_cast<uint64_t>(h);
@@ -794,57 +862,129 @@ void RPCEndpoint::CallFunc(RPCSession::PackedFuncHandle h, const TVMValue* arg_v
   handler_->Write(code);
   handler_->Write(handle);
   handler_->SendPackedSeq(arg_values, arg_type_codes, num_args, true);
-
-  code = HandleUntilReturnEvent(true, encode_return);
-  CHECK(code == RPCCode::kReturn) << "code=" << static_cast<int>(code);
 }
 
 void RPCEndpoint::CopyToRemote(void* from, size_t from_offset, void* to, size_t to_offset,
                                size_t data_size, TVMContext ctx_to, DLDataType type_hint) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  RPCCode code = RPCCode::kCopyToRemote;
-  uint64_t handle = reinterpret_cast<uint64_t>(to);
-  uint64_t offset = static_cast<uint64_t>(to_offset);
-  uint64_t size = static_cast<uint64_t>(data_size);
+  RPCSession::CopyRequest copy;
+  copy.to_remote = true;
+  copy.local = from;
+  copy.local_offset = from_offset;
+  copy.remote = to;
+  copy.remote_offset = to_offset;
+  copy.nbytes = data_size;
+  copy.remote_ctx = ctx_to;
+  copy.type_hint = type_hint;
+  CopyBatch({copy});
+}
 
-  uint64_t packet_nbytes = sizeof(code) + sizeof(handle) + sizeof(offset) + sizeof(size) +
-                           sizeof(ctx_to) + sizeof(type_hint) + data_size;
+void RPCEndpoint::CopyFromRemote(void* from, size_t from_offset, void* to, size_t to_offset,
+                                 size_t data_size, TVMContext ctx_from, DLDataType type_hint) {
+  RPCSession::CopyRequest copy;
+  copy.to_remote = false;
+  copy.local = to;
+  copy.local_offset = to_offset;
+  copy.remote = from;
+  copy.remote_offset = from_offset;
+  copy.nbytes = data_size;
+  copy.remote_ctx = ctx_from;
+  copy.type_hint = type_hint;
+  CopyBatch({copy});
+}
 
-  handler_->Write(packet_nbytes);
-  handler_->Write(code);
-  handler_->Write(handle);
-  handler_->Write(offset);
-  handler_->Write(size);
-  handler_->Write(ctx_to);
-  handler_->Write(type_hint);
-  handler_->WriteArray(reinterpret_cast<char*>(from) + from_offset, data_size);
+void RPCEndpoint::CopyBatch(const std::vector<RPCSession::CopyRequest>& copies) {
+  ReturnLock lock(this);
+  struct Chunk {
+    const RPCSession::CopyRequest* copy;
+    size_t offset;
+    size_t nbytes;
+  };
+  std::vector<Chunk> chunks;
+  for (const auto& copy : copies) {
+    size_t chunk_bytes = copy.nbytes;
+    if (copy_chunk_bytes_ != 0) {
+      // Keep whole elements in a chunk, the server swaps the bytes of each element.
+      size_t elem_bytes = (copy.type_hint.bits * copy.type_hint.lanes + 7) / 8;
+      elem_bytes = std::max<size_t>(elem_bytes, 1);
+      chunk_bytes = std::max<size_t>(copy_chunk_bytes_ / elem_bytes, 1) * elem_bytes;
+    }
+    size_t offset = 0;
+    do {
+      size_t nbytes = std::min(chunk_bytes, copy.nbytes - offset);
+      chunks.push_back({&copy, offset, nbytes});
+      offset += nbytes;
+    } while (offset < copy.nbytes);
+  }
 
-  CHECK(HandleUntilReturnEvent(true, [](TVMArgs) {}) == RPCCode::kReturn);
+  // The remote replies to the requests in order. The reply of a copy from remote carries
+  // the data, so no data is sent behind it until it is read. Otherwise both ends could
+  // block writing to each other.
+  size_t sent = 0, received = 0, from_remote_in_flight = 0;
+  try {
+    while (received < chunks.size()) {
+      while (sent < chunks.size() && sent - received < copy_window_ &&
+             !(chunks[sent].copy->to_remote && from_remote_in_flight != 0)) {
+        const Chunk& chunk = chunks[sent++];
+        WriteCopyRequest(*chunk.copy, chunk.offset, chunk.nbytes);
+        if (!chunk.copy->to_remote) ++from_remote_in_flight;
+      }
+      const Chunk& chunk = chunks[received];
+      ReadCopyReply(*chunk.copy, chunk.offset, chunk.nbytes);
+      ++received;
+      if (!chunk.copy->to_remote) --from_remote_in_flight;
+    }
+  } catch (const std::runtime_error&) {
+    // Read the replies of the requests still in flight, so the next request gets its own reply.
+    for (size_t i = received + 1; i < sent; ++i) {
+      try {
+        ReadCopyReply(*chunks[i].copy, chunks[i].offset, chunks[i].nbytes);
+      } catch (const std::runtime_error&) {
+      }
+    }
+    throw;
+  }
 }
 
-void RPCEndpoint::CopyFromRemote(void* from, size_t from_offset, void* to, size_t to_offset,
-                                 size_t data_size, TVMContext ctx_from, DLDataType type_hint) {
+void RPCEndpoint::SetCopyWindow(size_t chunk_bytes, size_t window) {
+  CHECK_GT(window, 0U) << "The copy window needs at least one request in flight";
   std::lock_guard<std::mutex> lock(mutex_);
-  RPCCode code = RPCCode::kCopyFromRemote;
-  uint64_t handle = reinterpret_cast<uint64_t>(from);
-  uint64_t offset = static_cast<uint64_t>(from_offset);
-  uint64_t size = static_cast<uint64_t>(data_size);
+  copy_chunk_bytes_ = chunk_bytes;
+  copy_window_ = window;
+}
+
+void RPCEndpoint::WriteCopyRequest(const RPCSession::CopyRequest& copy, size_t offset,
+                                   size_t nbytes) {
+  RPCCode code = copy.to_remote ? RPCCode::kCopyToRemote : RPCCode::kCopyFromRemote;
+  uint64_t handle = reinterpret_cast<uint64_t>(copy.remote);
+  uint64_t remote_offset = static_cast<uint64_t>(copy.remote_offset + offset);
+  uint64_t size = static_cast<uint64_t>(nbytes);
 
-  uint64_t packet_nbytes = sizeof(code) + sizeof(handle) + sizeof(offset) + sizeof(size) +
-                           sizeof(ctx_from) + sizeof(type_hint);
+  uint64_t packet_nbytes = sizeof(code) + sizeof(handle) + sizeof(remote_offset) + sizeof(size) +
+                           sizeof(copy.remote_ctx) + sizeof(copy.type_hint);
+  if (copy.to_remote) packet_nbytes += nbytes;
 
   handler_->Write(packet_nbytes);
   handler_->Write(code);
   handler_->Write(handle);
-  handler_->Write(offset);
+  handler_->Write(remote_offset);
   handler_->Write(size);
-  handler_->Write(ctx_from);
-  handler_->Write(type_hint);
+  handler_->Write(copy.remote_ctx);
+  handler_->Write(copy.type_hint);
+  if (copy.to_remote) {
+    handler_->WriteArray(static_cast<char*>(copy.local) + copy.local_offset + offset, nbytes);
+  }
+}
 
-  TVMRetValue rv;
-  CHECK(HandleUntilReturnEvent(true, [](TVMArgs) {}) == RPCCode::kCopyAck);
-  handler_->ReadArray(reinterpret_cast<char*>(to) + to_offset, data_size);
-  handler_->FinishCopyAck();
+void RPCEndpoint::ReadCopyReply(const RPCSession::CopyRequest& copy, size_t offset,
+                                size_t nbytes) {
+  ReadPendingReturns();
+  if (copy.to_remote) {
+    CHECK(HandleUntilReturnEvent(true, [](TVMArgs) {}) == RPCCode::kReturn);
+  } else {
+    CHECK(HandleUntilReturnEvent(true, [](TVMArgs) {}) == RPCCode::kCopyAck);
+    handler_->ReadArray(static_cast<char*>(copy.local) + copy.local_offset + offset, nbytes);
+    handler_->FinishCopyAck();
+  }
 }
 
 // SysCallEventHandler functions
@@ -973,6 +1113,29 @@ class RPCClientSession : public RPCSession, public DeviceAPI {
     endpoint_->CallFunc(func, arg_values, arg_type_codes, num_args, fencode_return);
   }
 
+  FWaitReturn StartCallFunc(PackedFuncHandle func, const TVMValue* arg_values,
+                            const int* arg_type_codes, int num_args,
+                            const FEncodeReturn& fencode_return) final {
+    // The call discards its return unless it is waited for.
+    struct Call {
+      std::shared_ptr<RPCEndpoint> endpoint;
+      uint64_t ticket;
+      bool waited{false};
+      ~Call() {
+        if (!waited) endpoint->DiscardReturn(ticket);
+      }
+    };
+    uint64_t ticket =
+        endpoint_->StartCallFunc(func, arg_values, arg_type_codes, num_args, fencode_return);
+    auto call = std::make_shared<Call>();
+    call->endpoint = endpoint_;
+    call->ticket = ticket;
+    return [call]() {
+      call->waited = true;
+      call->endpoint->WaitReturn(call->ticket);
+    };
+  }
+
   void CopyToRemote(void* from, size_t from_offset, void* to, size_t to_offset, size_t nbytes,
                     TVMContext ctx_to, DLDataType type_hint) final {
     endpoint_->CopyToRemote(from, from_offset, to, to_offset, nbytes, ctx_to, type_hint);
@@ -983,6 +1146,8 @@ class RPCClientSession : public RPCSession, public DeviceAPI {
     endpoint_->CopyFromRemote(from, from_offset, to, to_offset, nbytes, ctx_from, type_hint);
   }
 
+  void CopyBatch(const std::vector<CopyRequest>& copies) final { endpoint_->CopyBatch(copies); }
+
   void FreeHandle(void* handle, int type_code) final {
     endpoint_->SysCallRemote(RPCCode::kFreeHandle, handle, type_code);
   }
@@ -1022,6 +1187,9 @@ class RPCClientSession : public RPCSession, public DeviceAPI {
 
   bool IsLocalSession() const final { return false; }
 
+  /*! \return The endpoint of the session. */
+  RPCEndpoint* endpoint() const { return endpoint_.get(); }
+
  private:
   std::shared_ptr<RPCEndpoint> endpoint_;
 };
@@ -1030,5 +1198,16 @@ std::shared_ptr<RPCSession> CreateClientSession(std::shared_ptr<RPCEndpoint> end
   return std::make_shared<RPCClientSession>(endpoint);
 }
 
+TVM_REGISTER_GLOBAL("rpc.SetCopyWindow")
+    .set_body_typed([](Module sess, int64_t chunk_bytes, int64_t window) {
+      CHECK_GE(chunk_bytes, 0);
+      CHECK_GT(window, 0);
+      // Only sessions over a channel pipeline copies.
+      auto* client = dynamic_cast<RPCClientSession*>(RPCModuleGetSession(sess).get());
+      if (client != nullptr) {
+        client->endpoint()->SetCopyWindow(chunk_bytes, window);
+      }
+    });
+
 }  // namespace runtime
 }  // namespace tvm
@@ -27,9 +27,12 @@
 #include <tvm/runtime/packed_func.h>
 
 #include <memory>
+#include <exception>
 #include <mutex>
 #include <string>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "../../support/ring_buffer.h"
 #include "rpc_channel.h"
@@ -125,6 +128,38 @@ class RPCEndpoint {
    */
   void CallFunc(RPCSession::PackedFuncHandle handle, const TVMValue* arg_values,
                 const int* arg_type_codes, int num_args, RPCSession::FEncodeReturn encode_return);
+
+  /*!
+   * \brief Call into remote function without waiting for its return.
+   *
+   *  The remote returns in the order of the calls. The returns of the calls in flight
+   *  are read before the reply of any later request.
+   *
+   * \param handle The function handle
+   * \param arg_values The argument values.
+   * \param arg_type_codes the type codes of the argument.
+   * \param num_args Number of arguments.
+   * \param encode_return The function to receive return value encodings.
+   * \return The ticket of the call, to pass to WaitReturn or DiscardReturn.
+   */
+  uint64_t StartCallFunc(RPCSession::PackedFuncHandle handle, const TVMValue* arg_values,
+                         const int* arg_type_codes, int num_args,
+                         RPCSession::FEncodeReturn encode_return);
+
+  /*!
+   * \brief Wait for the return of a call started by StartCallFunc.
+   *
+   *  The return is passed to the encode_return of the call, errors of the call are rethrown.
+   *
+   * \param ticket The ticket of the call.
+   */
+  void WaitReturn(uint64_t ticket);
+
+  /*!
+   * \brief Discard the return of a call started by StartCallFunc that is not waited for.
+   * \param ticket The ticket of the call.
+   */
+  void DiscardReturn(uint64_t ticket);
   /*!
    * \brief Copy bytes into remote array content.
    * \param from The source host data.
@@ -150,6 +185,24 @@ class RPCEndpoint {
   void CopyFromRemote(void* from, size_t from_offset, void* to, size_t to_offset, size_t nbytes,
                       TVMContext ctx_from, DLDataType type_hint);
 
+  /*!
+   * \brief Run a batch of copies.
+   *
+   *  The copies are split into chunks and up to the window of chunk requests are
+   *  sent before waiting for the reply of the first one. This overlaps the transfer
+   *  with the remote copies and avoids a round trip per copy.
+   *
+   * \param copies The copies.
+   */
+  void CopyBatch(const std::vector<RPCSession::CopyRequest>& copies);
+
+  /*!
+   * \brief Set how copies are split and pipelined.
+   * \param chunk_bytes The maximum size of a chunk in bytes, 0 to send each copy whole.
+   * \param window The maximum number of chunk requests in flight.
+   */
+  void SetCopyWindow(size_t chunk_bytes, size_t window);
+
   /*!
    * \brief Call a remote defined system function with arguments.
    * \param fcode The function code.
@@ -174,6 +227,52 @@ class RPCEndpoint {
   // Handle events until receives a return
   // Also flushes channels so that the function advances.
   RPCCode HandleUntilReturnEvent(bool client_mode, RPCSession::FEncodeReturn setreturn);
+  // The return of a call started by StartCallFunc.
+  struct PendingReturn {
+    // The function to receive return value encodings.
+    RPCSession::FEncodeReturn encode_return;
+    // Whether the return has been read.
+    bool received{false};
+    // Whether the return is discarded once read.
+    bool discarded{false};
+    // The error of the call.
+    std::exception_ptr error;
+  };
+  // Locks the endpoint, and destroys the returns retired under the lock once it is released.
+  // Their callbacks can hold remote objects, which free themselves through the endpoint.
+  class ReturnLock {
+   public:
+    explicit ReturnLock(RPCEndpoint* endpoint) : endpoint_(endpoint), lock_(endpoint->mutex_) {}
+    ~ReturnLock() {
+      std::vector<PendingReturn> retired;
+      retired.swap(endpoint_->retired_returns_);
+      lock_.unlock();
+    }
+
+   private:
+    RPCEndpoint* endpoint_;
+    std::unique_lock<std::mutex> lock_;
+  };
+  // Take a pending return out of the table, it is destroyed when the lock is released.
+  void RetireReturn(std::unordered_map<uint64_t, PendingReturn>::iterator it) {
+    retired_returns_.push_back(std::move(it->second));
+    pending_returns_.erase(it);
+  }
+  // Write a call request.
+  void WriteCallFunc(RPCSession::PackedFuncHandle h, const TVMValue* arg_values,
+                     const int* arg_type_codes, int num_args);
+  // Read the returns of the started calls up to the ticket.
+  void ReadReturnsUntil(uint64_t ticket);
+  // Read the returns of all the started calls, which come before the reply of a new request.
+  void ReadPendingReturns() {
+    if (next_return_ticket_ != next_ticket_) ReadReturnsUntil(next_ticket_ - 1);
+  }
+  // Send the written requests to the channel.
+  void FlushWriter();
+  // Write the request of a chunk of a copy.
+  void WriteCopyRequest(const RPCSession::CopyRequest& copy, size_t offset, size_t nbytes);
+  // Wait for the reply of a chunk of a copy.
+  void ReadCopyReply(const RPCSession::CopyRequest& copy, size_t offset, size_t nbytes);
   // Initalization
   void Init();
   // Shutdown
@@ -192,6 +291,18 @@ class RPCEndpoint {
   std::string name_;
   // The remote key
   std::string remote_key_;
+  // The maximum size of a copy chunk in bytes, 0 sends copies whole.
+  size_t copy_chunk_bytes_{1 << 20};
+  // The maximum number of copy chunk requests in flight.
+  size_t copy_window_{8};
+  // The returns of the started calls, by ticket.
+  std::unordered_map<uint64_t, PendingReturn> pending_returns_;
+  // The returns taken out of the table under the lock, see ReturnLock.
+  std::vector<PendingReturn> retired_returns_;
+  // The ticket of the next started call.
+  uint64_t next_ticket_{0};
+  // The ticket of the next return to read.
+  uint64_t next_return_ticket_{0};
 };
 
 /*!
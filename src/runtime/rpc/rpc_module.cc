@@ -26,6 +26,7 @@
 
 #include <cstring>
 #include <memory>
+#include <vector>
 #if defined(_M_X64) || defined(__x86_64__)
 #include <immintrin.h>
 #endif
@@ -44,9 +45,56 @@ class RPCWrappedFunc : public Object {
   RPCWrappedFunc(void* handle, std::shared_ptr<RPCSession> sess) : handle_(handle), sess_(sess) {}
 
   void operator()(TVMArgs args, TVMRetValue* rv) const {
-    std::vector<TVMValue> values(args.values, args.values + args.size());
-    std::vector<int> type_codes(args.type_codes, args.type_codes + args.size());
+    std::vector<TVMValue> values;
+    std::vector<int> type_codes;
     std::vector<std::unique_ptr<DLTensor>> temp_dltensors;
+    ConvertArgs(args, &values, &type_codes, &temp_dltensors);
+    auto set_return = [this, rv](TVMArgs args) { this->WrapRemoteReturnToValue(args, rv); };
+    sess_->CallFunc(handle_, values.data(), type_codes.data(), args.size(), set_return);
+  }
+
+  /*!
+   * \brief Start a call without waiting for its return.
+   * \param args The arguments.
+   * \param self The function itself, kept alive until the return is read.
+   * \return A function that waits for the return and returns it.
+   */
+  PackedFunc StartCall(TVMArgs args, std::shared_ptr<RPCWrappedFunc> self) const {
+    std::vector<TVMValue> values;
+    std::vector<int> type_codes;
+    std::vector<std::unique_ptr<DLTensor>> temp_dltensors;
+    ConvertArgs(args, &values, &type_codes, &temp_dltensors);
+    auto ret = std::make_shared<TVMRetValue>();
+    auto set_return = [self, ret](TVMArgs args) { self->WrapRemoteReturnToValue(args, ret.get()); };
+    RPCSession::FWaitReturn wait =
+        sess_->StartCallFunc(handle_, values.data(), type_codes.data(), args.size(), set_return);
+    return PackedFunc([wait, ret](TVMArgs args, TVMRetValue* rv) {
+      wait();
+      *rv = std::move(*ret);
+    });
+  }
+
+  ~RPCWrappedFunc() {
+    try {
+      sess_->FreeHandle(handle_, kTVMPackedFuncHandle);
+    } catch (const dmlc::Error& e) {
+      // fault tolerance to remote close
+    }
+  }
+
+ private:
+  // remote function handle
+  void* handle_{nullptr};
+  // pointer to the session.
+  std::shared_ptr<RPCSession> sess_;
+
+  // rewrite the arguments to their remote variant.
+  void ConvertArgs(TVMArgs args, std::vector<TVMValue>* out_values, std::vector<int>* out_codes,
+                   std::vector<std::unique_ptr<DLTensor>>* temp_dltensors) const {
+    std::vector<TVMValue>& values = *out_values;
+    std::vector<int>& type_codes = *out_codes;
+    values.assign(args.values, args.values + args.size());
+    type_codes.assign(args.type_codes, args.type_codes + args.size());
 
     // scan and check whether we need rewrite these arguments
     // to their remote variant.
@@ -69,7 +117,7 @@ class RPCWrappedFunc : public Object {
           dptr->ctx = RemoveSessMask(dptr->ctx);
           dptr->data = static_cast<RemoteSpace*>(dptr->data)->data;
           values[i].v_handle = dptr.get();
-          temp_dltensors.emplace_back(std::move(dptr));
+          temp_dltensors->emplace_back(std::move(dptr));
           break;
         }
         case kTVMContext: {
@@ -83,24 +131,7 @@ class RPCWrappedFunc : public Object {
         }
       }
     }
-    auto set_return = [this, rv](TVMArgs args) { this->WrapRemoteReturnToValue(args, rv); };
-    sess_->CallFunc(handle_, values.data(), type_codes.data(), args.size(), set_return);
   }
-
-  ~RPCWrappedFunc() {
-    try {
-      sess_->FreeHandle(handle_, kTVMPackedFuncHandle);
-    } catch (const dmlc::Error& e) {
-      // fault tolerance to remote close
-    }
-  }
-
- private:
-  // remote function handle
-  void* handle_{nullptr};
-  // pointer to the session.
-  std::shared_ptr<RPCSession> sess_;
-
   // unwrap a remote value to the underlying handle.
   void* UnwrapRemoteValueToHandle(const TVMArgValue& arg) const;
   // wrap a remote return via Set
@@ -159,6 +190,13 @@ class RPCModuleNode final : public ModuleNode {
       : module_handle_(module_handle), sess_(sess) {}
 
   ~RPCModuleNode() {
+    if (remote_mod_get_function_handle_ != nullptr) {
+      try {
+        sess_->FreeHandle(remote_mod_get_function_handle_, kTVMPackedFuncHandle);
+      } catch (const dmlc::Error& e) {
+        // fault tolerance to remote close
+      }
+    }
     if (module_handle_ != nullptr) {
       try {
         sess_->FreeHandle(module_handle_, kTVMModuleHandle);
@@ -215,6 +253,42 @@ class RPCModuleNode final : public ModuleNode {
     remote_import_module_(GetRef<Module>(this), other);
   }
 
+  /*!
+   * \brief Get a function whose calls return a function that waits for the result,
+   *  so that several calls can be in flight on the session.
+   * \param name The name of the function.
+   * \return The function, null if it does not exist.
+   */
+  PackedFunc GetAsyncFunction(const std::string& name) {
+    RPCSession::PackedFuncHandle handle = nullptr;
+    if (module_handle_ == nullptr) {
+      handle = sess_->GetFunction(name);
+    } else {
+      // Take the remote handle, GetFunction returns it wrapped.
+      if (remote_mod_get_function_handle_ == nullptr) {
+        remote_mod_get_function_handle_ = sess_->GetFunction("tvm.rpc.server.ModuleGetFunction");
+        CHECK(remote_mod_get_function_handle_ != nullptr)
+            << "Cannot found remote function tvm.rpc.server.ModuleGetFunction";
+      }
+      TVMValue values[3];
+      int type_codes[3];
+      values[0].v_handle = module_handle_;
+      type_codes[0] = kTVMModuleHandle;
+      values[1].v_str = name.c_str();
+      type_codes[1] = kTVMStr;
+      values[2].v_int64 = 0;
+      type_codes[2] = kDLInt;
+      sess_->CallFunc(remote_mod_get_function_handle_, values, type_codes, 3,
+                      [&handle](TVMArgs args) {
+                        int tcode = args[0];
+                        if (tcode == kTVMPackedFuncHandle) handle = args[1];
+                      });
+    }
+    if (handle == nullptr) return PackedFunc();
+    auto wf = std::make_shared<RPCWrappedFunc>(handle, sess_);
+    return PackedFunc([wf](TVMArgs args, TVMRetValue* rv) { *rv = wf->StartCall(args, wf); });
+  }
+
   const std::shared_ptr<RPCSession>& sess() { return sess_; }
 
   void* module_handle() const { return module_handle_; }
@@ -243,6 +317,8 @@ class RPCModuleNode final : public ModuleNode {
       remote_get_time_evaluator_;
   // remote function getter for modules.
   TypedPackedFunc<PackedFunc(Module, std::string, bool)> remote_mod_get_function_;
+  // handle of the remote function getter for modules.
+  RPCSession::PackedFuncHandle remote_mod_get_function_handle_{nullptr};
   // remote function getter for load module
   TypedPackedFunc<Module(std::string)> remote_load_module_;
   // remote function getter for load module
@@ -462,6 +538,42 @@ TVM_REGISTER_GLOBAL("rpc.ImportRemoteModule").set_body_typed([](Module parent, M
   static_cast<RPCModuleNode*>(parent.operator->())->ImportModule(child);
 });
 
+TVM_REGISTER_GLOBAL("rpc.GetAsyncFunction").set_body_typed([](Module mod, std::string name) {
+  std::string tkey = mod->type_key();
+  CHECK_EQ(tkey, "rpc");
+  return static_cast<RPCModuleNode*>(mod.operator->())->GetAsyncFunction(name);
+});
+
+TVM_REGISTER_GLOBAL("rpc.CopyArrays").set_body([](TVMArgs args, TVMRetValue* rv) {
+  std::shared_ptr<RPCSession> sess = RPCModuleGetSession(args[0]);
+  CHECK_EQ(args.size() % 2, 1) << "rpc.CopyArrays expects pairs of source and target arrays";
+  std::vector<RPCSession::CopyRequest> copies;
+  for (int i = 1; i < args.size(); i += 2) {
+    NDArray from = args[i];
+    NDArray to = args[i + 1];
+    CHECK(from.IsContiguous() && to.IsContiguous()) << "rpc.CopyArrays expects contiguous arrays";
+    size_t nbytes = GetDataSize(*from.operator->());
+    CHECK_EQ(nbytes, GetDataSize(*to.operator->())) << "Array sizes mismatch";
+    RPCSession::CopyRequest copy;
+    copy.to_remote = from->ctx.device_type == kDLCPU;
+    const NDArray& local = copy.to_remote ? from : to;
+    const NDArray& remote = copy.to_remote ? to : from;
+    CHECK_EQ(local->ctx.device_type, kDLCPU) << "rpc.CopyArrays copies between cpu and remote";
+    CHECK_EQ(remote->ctx.device_type / kRPCSessMask - 1, sess->table_index())
+        << "rpc.CopyArrays expects arrays of the session";
+    copy.local = local->data;
+    copy.local_offset = local->byte_offset;
+    copy.remote = static_cast<RemoteSpace*>(remote->data)->data;
+    copy.remote_offset = remote->byte_offset;
+    copy.nbytes = nbytes;
+    copy.remote_ctx = remote->ctx;
+    copy.remote_ctx.device_type = static_cast<DLDeviceType>(remote->ctx.device_type % kRPCSessMask);
+    copy.type_hint = from->dtype;
+    copies.push_back(copy);
+  }
+  sess->CopyBatch(copies);
+});
+
 TVM_REGISTER_GLOBAL("rpc.SessTableIndex").set_body([](TVMArgs args, TVMRetValue* rv) {
   Module m = args[0];
   std::string tkey = m->type_key();
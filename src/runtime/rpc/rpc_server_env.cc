@@ -23,7 +23,13 @@
  */
 #include <tvm/runtime/registry.h>
 
+#include <atomic>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "../file_util.h"
+#include "rpc_session.h"
 
 namespace tvm {
 namespace runtime {
@@ -57,5 +63,110 @@ TVM_REGISTER_GLOBAL("tvm.rpc.server.remove").set_body([](TVMArgs args, TVMRetVal
   RemoveFile(file_name);
 });
 
+/*!
+ * \brief Times a batch of uploaded modules, one module per call of "next".
+ *
+ *  A client sends the calls of a whole batch without waiting, and gets the
+ *  results back as each evaluation finishes, see tvm.rpc.server.batch_evaluate.
+ */
+class BatchEvaluatorNode final : public ModuleNode {
+ public:
+  BatchEvaluatorNode(std::vector<std::string> file_names, std::string func_name, TVMContext ctx,
+                     int number, int repeat, int min_repeat_ms, PackedFunc f_preproc)
+      : file_names_(std::move(file_names)),
+        func_name_(std::move(func_name)),
+        ctx_(ctx),
+        number_(number),
+        repeat_(repeat),
+        min_repeat_ms_(min_repeat_ms),
+        f_preproc_(f_preproc) {}
+
+  ~BatchEvaluatorNode() {
+    for (; next_ < file_names_.size(); ++next_) {
+      RemoveFile(RPCGetPath(file_names_[next_]));
+    }
+  }
+
+  const char* type_key() const final { return "BatchEvaluator"; }
+
+  PackedFunc GetFunction(const std::string& name, const ObjectPtr<Object>& sptr_to_self) final {
+    if (name == "next") {
+      return PackedFunc(
+          [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { this->Next(args, rv); });
+    } else if (name == "num_remaining") {
+      return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+        *rv = static_cast<int64_t>(file_names_.size() - next_);
+      });
+    }
+    return PackedFunc();
+  }
+
+  /*!
+   * \brief Time the next module with the given arguments.
+   * \param args The arguments of the function.
+   * \param rv The time costs in the format of the time evaluator, or the error message
+   *  if the module fails to load or run.
+   */
+  void Next(TVMArgs args, TVMRetValue* rv) {
+    CHECK_LT(next_, file_names_.size()) << "All modules of the batch are evaluated";
+    const std::string& file_name = file_names_[next_++];
+    try {
+      const PackedFunc* load_module = runtime::Registry::Get("tvm.rpc.server.load_module");
+      CHECK(load_module != nullptr) << "require tvm.rpc.server.load_module";
+      Module m = (*load_module)(file_name);
+      PackedFunc f = m.GetFunction(func_name_, false);
+      CHECK(f != nullptr) << "Cannot find " << func_name_ << " in " << file_name;
+      WrapTimeEvaluator(f, ctx_, number_, repeat_, min_repeat_ms_, f_preproc_)
+          .CallPacked(args, rv);
+    } catch (const dmlc::Error& e) {
+      *rv = std::string(e.what());
+    }
+    RemoveFile(RPCGetPath(file_name));
+  }
+
+ private:
+  std::vector<std::string> file_names_;
+  size_t next_{0};
+  std::string func_name_;
+  TVMContext ctx_;
+  int number_;
+  int repeat_;
+  int min_repeat_ms_;
+  PackedFunc f_preproc_;
+};
+
+// Arguments: func_name, device_type, device_id, number, repeat, min_repeat_ms, f_preproc_name,
+// followed by a file name and binary for each module.
+TVM_REGISTER_GLOBAL("tvm.rpc.server.batch_evaluate").set_body([](TVMArgs args, TVMRetValue* rv) {
+  CHECK(args.size() >= 7 && args.size() % 2 == 1)
+      << "tvm.rpc.server.batch_evaluate expects a file name and binary per module";
+  std::string func_name = args[0];
+  TVMContext ctx;
+  ctx.device_type = static_cast<DLDeviceType>(args[1].operator int());
+  ctx.device_id = args[2];
+  std::string f_preproc_name = args[6];
+  PackedFunc f_preproc;
+  if (!f_preproc_name.empty()) {
+    auto* pf_preproc = runtime::Registry::Get(f_preproc_name);
+    CHECK(pf_preproc != nullptr) << "Cannot find " << f_preproc_name << " in the global function";
+    f_preproc = *pf_preproc;
+  }
+  // Prefix the names with the batch and the position in it, since modules from different
+  // directories can share a base name, and so can the modules of two batches.
+  static std::atomic<int64_t> num_batches{0};
+  std::string prefix = "batch" + std::to_string(num_batches++) + "_";
+  std::vector<std::string> file_names;
+  for (int i = 7; i < args.size(); i += 2) {
+    std::string name = args[i];
+    CHECK_EQ(name.find('/'), std::string::npos) << "Expect the base name of a module, got " << name;
+    std::string data = args[i + 1];
+    file_names.push_back(prefix + std::to_string((i - 7) / 2) + "_" + name);
+    SaveBinaryToFile(RPCGetPath(file_names.back()), data);
+  }
+  auto n = make_object<BatchEvaluatorNode>(std::move(file_names), func_name, ctx, args[3],
+                                           args[4], args[5], f_preproc);
+  *rv = Module(n);
+});
+
 }  // namespace runtime
 }  // namespace tvm
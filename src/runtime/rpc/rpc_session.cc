@@ -34,6 +34,26 @@ namespace runtime {
 
 bool RPCSession::IsAsync() const { return false; }
 
+RPCSession::FWaitReturn RPCSession::StartCallFunc(PackedFuncHandle func,
+                                                 const TVMValue* arg_values,
+                                                 const int* arg_type_codes, int num_args,
+                                                 const FEncodeReturn& fencode_return) {
+  this->CallFunc(func, arg_values, arg_type_codes, num_args, fencode_return);
+  return []() {};
+}
+
+void RPCSession::CopyBatch(const std::vector<CopyRequest>& copies) {
+  for (const CopyRequest& copy : copies) {
+    if (copy.to_remote) {
+      this->CopyToRemote(copy.local, copy.local_offset, copy.remote, copy.remote_offset,
+                         copy.nbytes, copy.remote_ctx, copy.type_hint);
+    } else {
+      this->CopyFromRemote(copy.remote, copy.remote_offset, copy.local, copy.local_offset,
+                           copy.nbytes, copy.remote_ctx, copy.type_hint);
+    }
+  }
+}
+
 void RPCSession::SendException(FAsyncCallback callback, const char* msg) {
   TVMValue value;
   value.v_str = msg;
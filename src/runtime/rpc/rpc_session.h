@@ -30,6 +30,7 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "rpc_protocol.h"
 
@@ -125,6 +126,28 @@ class RPCSession {
                         const int* arg_type_codes, int num_args,
                         const FEncodeReturn& fencode_return) = 0;
 
+  /*! \brief Waits for the return of a call started by StartCallFunc. */
+  using FWaitReturn = std::function<void()>;
+
+  /*!
+   * \brief Start a call without waiting for it to return, so that several calls can be
+   *  in flight on the session.
+   *
+   *  The arguments are sent before the function returns. The default runs the call
+   *  right away.
+   *
+   * \param func The function handle.
+   * \param arg_values The argument values.
+   * \param arg_type_codes the type codes of the argument.
+   * \param num_args Number of arguments.
+   * \param fencode_return The function to set the return value, called while waiting.
+   * \return The function to wait for the return, which rethrows the error of the call.
+   *  The return is discarded if it is destroyed before being called.
+   */
+  virtual FWaitReturn StartCallFunc(PackedFuncHandle func, const TVMValue* arg_values,
+                                    const int* arg_type_codes, int num_args,
+                                    const FEncodeReturn& fencode_return);
+
   /*!
    * \brief Copy bytes into remote array content.
    * \param local_from The source host data.
@@ -152,6 +175,36 @@ class RPCSession {
                               size_t local_to_offset, size_t nbytes, TVMContext remote_ctx_from,
                               DLDataType type_hint) = 0;
 
+  /*! \brief A copy between local and remote array content, see CopyBatch. */
+  struct CopyRequest {
+    /*! \brief Whether to copy from local to remote, rather than from remote to local. */
+    bool to_remote;
+    /*! \brief The local host data. */
+    void* local;
+    /*! \brief The byte offset in the local data. */
+    size_t local_offset;
+    /*! \brief The remote data handle. */
+    void* remote;
+    /*! \brief The byte offset in the remote data. */
+    size_t remote_offset;
+    /*! \brief The size of the memory in bytes. */
+    size_t nbytes;
+    /*! \brief The remote context. */
+    TVMContext remote_ctx;
+    /*! \brief Hint of content data type. */
+    DLDataType type_hint;
+  };
+
+  /*!
+   * \brief Run a batch of copies between local and remote array content.
+   *
+   *  The default runs the copies one after another. Sessions over a channel keep
+   *  several copies in flight so that a batch costs about one round trip.
+   *
+   * \param copies The copies.
+   */
+  virtual void CopyBatch(const std::vector<CopyRequest>& copies);
+
   /*!
    * \brief Free a remote function.
    * \param handle The remote handle, can be NDArray/PackedFunc/Module
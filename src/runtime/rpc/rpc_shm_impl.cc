@@ -0,0 +1,267 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file rpc_shm_impl.cc
+ * \brief Shared memory RPC channel between processes on the same host.
+ */
+// Linux only for now, as linux is the most common usecase.
+#if defined(__linux__) || defined(__ANDROID__)
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <tvm/runtime/registry.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "rpc_endpoint.h"
+#include "rpc_local_session.h"
+
+namespace tvm {
+namespace runtime {
+
+/*! \brief The data capacity of each ring. */
+constexpr uint64_t kShmRingBytes = 4 << 20;
+
+/*!
+ * \brief Single producer, single consumer byte ring in shared memory.
+ *
+ *  The waiting flags let the peer skip the eventfd write unless the other
+ *  side is about to block.
+ */
+struct ShmRing {
+  /*! \brief The total number of bytes written. */
+  alignas(64) std::atomic<uint64_t> head;
+  /*! \brief The total number of bytes read. */
+  alignas(64) std::atomic<uint64_t> tail;
+  /*! \brief Whether the reader waits for data. */
+  alignas(64) std::atomic<int32_t> reader_waiting;
+  /*! \brief Whether the writer waits for space. */
+  std::atomic<int32_t> writer_waiting;
+  /*! \brief The data. */
+  alignas(64) char data[kShmRingBytes];
+};
+
+/*! \brief The shared memory, the ring from the client to the server and the reverse. */
+struct ShmRegion {
+  ShmRing rings[2];
+};
+
+class ShmChannel final : public RPCChannel {
+ public:
+  /*!
+   * \brief Constructor.
+   * \param region The shared memory.
+   * \param is_client Whether this end is the client, which sends on the first ring.
+   * \param wait_fd The eventfd this end waits on.
+   * \param notify_fd The eventfd the peer waits on.
+   * \param child_pid The server process of the client, to kill when the channel closes.
+   */
+  ShmChannel(ShmRegion* region, bool is_client, int wait_fd, int notify_fd, pid_t child_pid)
+      : region_(region),
+        send_(&region->rings[is_client ? 0 : 1]),
+        recv_(&region->rings[is_client ? 1 : 0]),
+        wait_fd_(wait_fd),
+        notify_fd_(notify_fd),
+        child_pid_(child_pid),
+        parent_pid_(getppid()) {}
+
+  ~ShmChannel() { Close(); }
+
+  size_t Send(const void* data, size_t size) final {
+    uint64_t head = send_->head.load(std::memory_order_relaxed);
+    auto space = [this, head]() {
+      return kShmRingBytes - (head - send_->tail.load(std::memory_order_acquire));
+    };
+    if (space() == 0 && !Wait(&send_->writer_waiting, [&space]() { return space() != 0; })) {
+      LOG(FATAL) << "Shared memory channel peer exited";
+    }
+    size_t n = std::min<uint64_t>(size, space());
+    Copy(send_->data, head, static_cast<const char*>(data), n);
+    send_->head.store(head + n, std::memory_order_seq_cst);
+    if (send_->reader_waiting.load(std::memory_order_seq_cst)) Notify();
+    return n;
+  }
+
+  size_t Recv(void* data, size_t size) final {
+    uint64_t tail = recv_->tail.load(std::memory_order_relaxed);
+    auto available = [this, tail]() {
+      return recv_->head.load(std::memory_order_acquire) - tail;
+    };
+    if (available() == 0 &&
+        !Wait(&recv_->reader_waiting, [&available]() { return available() != 0; })) {
+      return 0;
+    }
+    size_t n = std::min<uint64_t>(size, available());
+    char* dst = static_cast<char*>(data);
+    size_t offset = tail % kShmRingBytes;
+    size_t first = std::min<size_t>(n, kShmRingBytes - offset);
+    std::memcpy(dst, recv_->data + offset, first);
+    std::memcpy(dst + first, recv_->data, n - first);
+    recv_->tail.store(tail + n, std::memory_order_seq_cst);
+    if (recv_->writer_waiting.load(std::memory_order_seq_cst)) Notify();
+    return n;
+  }
+
+  void Close() {
+    if (region_ == nullptr) return;
+    munmap(region_, sizeof(ShmRegion));
+    region_ = nullptr;
+    close(wait_fd_);
+    close(notify_fd_);
+    if (child_pid_ > 0) {
+      kill(child_pid_, SIGKILL);
+      waitpid(child_pid_, nullptr, 0);
+    }
+  }
+
+ private:
+  // Copy n bytes into the ring at position pos.
+  static void Copy(char* ring, uint64_t pos, const char* src, size_t n) {
+    size_t offset = pos % kShmRingBytes;
+    size_t first = std::min<size_t>(n, kShmRingBytes - offset);
+    std::memcpy(ring + offset, src, first);
+    std::memcpy(ring, src + first, n - first);
+  }
+
+  // Wait until ready returns true, false if the peer exited first.
+  template <typename FReady>
+  bool Wait(std::atomic<int32_t>* waiting, FReady ready) {
+    // Spin briefly, the peer usually answers within microseconds.
+    for (int i = 0; i < 64; ++i) {
+      if (ready()) return true;
+      std::this_thread::yield();
+    }
+    while (true) {
+      waiting->store(1, std::memory_order_seq_cst);
+      if (ready()) break;
+      pollfd fd{wait_fd_, POLLIN, 0};
+      int ret = poll(&fd, 1, 100);
+      if (ret > 0) {
+        uint64_t count;
+        CHECK_EQ(read(wait_fd_, &count, sizeof(count)), static_cast<ssize_t>(sizeof(count)));
+      } else if (ret == 0 && !PeerAlive()) {
+        waiting->store(0, std::memory_order_relaxed);
+        return ready();
+      } else if (ret < 0) {
+        CHECK_EQ(errno, EINTR) << "Shared memory channel poll error";
+      }
+    }
+    waiting->store(0, std::memory_order_relaxed);
+    return true;
+  }
+
+  // Wake the peer.
+  void Notify() {
+    uint64_t count = 1;
+    CHECK_EQ(write(notify_fd_, &count, sizeof(count)), static_cast<ssize_t>(sizeof(count)));
+  }
+
+  // Whether the peer process is still running.
+  bool PeerAlive() {
+    if (child_pid_ > 0) {
+      return waitpid(child_pid_, nullptr, WNOHANG) == 0;
+    }
+    return getppid() == parent_pid_;
+  }
+
+  ShmRegion* region_;
+  ShmRing* send_;
+  ShmRing* recv_;
+  int wait_fd_;
+  int notify_fd_;
+  pid_t child_pid_;
+  pid_t parent_pid_;
+};
+
+ShmRegion* MapShmRegion(int shm_fd) {
+  void* ptr = mmap(nullptr, sizeof(ShmRegion), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+  CHECK(ptr != MAP_FAILED) << "Cannot map shared memory: " << strerror(errno);
+  close(shm_fd);
+  return static_cast<ShmRegion*>(ptr);
+}
+
+Module CreateShmClient(std::vector<std::string> cmd) {
+  int shm_fd = static_cast<int>(syscall(SYS_memfd_create, "tvm_rpc_shm", 0));
+  CHECK_GE(shm_fd, 0) << "Cannot create shared memory: " << strerror(errno);
+  CHECK_EQ(ftruncate(shm_fd, sizeof(ShmRegion)), 0);
+  int client_fd = eventfd(0, 0);
+  int server_fd = eventfd(0, 0);
+  CHECK(client_fd >= 0 && server_fd >= 0) << "Cannot create eventfd: " << strerror(errno);
+
+  pid_t pid = fork();
+  if (pid == 0) {
+    // child process
+    std::string sshm = std::to_string(shm_fd);
+    std::string swait = std::to_string(server_fd);
+    std::string snotify = std::to_string(client_fd);
+    std::vector<char*> argv;
+    for (auto& str : cmd) {
+      argv.push_back(dmlc::BeginPtr(str));
+    }
+    argv.push_back(dmlc::BeginPtr(sshm));
+    argv.push_back(dmlc::BeginPtr(swait));
+    argv.push_back(dmlc::BeginPtr(snotify));
+    argv.push_back(nullptr);
+    execvp(argv[0], &argv[0]);
+    _exit(127);
+  }
+  // parent process
+  ShmRegion* region = MapShmRegion(shm_fd);
+  auto endpt = RPCEndpoint::Create(
+      std::unique_ptr<ShmChannel>(new ShmChannel(region, true, client_fd, server_fd, pid)), "shm",
+      "shm");
+  endpt->InitRemoteSession(TVMArgs(nullptr, nullptr, 0));
+  return CreateRPCSessionModule(CreateClientSession(endpt));
+}
+
+void ShmServerLoop(int shm_fd, int wait_fd, int notify_fd) {
+  ShmRegion* region = MapShmRegion(shm_fd);
+  RPCEndpoint::Create(
+      std::unique_ptr<ShmChannel>(new ShmChannel(region, false, wait_fd, notify_fd, -1)),
+      "ShmServerLoop", "")
+      ->ServerLoop();
+}
+
+TVM_REGISTER_GLOBAL("rpc.CreateShmClient").set_body([](TVMArgs args, TVMRetValue* rv) {
+  std::vector<std::string> cmd;
+  for (int i = 0; i < args.size(); ++i) {
+    cmd.push_back(args[i].operator std::string());
+  }
+  *rv = CreateShmClient(cmd);
+});
+
+TVM_REGISTER_GLOBAL("rpc.ShmServerLoop").set_body_typed(ShmServerLoop);
+
+}  // namespace runtime
+}  // namespace tvm
+#endif
@@ -31,8 +31,15 @@
 #if TVM_THREADPOOL_USE_OPENMP
 #include <omp.h>
 #endif
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 #include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <climits>
 #include <condition_variable>
 #include <cstring>
 #include <memory>
@@ -50,6 +57,9 @@ namespace {
 
 constexpr uint32_t kDefaultSpinCount = 300000;
 
+// number of chunks each worker gets under the work stealing policy
+constexpr int kDefaultChunksPerWorker = 4;
+
 uint32_t GetSpinCount() {
   const char* val = getenv("TVM_THREAD_POOL_SPIN_COUNT");
   if (!val) {
@@ -58,11 +68,195 @@ uint32_t GetSpinCount() {
   return atoi(val);
 }
 
+// lower bound of the adaptive spin budget
+constexpr uint32_t kMinSpinCount = 1024;
+
+bool GetAdaptiveSpin() {
+  const char* val = getenv("TVM_THREAD_POOL_ADAPTIVE_SPIN");
+  return val == nullptr || atoi(val) != 0;
+}
+
+bool GetUseSharedPool() {
+  const char* val = getenv("TVM_THREAD_POOL_SHARED");
+  return val != nullptr && atoi(val) != 0;
+}
+
 }  // namespace
 
 // stride in the page, fit to cache line.
 constexpr int kSyncStride = 64 / sizeof(std::atomic<int>);
 
+/*!
+ * \brief Scheduling policy used by the thread pool.
+ */
+enum class SchedulePolicy : int {
+  /*! \brief Task i always runs on worker i. */
+  kStatic = 0,
+  /*! \brief Tasks are split into per-worker ranges and idle workers steal from busy ones. */
+  kWorkStealing = 1,
+};
+
+/*!
+ * \brief Process-wide counters on how idle workers wait for work.
+ */
+struct WaitStats {
+  // total time spent spinning
+  std::atomic<int64_t> spin_ns{0};
+  // total time spent parked
+  std::atomic<int64_t> park_ns{0};
+  // number of waits that found work while spinning
+  std::atomic<int64_t> num_spin_wakeups{0};
+  // number of waits that had to park
+  std::atomic<int64_t> num_parks{0};
+
+  void Reset() {
+    spin_ns.store(0);
+    park_ns.store(0);
+    num_spin_wakeups.store(0);
+    num_parks.store(0);
+  }
+
+  static WaitStats* Global() {
+    static WaitStats inst;
+    return &inst;
+  }
+};
+
+/*!
+ * \brief Spin budget of one worker that adapts to recent wait times.
+ *
+ *  A wait that finds work while spinning keeps a budget of at least twice
+ *  the spins it took. A wait that parks compares its park time with the time
+ *  it spun: if spinning twice as long would have caught the work, the budget
+ *  doubles; if the park was much longer, the worker is in an idle period
+ *  and the budget halves so that it stops burning the core sooner.
+ */
+class AdaptiveSpin {
+ public:
+  AdaptiveSpin(uint32_t max_spin_count, bool adaptive)
+      : max_spin_count_(max_spin_count),
+        min_spin_count_(std::min(max_spin_count, kMinSpinCount)),
+        budget_(max_spin_count),
+        adaptive_(adaptive) {}
+  /*!
+   * \brief Spin until ready() holds or the budget runs out.
+   * \param ready The condition to wait for.
+   * \return Whether ready() holds.
+   */
+  template <typename FReady>
+  bool Spin(FReady ready) {
+    auto begin = std::chrono::steady_clock::now();
+    uint32_t i = 0;
+    bool is_ready = ready();
+    for (; i < budget_ && !is_ready; ++i) {
+      tvm::runtime::threading::Yield();
+      is_ready = ready();
+    }
+    last_spin_ns_ = ElapsedNs(begin);
+    WaitStats* stats = WaitStats::Global();
+    stats->spin_ns.fetch_add(last_spin_ns_, std::memory_order_relaxed);
+    if (is_ready) {
+      stats->num_spin_wakeups.fetch_add(1, std::memory_order_relaxed);
+      if (adaptive_) {
+        budget_ = std::max(budget_, std::min(max_spin_count_, 2 * i));
+      }
+    }
+    return is_ready;
+  }
+  /*!
+   * \brief Park by calling fpark and adapt the budget to how long it took.
+   * \param fpark The function that blocks until woken up.
+   */
+  template <typename FPark>
+  void Park(FPark fpark) {
+    auto begin = std::chrono::steady_clock::now();
+    fpark();
+    int64_t park_ns = ElapsedNs(begin);
+    WaitStats* stats = WaitStats::Global();
+    stats->park_ns.fetch_add(park_ns, std::memory_order_relaxed);
+    stats->num_parks.fetch_add(1, std::memory_order_relaxed);
+    if (!adaptive_) return;
+    if (park_ns <= last_spin_ns_) {
+      budget_ = std::min(max_spin_count_, std::max(min_spin_count_, 2 * budget_));
+    } else if (park_ns > 4 * last_spin_ns_) {
+      budget_ = std::max(min_spin_count_, budget_ / 2);
+    }
+  }
+
+ private:
+  static int64_t ElapsedNs(std::chrono::steady_clock::time_point begin) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                                begin)
+        .count();
+  }
+  uint32_t max_spin_count_;
+  uint32_t min_spin_count_;
+  uint32_t budget_;
+  bool adaptive_;
+  int64_t last_spin_ns_{0};
+};
+
+/*!
+ * \brief Event count used to park idle workers.
+ *
+ *  A waiter reads the epoch with PrepareWait, re-checks its wake up condition
+ *  and then calls Wait, which returns once a notifier has bumped the epoch.
+ *  Parks on a futex on Linux and on a condition variable elsewhere.
+ */
+class Parker {
+ public:
+  uint32_t PrepareWait() const { return epoch_.load(); }
+
+  void Wait(uint32_t epoch) {
+    num_waiters_.fetch_add(1);
+#if defined(__linux__)
+    while (epoch_.load() == epoch) {
+      syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_), FUTEX_WAIT_PRIVATE, epoch, nullptr,
+              nullptr, 0);
+    }
+#else
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this, epoch] { return epoch_.load() != epoch; });
+    }
+#endif
+    num_waiters_.fetch_sub(1);
+  }
+
+  void NotifyOne() { Notify(1); }
+
+  void NotifyAll() { Notify(INT_MAX); }
+
+ private:
+  void Notify(int count) {
+#if defined(__linux__)
+    epoch_.fetch_add(1);
+    // skip the system call when nobody is parked.
+    if (num_waiters_.load() != 0) {
+      syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_), FUTEX_WAKE_PRIVATE, count, nullptr,
+              nullptr, 0);
+    }
+#else
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      epoch_.fetch_add(1);
+    }
+    if (count == 1) {
+      cv_.notify_one();
+    } else {
+      cv_.notify_all();
+    }
+#endif
+  }
+
+  std::atomic<uint32_t> epoch_{0};
+  std::atomic<int32_t> num_waiters_{0};
+#if !defined(__linux__)
+  std::mutex mutex_;
+  std::condition_variable cv_;
+#endif
+};
+
 /*!
  * \brief Thread local master environment.
  */
@@ -78,10 +272,11 @@ class ParallelLauncher {
     // reshape
     if (static_cast<size_t>(num_task) > par_errors_.size()) {
       par_errors_.resize(num_task + 1);
-      if (need_sync) {
-        delete[] sync_counter_;
-        sync_counter_ = new std::atomic<int>[num_task * kSyncStride];
-      }
+    }
+    if (need_sync && num_task > num_sync_counter_) {
+      delete[] sync_counter_;
+      sync_counter_ = new std::atomic<int>[num_task * kSyncStride];
+      num_sync_counter_ = num_task;
     }
     if (need_sync) {
       for (int i = 0; i < num_task; ++i) {
@@ -92,7 +287,52 @@ class ParallelLauncher {
       this->env.sync_handle = nullptr;
     }
   }
-  ~ParallelLauncher() { delete[] sync_counter_; }
+  /*!
+   * \brief Split the tasks into contiguous ranges, one per slot, for work stealing.
+   *  Must be called after Init and before the tasks are dispatched to the workers.
+   * \param num_slots The number of workers that take part in this launch.
+   */
+  void InitStealing(int num_slots) {
+    if (num_slots > num_slots_) {
+      delete[] ranges_;
+      ranges_ = new TaskRange[num_slots];
+      num_slots_ = num_slots;
+    }
+    int num_task = this->env.num_task;
+    for (int i = 0; i < num_slots; ++i) {
+      uint32_t begin = static_cast<uint32_t>(static_cast<int64_t>(num_task) * i / num_slots);
+      uint32_t end = static_cast<uint32_t>(static_cast<int64_t>(num_task) * (i + 1) / num_slots);
+      ranges_[i].range.store(PackRange(begin, end), std::memory_order_relaxed);
+    }
+    num_active_slots_ = num_slots;
+    // each slot holds one extra pending count until its runner exits,
+    // so the launcher is not reused while a thief is still scanning it.
+    num_pending_.fetch_add(num_slots);
+  }
+  /*!
+   * \brief Drop the pending counts of slots that no thread has joined.
+   * \param num_slots The number of unclaimed slots.
+   */
+  void ReleaseSlots(int num_slots) { num_pending_.fetch_sub(num_slots); }
+  /*!
+   * \brief Run the tasks of a slot, then steal from the other slots until all are drained.
+   * \param slot The slot owned by the calling thread.
+   */
+  void RunStealing(int slot) {
+    int task_id;
+    while (PopFront(slot, &task_id) || StealHalf(slot, &task_id)) {
+      if ((*flambda)(task_id, &env, cdata) == 0) {
+        SignalJobFinish();
+      } else {
+        SignalJobError(task_id);
+      }
+    }
+    SignalJobFinish();
+  }
+  ~ParallelLauncher() {
+    delete[] sync_counter_;
+    delete[] ranges_;
+  }
   // Wait n jobs to finish
   int WaitForJobs() {
     while (num_pending_.load() != 0) {
@@ -126,18 +366,73 @@ class ParallelLauncher {
   // Local env
   TVMParallelGroupEnv env;
   // Whether this thread is worker of the pool.
-  // used to prevent recursive launch.
+  // used to run nested launches inline.
   bool is_worker{false};
+  // Whether this thread is the master of an ongoing launch.
+  // used to run nested launches inline.
+  bool in_region{false};
+  // Whether the current launch is scheduled by work stealing.
+  bool work_stealing{false};
 
  private:
+  /*! \brief Remaining task range [begin, end) of a slot, padded to a cache line. */
+  struct TaskRange {
+    std::atomic<uint64_t> range{0};
+    char pad[kL1CacheBytes - sizeof(std::atomic<uint64_t>)];
+  };
+  static uint64_t PackRange(uint32_t begin, uint32_t end) {
+    return (static_cast<uint64_t>(begin) << 32) | end;
+  }
+  // Take the next task from the front of the own range.
+  bool PopFront(int slot, int* task_id) {
+    std::atomic<uint64_t>& range = ranges_[slot].range;
+    uint64_t cur = range.load(std::memory_order_acquire);
+    while (true) {
+      uint32_t begin = static_cast<uint32_t>(cur >> 32);
+      uint32_t end = static_cast<uint32_t>(cur);
+      if (begin >= end) return false;
+      if (range.compare_exchange_weak(cur, PackRange(begin + 1, end), std::memory_order_acq_rel)) {
+        *task_id = static_cast<int>(begin);
+        return true;
+      }
+    }
+  }
+  // Steal the back half of the first non-empty victim range.
+  // The first stolen task is returned and the rest becomes the range of the thief.
+  bool StealHalf(int slot, int* task_id) {
+    for (int k = 1; k < num_active_slots_; ++k) {
+      std::atomic<uint64_t>& victim = ranges_[(slot + k) % num_active_slots_].range;
+      uint64_t cur = victim.load(std::memory_order_acquire);
+      while (true) {
+        uint32_t begin = static_cast<uint32_t>(cur >> 32);
+        uint32_t end = static_cast<uint32_t>(cur);
+        if (begin >= end) break;
+        uint32_t mid = begin + (end - begin) / 2;
+        if (victim.compare_exchange_weak(cur, PackRange(begin, mid), std::memory_order_acq_rel)) {
+          ranges_[slot].range.store(PackRange(mid + 1, end), std::memory_order_release);
+          *task_id = static_cast<int>(mid);
+          return true;
+        }
+      }
+    }
+    return false;
+  }
   // The pending jobs.
   std::atomic<int32_t> num_pending_;
   // Whether error has been countered.
   std::atomic<bool> has_error_;
   // The counter page.
   std::atomic<int32_t>* sync_counter_{nullptr};
+  // The number of tasks the counter page can host.
+  int num_sync_counter_{0};
   // The error message
   std::vector<std::string> par_errors_;
+  // The per-slot task ranges used by work stealing.
+  TaskRange* ranges_{nullptr};
+  // The capacity of ranges_.
+  int num_slots_{0};
+  // The number of slots taking part in the current launch.
+  int num_active_slots_{0};
 };
 
 /*! \brief Lock-free single-producer-single-consumer queue for each thread */
@@ -162,27 +457,29 @@ class SpscTaskQueue {
       tvm::runtime::threading::Yield();
     }
     if (pending_.fetch_add(1) == -1) {
-      std::unique_lock<std::mutex> lock(mutex_);
-      cv_.notify_one();
+      parker_.NotifyOne();
     }
   }
 
   /*!
-   * \brief Pop a task out of the queue and condition wait if no tasks.
+   * \brief Pop a task out of the queue and park if no tasks.
    * \param output The pointer to the task to be dequeued.
-   * \param spin_count The number of iterations to spin before sleep.
+   * \param spin The spin policy of the worker.
    * \return Whether pop is successful (true) or we need to exit now (false).
    */
-  bool Pop(Task* output, uint32_t spin_count) {
+  bool Pop(Task* output, AdaptiveSpin* spin) {
     // Busy wait a bit when the queue is empty.
     // If a new task comes to the queue quickly, this wait avoid the worker from sleeping.
     // The default spin count is set by following the typical omp convention
-    for (uint32_t i = 0; i < spin_count && pending_.load() == 0; ++i) {
-      tvm::runtime::threading::Yield();
-    }
+    spin->Spin([this] { return pending_.load() != 0; });
     if (pending_.fetch_sub(1) == 0) {
-      std::unique_lock<std::mutex> lock(mutex_);
-      cv_.wait(lock, [this] { return pending_.load() >= 0 || exit_now_.load(); });
+      spin->Park([this] {
+        while (true) {
+          uint32_t epoch = parker_.PrepareWait();
+          if (pending_.load() >= 0 || exit_now_.load()) break;
+          parker_.Wait(epoch);
+        }
+      });
     }
     if (exit_now_.load(std::memory_order_relaxed)) {
       return false;
@@ -199,9 +496,8 @@ class SpscTaskQueue {
    * \brief Signal to terminate the worker.
    */
   void SignalForKill() {
-    std::lock_guard<std::mutex> lock(mutex_);
     exit_now_.store(true);
-    cv_.notify_all();
+    parker_.NotifyAll();
   }
 
  protected:
@@ -248,10 +544,8 @@ class SpscTaskQueue {
   // signal for exit now
   std::atomic<bool> exit_now_{false};
 
-  // internal mutex
-  std::mutex mutex_;
-  // cv for consumer
-  std::condition_variable cv_;
+  // parks the consumer
+  Parker parker_;
 };
 
 // The thread pool
@@ -280,8 +574,9 @@ class ThreadPool {
   }
   int Launch(FTVMParallelLambda flambda, void* cdata, int num_task, int need_sync) {
     ParallelLauncher* launcher = ParallelLauncher::ThreadLocal();
-    CHECK(!launcher->is_worker)
-        << "Cannot launch parallel job inside worker, consider fuse then parallel";
+    if (policy_ == SchedulePolicy::kWorkStealing) {
+      return LaunchStealing(launcher, flambda, cdata, num_task, need_sync);
+    }
     if (num_task == 0) {
       num_task = num_workers_used_;
     }
@@ -291,6 +586,7 @@ class ThreadPool {
           << " workers=" << num_workers_used_ << " request=" << num_task;
     }
     launcher->Init(flambda, cdata, num_task, need_sync != 0);
+    launcher->work_stealing = false;
     SpscTaskQueue::Task tsk;
     tsk.launcher = launcher;
     // if worker0 is taken by the master, queues_[0] is abandoned
@@ -322,7 +618,58 @@ class ThreadPool {
     num_workers_used_ = std::min(num_workers_, num_workers_used_);
   }
 
+  void UpdateWorkerNumaConfiguration(int numa_node, int nthreads) {
+    num_workers_used_ = threads_->ConfigureNumaNode(numa_node, nthreads, exclude_worker0_);
+    num_workers_used_ = std::min(num_workers_, num_workers_used_);
+  }
+
+  void UpdateWorkerCoreSliceConfiguration(int slice, int num_slices) {
+    num_workers_used_ = threads_->ConfigureCoreSlice(slice, num_slices, exclude_worker0_);
+    num_workers_used_ = std::min(num_workers_, num_workers_used_);
+  }
+
+  int NumWorkersUsed() const { return num_workers_used_; }
+
+  void UpdateSchedulePolicy(SchedulePolicy policy, int chunks_per_worker) {
+    CHECK_GE(chunks_per_worker, 0) << "chunks_per_worker must be non-negative";
+    policy_ = policy;
+    chunks_per_worker_ = chunks_per_worker == 0 ? kDefaultChunksPerWorker : chunks_per_worker;
+  }
+
  private:
+  // Launch under the work stealing policy.
+  // When the caller lets the pool choose the number of tasks, each worker
+  // gets chunks_per_worker_ tasks so that uneven tasks can be rebalanced.
+  int LaunchStealing(ParallelLauncher* launcher, FTVMParallelLambda flambda, void* cdata,
+                     int num_task, int need_sync) {
+    bool chunked = false;
+    if (num_task == 0) {
+      num_task = num_workers_used_ * chunks_per_worker_;
+      chunked = chunks_per_worker_ > 1;
+    } else if (need_sync != 0) {
+      CHECK_LE(num_task, num_workers_used_)
+          << "Request parallel sync task larger than number of threads used "
+          << " workers=" << num_workers_used_ << " request=" << num_task;
+    }
+    // A barrier requires all tasks to run at the same time, which cannot
+    // be guaranteed once there are more tasks than workers.
+    launcher->Init(flambda, cdata, num_task, need_sync != 0 && !chunked);
+    launcher->work_stealing = true;
+    int num_slots = std::min(num_task, num_workers_used_);
+    launcher->InitStealing(num_slots);
+    SpscTaskQueue::Task tsk;
+    tsk.launcher = launcher;
+    // the task_id of the queued task is the slot owned by the worker.
+    for (int i = exclude_worker0_; i < num_slots; ++i) {
+      tsk.task_id = i;
+      queues_[i]->Push(tsk);
+    }
+    if (exclude_worker0_ && num_slots > 0) {
+      launcher->RunStealing(0);
+    }
+    return launcher->WaitForJobs();
+  }
+
   // Internal worker function.
   void RunWorker(int worker_id) {
     SpscTaskQueue* queue = queues_[worker_id].get();
@@ -332,8 +679,14 @@ class ThreadPool {
     // the global first use of the ThreadPool.
     // TODO(tulloch): should we make this configurable via standard APIs?
     static size_t spin_count = GetSpinCount();
-    while (queue->Pop(&task, spin_count)) {
+    static bool adaptive_spin = GetAdaptiveSpin();
+    AdaptiveSpin spin(spin_count, adaptive_spin);
+    while (queue->Pop(&task, &spin)) {
       CHECK(task.launcher != nullptr);
+      if (task.launcher->work_stealing) {
+        task.launcher->RunStealing(task.task_id);
+        continue;
+      }
       TVMParallelGroupEnv* penv = &(task.launcher->env);
       void* cdata = task.launcher->cdata;
       if ((*task.launcher->flambda)(task.task_id, penv, cdata) == 0) {
@@ -348,15 +701,314 @@ class ThreadPool {
   int num_workers_used_;
   // if or not to exclude worker 0 and use master to run task 0
   bool exclude_worker0_{true};
+  // how tasks are assigned to the workers
+  SchedulePolicy policy_{SchedulePolicy::kStatic};
+  // number of tasks per worker when the pool chooses the task count under work stealing
+  int chunks_per_worker_{kDefaultChunksPerWorker};
   std::vector<std::unique_ptr<SpscTaskQueue> > queues_;
   std::unique_ptr<tvm::runtime::threading::ThreadGroup> threads_;
 };
 
+/*!
+ * \brief Process-wide thread pool shared by all launching threads.
+ *
+ *  Each launching thread publishes its launcher in an admission list and runs
+ *  its own tasks. Idle workers join the open launch that has the fewest
+ *  workers so far, oldest first, so concurrent launches share the cores
+ *  instead of every caller spinning up its own pool.
+ */
+class SharedThreadPool {
+ public:
+  SharedThreadPool() : num_workers_(tvm::runtime::threading::MaxConcurrency()) {
+    // worker 0 is not spawned, its share is taken by the launching threads.
+    threads_ = std::unique_ptr<tvm::runtime::threading::ThreadGroup>(
+        new tvm::runtime::threading::ThreadGroup(
+            num_workers_, [this](int worker_id) { this->RunWorker(worker_id); }, true));
+    // Any application thread may launch on the shared pool, so only the spawned
+    // workers are pinned and the launching threads keep their affinity.
+    num_workers_used_ = threads_->Configure(threading::ThreadGroup::kBig, 0, false);
+  }
+  ~SharedThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      exit_now_ = true;
+    }
+    parker_.NotifyAll();
+    threads_.reset();
+  }
+  int Launch(FTVMParallelLambda flambda, void* cdata, int num_task) {
+    ParallelLauncher* launcher = ParallelLauncher::ThreadLocal();
+    int num_workers_used = num_workers_used_.load(std::memory_order_relaxed);
+    if (num_task == 0) {
+      num_task = num_workers_used * chunks_per_worker_.load(std::memory_order_relaxed);
+    }
+    // Workers may be busy with other launches, so the tasks are not
+    // guaranteed to run at the same time and no barrier is offered.
+    launcher->Init(flambda, cdata, num_task, false);
+    launcher->work_stealing = true;
+    int num_slots = std::min(num_task, num_workers_used);
+    launcher->InitStealing(num_slots);
+    // slot 0 is owned by the launching thread.
+    if (num_slots > 1) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      admissions_.push_back(Admission{launcher, 1, num_slots});
+      num_free_slots_.fetch_add(num_slots - 1);
+    }
+    if (num_slots > 1) {
+      parker_.NotifyAll();
+    }
+    launcher->RunStealing(0);
+    if (num_slots > 1) {
+      int num_unclaimed = 0;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto it = admissions_.begin(); it != admissions_.end(); ++it) {
+          if (it->launcher == launcher) {
+            num_unclaimed = it->num_slots - it->next_slot;
+            admissions_.erase(it);
+            break;
+          }
+        }
+        num_free_slots_.fetch_sub(num_unclaimed);
+      }
+      launcher->ReleaseSlots(num_unclaimed);
+    }
+    return launcher->WaitForJobs();
+  }
+
+  void UpdateWorkerConfiguration(threading::ThreadGroup::AffinityMode mode, int nthreads) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int num_workers_used = threads_->Configure(mode, nthreads, false);
+    num_workers_used_.store(std::min(num_workers_, num_workers_used));
+  }
+
+  void UpdateWorkerNumaConfiguration(int numa_node, int nthreads) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int num_workers_used = threads_->ConfigureNumaNode(numa_node, nthreads, false);
+    num_workers_used_.store(std::min(num_workers_, num_workers_used));
+  }
+
+  int NumWorkersUsed() const { return num_workers_used_.load(std::memory_order_relaxed); }
+
+  void UpdateSchedulePolicy(SchedulePolicy policy, int chunks_per_worker) {
+    CHECK_GE(chunks_per_worker, 0) << "chunks_per_worker must be non-negative";
+    // launches on the shared pool are always balanced dynamically,
+    // the static policy only disables chunking.
+    if (policy == SchedulePolicy::kStatic) {
+      chunks_per_worker_.store(1);
+    } else {
+      chunks_per_worker_.store(chunks_per_worker == 0 ? kDefaultChunksPerWorker
+                                                      : chunks_per_worker);
+    }
+  }
+
+  static SharedThreadPool* Global() {
+    static SharedThreadPool inst;
+    return &inst;
+  }
+
+  static std::atomic<bool>* Enabled() {
+    static std::atomic<bool> enabled(GetUseSharedPool());
+    return &enabled;
+  }
+
+ private:
+  /*! \brief An open launch that workers can join. */
+  struct Admission {
+    ParallelLauncher* launcher;
+    // the next slot to hand out
+    int next_slot;
+    // total number of slots of the launch
+    int num_slots;
+  };
+  // Join the open launch with the fewest workers, requires mutex_ to be held.
+  bool TryJoin(ParallelLauncher** launcher, int* slot) {
+    Admission* best = nullptr;
+    for (Admission& adm : admissions_) {
+      if (adm.next_slot < adm.num_slots && (best == nullptr || adm.next_slot < best->next_slot)) {
+        best = &adm;
+      }
+    }
+    if (best == nullptr) return false;
+    *launcher = best->launcher;
+    *slot = best->next_slot++;
+    num_free_slots_.fetch_sub(1);
+    return true;
+  }
+  // Wait until there is an open launch to join.
+  bool WaitForLaunch(ParallelLauncher** launcher, int* slot, AdaptiveSpin* spin) {
+    spin->Spin([this] { return num_free_slots_.load() != 0; });
+    while (true) {
+      uint32_t epoch = parker_.PrepareWait();
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (exit_now_) return false;
+        if (TryJoin(launcher, slot)) return true;
+      }
+      spin->Park([this, epoch] { parker_.Wait(epoch); });
+    }
+  }
+  // Internal worker function.
+  void RunWorker(int worker_id) {
+    ParallelLauncher::ThreadLocal()->is_worker = true;
+    static size_t spin_count = GetSpinCount();
+    static bool adaptive_spin = GetAdaptiveSpin();
+    AdaptiveSpin spin(spin_count, adaptive_spin);
+    ParallelLauncher* launcher;
+    int slot;
+    while (WaitForLaunch(&launcher, &slot, &spin)) {
+      launcher->RunStealing(slot);
+    }
+  }
+  int num_workers_;
+  // number of workers used (can be restricted with affinity pref)
+  std::atomic<int> num_workers_used_{1};
+  // number of tasks per worker when the pool chooses the task count
+  std::atomic<int> chunks_per_worker_{kDefaultChunksPerWorker};
+  // number of slots in admissions_ that are not claimed yet
+  std::atomic<int> num_free_slots_{0};
+  // open launches in admission order, guarded by mutex_
+  std::vector<Admission> admissions_;
+  // signal for exit now, guarded by mutex_
+  bool exit_now_{false};
+  std::mutex mutex_;
+  // parks idle workers
+  Parker parker_;
+  std::unique_ptr<tvm::runtime::threading::ThreadGroup> threads_;
+};
+
+/*!
+ * \brief Run a nested parallel launch serially on the calling thread.
+ *  Launching from inside a running task would otherwise deadlock the pool.
+ */
+int RunParallelInline(FTVMParallelLambda flambda, void* cdata, int num_task) {
+  if (num_task == 0) {
+    num_task = 1;
+  }
+  // a barrier is trivially satisfied by a single task.
+  std::atomic<int32_t> sync_counter[kSyncStride];
+  sync_counter[0].store(0, std::memory_order_relaxed);
+  TVMParallelGroupEnv env;
+  env.num_task = num_task;
+  env.sync_handle = num_task == 1 ? sync_counter : nullptr;
+  for (int i = 0; i < num_task; ++i) {
+    if ((*flambda)(i, &env, cdata) != 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/*!
+ * \brief Dispatch a parallel launch to the thread pool in use.
+ */
+int ParallelLaunch(FTVMParallelLambda flambda, void* cdata, int num_task) {
+  ParallelLauncher* launcher = ParallelLauncher::ThreadLocal();
+  if (launcher->is_worker || launcher->in_region) {
+    return RunParallelInline(flambda, cdata, num_task);
+  }
+  struct RegionGuard {
+    explicit RegionGuard(ParallelLauncher* launcher) : launcher(launcher) {
+      launcher->in_region = true;
+    }
+    ~RegionGuard() { launcher->in_region = false; }
+    ParallelLauncher* launcher;
+  } guard(launcher);
+  // A thread with a task budget runs alongside other launching threads, so
+  // it only asks for its share of the workers.
+  int max_tasks = threading::MaxParallelTasks();
+  if (SharedThreadPool::Enabled()->load(std::memory_order_relaxed)) {
+    SharedThreadPool* pool = SharedThreadPool::Global();
+    if (num_task == 0 && max_tasks != 0) {
+      num_task = std::min(max_tasks, pool->NumWorkersUsed());
+    }
+    return pool->Launch(flambda, cdata, num_task);
+  }
+  ThreadPool* pool = ThreadPool::ThreadLocal();
+  if (num_task == 0 && max_tasks != 0) {
+    num_task = std::min(max_tasks, pool->NumWorkersUsed());
+  }
+  return pool->Launch(flambda, cdata, num_task, 1);
+}
+
 TVM_REGISTER_GLOBAL("runtime.config_threadpool").set_body([](TVMArgs args, TVMRetValue* rv) {
   threading::ThreadGroup::AffinityMode mode =
       static_cast<threading::ThreadGroup::AffinityMode>(static_cast<int>(args[0]));
   int nthreads = args[1];
-  ThreadPool::ThreadLocal()->UpdateWorkerConfiguration(mode, nthreads);
+  if (SharedThreadPool::Enabled()->load()) {
+    SharedThreadPool::Global()->UpdateWorkerConfiguration(mode, nthreads);
+  } else {
+    ThreadPool::ThreadLocal()->UpdateWorkerConfiguration(mode, nthreads);
+  }
+});
+
+// Pin the pool in use to one NUMA node, and make the calling thread allocate
+// from that node. Calling it from one launching thread per node gives one
+// thread local pool per node.
+TVM_REGISTER_GLOBAL("runtime.config_threadpool_numa").set_body([](TVMArgs args, TVMRetValue* rv) {
+  int numa_node = args[0];
+  int nthreads = 0;
+  if (args.size() > 1) {
+    nthreads = args[1];
+  }
+  CHECK(numa_node >= 0 && numa_node < threading::NumNumaNodes())
+      << "NUMA node " << numa_node << " does not exist";
+  if (SharedThreadPool::Enabled()->load()) {
+    SharedThreadPool::Global()->UpdateWorkerNumaConfiguration(numa_node, nthreads);
+  } else {
+    ThreadPool::ThreadLocal()->UpdateWorkerNumaConfiguration(numa_node, nthreads);
+  }
+  threading::SetPreferredNumaNode(numa_node);
+});
+
+namespace threading {
+
+int ConfigureThreadPoolCoreSlice(int slice, int num_slices) {
+  // The shared pool already splits its workers among concurrent launches.
+  if (SharedThreadPool::Enabled()->load()) {
+    return SharedThreadPool::Global()->NumWorkersUsed();
+  }
+  ThreadPool* pool = ThreadPool::ThreadLocal();
+  pool->UpdateWorkerCoreSliceConfiguration(slice, num_slices);
+  return pool->NumWorkersUsed();
+}
+
+}  // namespace threading
+
+TVM_REGISTER_GLOBAL("runtime.num_numa_nodes").set_body([](TVMArgs args, TVMRetValue* rv) {
+  *rv = threading::NumNumaNodes();
+});
+
+TVM_REGISTER_GLOBAL("runtime.threadpool_wait_stats").set_body([](TVMArgs args, TVMRetValue* rv) {
+  WaitStats* stats = WaitStats::Global();
+  std::ostringstream os;
+  os << "{\"spin_ns\": " << stats->spin_ns.load() << ", \"park_ns\": " << stats->park_ns.load()
+     << ", \"num_spin_wakeups\": " << stats->num_spin_wakeups.load()
+     << ", \"num_parks\": " << stats->num_parks.load() << "}";
+  if (args.size() > 0 && static_cast<bool>(args[0])) {
+    stats->Reset();
+  }
+  *rv = os.str();
+});
+
+TVM_REGISTER_GLOBAL("runtime.config_threadpool_shared").set_body([](TVMArgs args, TVMRetValue* rv) {
+  bool enable = args[0];
+  SharedThreadPool::Enabled()->store(enable);
+});
+
+TVM_REGISTER_GLOBAL("runtime.config_threadpool_policy").set_body([](TVMArgs args, TVMRetValue* rv) {
+  SchedulePolicy policy = static_cast<SchedulePolicy>(static_cast<int>(args[0]));
+  CHECK(policy == SchedulePolicy::kStatic || policy == SchedulePolicy::kWorkStealing)
+      << "Unknown thread pool schedule policy " << static_cast<int>(policy);
+  int chunks_per_worker = 0;
+  if (args.size() > 1) {
+    chunks_per_worker = args[1];
+  }
+  if (SharedThreadPool::Enabled()->load()) {
+    SharedThreadPool::Global()->UpdateSchedulePolicy(policy, chunks_per_worker);
+  } else {
+    ThreadPool::ThreadLocal()->UpdateSchedulePolicy(policy, chunks_per_worker);
+  }
 });
 
 }  // namespace runtime
@@ -364,10 +1016,12 @@ TVM_REGISTER_GLOBAL("runtime.config_threadpool").set_body([](TVMArgs args, TVMRe
 
 int TVMBackendParallelLaunch(FTVMParallelLambda flambda, void* cdata, int num_task) {
 #if !TVM_THREADPOOL_USE_OPENMP
-  int res = tvm::runtime::ThreadPool::ThreadLocal()->Launch(flambda, cdata, num_task, 1);
+  int res = tvm::runtime::ParallelLaunch(flambda, cdata, num_task);
   return res;
 #else
   int num_workers = tvm::runtime::threading::MaxConcurrency();
+  int max_tasks = tvm::runtime::threading::MaxParallelTasks();
+  if (max_tasks != 0) num_workers = std::min(num_workers, max_tasks);
   if (num_task == 0) num_task = num_workers;
   omp_set_num_threads(num_workers);
 #pragma omp parallel num_threads(num_workers)
@@ -387,6 +1041,14 @@ int TVMBackendParallelBarrier(int task_id, TVMParallelGroupEnv* penv) {
   using tvm::runtime::kSyncStride;
   int num_task = penv->num_task;
   std::atomic<int>* sync_counter = reinterpret_cast<std::atomic<int>*>(penv->sync_handle);
+  if (sync_counter == nullptr) {
+    // Called on a worker thread, so report the error to the launch instead of throwing. The
+    // counters are missing for every task of the launch, so none of them waits here.
+    TVMAPISetLastError(
+        "Parallel barrier needs every task to run on its own worker, which is not the case "
+        "for the shared thread pool, nested launches and chunked work stealing launches");
+    return -1;
+  }
   int old_counter = sync_counter[task_id * kSyncStride].fetch_add(1, std::memory_order_release);
   for (int i = 0; i < num_task; ++i) {
     if (i != task_id) {
@@ -25,7 +25,9 @@
 #include <tvm/runtime/threading_backend.h>
 
 #include <algorithm>
+#include <string>
 #include <thread>
+#include <vector>
 #if defined(__linux__) || defined(__ANDROID__)
 #include <fstream>
 #include <sstream>
@@ -33,6 +35,8 @@
 #endif
 #if defined(__linux__)
 #include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #endif
 #if defined(__hexagon__)
 #include <dlfcn.h>
@@ -42,6 +46,45 @@ namespace tvm {
 namespace runtime {
 namespace threading {
 
+#if defined(__linux__) || defined(__ANDROID__)
+// Parse a cpu list of the form "0-3,8,10-11" in sysfs.
+static std::vector<unsigned int> ParseCpuList(const std::string& path) {
+  std::vector<unsigned int> cpus;
+  std::ifstream ifs(path);
+  std::string list;
+  if (ifs.fail() || !std::getline(ifs, list)) return cpus;
+  std::istringstream is(list);
+  std::string range;
+  while (std::getline(is, range, ',')) {
+    if (range.empty()) continue;
+    size_t dash = range.find('-');
+    unsigned int begin = std::stoul(range.substr(0, dash));
+    unsigned int end = dash == std::string::npos ? begin : std::stoul(range.substr(dash + 1));
+    for (unsigned int cpu = begin; cpu <= end; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return cpus;
+}
+
+// The physical cores of a NUMA node, one logical cpu per core.
+static std::vector<unsigned int> NumaNodeCores(int numa_node) {
+  std::ostringstream node_path;
+  node_path << "/sys/devices/system/node/node" << numa_node << "/cpulist";
+  std::vector<unsigned int> cores;
+  for (unsigned int cpu : ParseCpuList(node_path.str())) {
+    std::ostringstream sibling_path;
+    sibling_path << "/sys/devices/system/cpu/cpu" << cpu << "/topology/thread_siblings_list";
+    std::vector<unsigned int> siblings = ParseCpuList(sibling_path.str());
+    // skip hyper-threading siblings
+    if (siblings.empty() || siblings[0] == cpu) {
+      cores.push_back(cpu);
+    }
+  }
+  return cores;
+}
+#endif
+
 class ThreadGroup::Impl {
  public:
   Impl(int num_workers, std::function<void(int)> worker_callback, bool exclude_worker0)
@@ -93,7 +136,79 @@ class ThreadGroup::Impl {
     return num_workers_used;
   }
 
+  int ConfigureNumaNode(int numa_node, int nthreads, bool exclude_worker0) {
+#if defined(__linux__) || defined(__ANDROID__)
+    std::vector<unsigned int> cores = NumaNodeCores(numa_node);
+    if (cores.empty()) {
+      // Containers and kernels without NUMA support may not expose the node topology.
+      LOG(WARNING) << "Cannot find the cores of NUMA node " << numa_node
+                   << ", use the big cores instead";
+      return Configure(kBig, nthreads, exclude_worker0);
+    }
+    return ConfigureCores(cores, nthreads, exclude_worker0);
+#else
+    LOG(WARNING) << "NUMA affinity is not supported on this platform";
+    return Configure(kBig, nthreads, exclude_worker0);
+#endif
+  }
+
+  int ConfigureCoreSlice(int slice, int num_slices, bool exclude_worker0) {
+    CHECK(num_slices >= 1 && slice >= 0 && slice < num_slices)
+        << "Invalid core slice " << slice << " of " << num_slices;
+#if defined(__linux__) || defined(__ANDROID__)
+    // the cores the default big core configuration uses
+    int num_cores = std::min(std::min(MaxConcurrency(), big_count_),
+                             static_cast<int>(sorted_order_.size()));
+    if (num_cores == 0) return Configure(kBig, 0, exclude_worker0);
+    int begin = slice * num_cores / num_slices;
+    int end = (slice + 1) * num_cores / num_slices;
+    if (begin == end) {
+      begin = slice % num_cores;
+      end = begin + 1;
+    }
+    std::vector<unsigned int> cores(sorted_order_.begin() + begin, sorted_order_.begin() + end);
+    return ConfigureCores(cores, 0, exclude_worker0);
+#else
+    return Configure(kBig, 0, exclude_worker0);
+#endif
+  }
+
  private:
+#if defined(__linux__) || defined(__ANDROID__)
+  // bind worker threads to the given cores,
+  // workers beyond the number of cores share them round robin.
+  int ConfigureCores(const std::vector<unsigned int>& cores, int nthreads, bool exclude_worker0) {
+    int num_workers_used = nthreads ? nthreads : static_cast<int>(cores.size());
+    num_workers_used = std::min(num_workers_, num_workers_used);
+    const char* val = getenv("TVM_BIND_THREADS");
+    if (val == nullptr || atoi(val) == 1) {
+      cpu_set_t all_cpuset;
+      CPU_ZERO(&all_cpuset);
+      for (unsigned int core : cores) {
+        CPU_SET(core, &all_cpuset);
+      }
+      for (unsigned i = 0; i < threads_.size(); ++i) {
+        cpu_set_t cpuset;
+        CPU_ZERO(&cpuset);
+        CPU_SET(cores[(i + exclude_worker0) % cores.size()], &cpuset);
+#if defined(__ANDROID__)
+        sched_setaffinity(threads_[i].native_handle(), sizeof(cpu_set_t), &cpuset);
+#else
+        pthread_setaffinity_np(threads_[i].native_handle(), sizeof(cpu_set_t), &cpuset);
+#endif
+      }
+      if (exclude_worker0) {
+#if defined(__ANDROID__)
+        sched_setaffinity(pthread_self(), sizeof(cpu_set_t), &all_cpuset);
+#else
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &all_cpuset);
+#endif
+      }
+    }
+    return num_workers_used;
+  }
+#endif
+
   // bind worker threads to disjoint cores
   // if worker 0 is offloaded to master, i.e. exclude_worker0 is true,
   // the master thread is bound to core 0.
@@ -235,6 +350,14 @@ int ThreadGroup::Configure(AffinityMode mode, int nthreads, bool exclude_worker0
   return impl_->Configure(mode, nthreads, exclude_worker0);
 }
 
+int ThreadGroup::ConfigureNumaNode(int numa_node, int nthreads, bool exclude_worker0) {
+  return impl_->ConfigureNumaNode(numa_node, nthreads, exclude_worker0);
+}
+
+int ThreadGroup::ConfigureCoreSlice(int slice, int num_slices, bool exclude_worker0) {
+  return impl_->ConfigureCoreSlice(slice, num_slices, exclude_worker0);
+}
+
 void Yield() { std::this_thread::yield(); }
 
 int MaxConcurrency() {
@@ -265,6 +388,56 @@ int MaxConcurrency() {
   return std::max(max_concurrency, 1);
 }
 
+int NumNumaNodes() {
+#if defined(__linux__) || defined(__ANDROID__)
+  static int num_nodes = [] {
+    std::vector<unsigned int> nodes = ParseCpuList("/sys/devices/system/node/online");
+    return nodes.empty() ? 1 : static_cast<int>(nodes.back()) + 1;
+  }();
+  return num_nodes;
+#else
+  return 1;
+#endif
+}
+
+static int* PreferredNumaNodeStore() {
+  static thread_local int numa_node = -1;
+  return &numa_node;
+}
+
+void SetPreferredNumaNode(int numa_node) {
+  CHECK_LT(numa_node, NumNumaNodes()) << "NUMA node " << numa_node << " does not exist";
+  *PreferredNumaNodeStore() = numa_node;
+}
+
+int PreferredNumaNode() { return *PreferredNumaNodeStore(); }
+
+static int* MaxParallelTasksStore() {
+  static thread_local int max_tasks = 0;
+  return &max_tasks;
+}
+
+void SetMaxParallelTasks(int max_tasks) {
+  CHECK_GE(max_tasks, 0) << "max_tasks must be non-negative";
+  *MaxParallelTasksStore() = max_tasks;
+}
+
+int MaxParallelTasks() { return *MaxParallelTasksStore(); }
+
+bool BindMemoryToNumaNode(void* ptr, size_t nbytes, int numa_node) {
+#if defined(__linux__) && defined(SYS_mbind)
+  // MPOL_PREFERRED in linux/mempolicy.h, falls back to other nodes when the node is full.
+  constexpr int kMemPolicyPreferred = 1;
+  constexpr size_t kBitsPerWord = 8 * sizeof(unsigned long);  // NOLINT(*)
+  std::vector<unsigned long> nodemask(numa_node / kBitsPerWord + 1, 0);  // NOLINT(*)
+  nodemask[numa_node / kBitsPerWord] |= 1UL << (numa_node % kBitsPerWord);
+  return syscall(SYS_mbind, ptr, nbytes, kMemPolicyPreferred, nodemask.data(),
+                 nodemask.size() * kBitsPerWord + 1, 0) == 0;
+#else
+  return false;
+#endif
+}
+
 }  // namespace threading
 }  // namespace runtime
 }  // namespace tvm
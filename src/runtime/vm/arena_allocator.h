@@ -0,0 +1,218 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file runtime/arena_allocator.h
+ * \brief An allocator that bump-allocates the storage of one VM invocation from
+ *  a single device buffer and recycles it once the invocation has finished.
+ */
+#ifndef TVM_RUNTIME_VM_ARENA_ALLOCATOR_H_
+#define TVM_RUNTIME_VM_ARENA_ALLOCATOR_H_
+
+#include <tvm/runtime/device_api.h>
+#include <tvm/runtime/vm/memory_manager.h>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+namespace vm {
+
+/*!
+ * \brief Arena allocator for the VM.
+ *
+ *  Storage is carved from the current arena by bumping an offset. Every arena
+ *  counts its live buffers, and is reset in O(1) when the count drops to zero.
+ *  Requests that do not fit are served directly by the device and recorded, so
+ *  that the arena is grown to the high-water mark of the previous invocation
+ *  when the VM calls EndInvocation.
+ *
+ *  Buffers that outlive the invocation, such as the returned tensors, keep
+ *  their arena alive: EndInvocation then retires the arena instead of reusing
+ *  it, and the retired arena is recycled once its last buffer is freed.
+ */
+class ArenaAllocator final : public Allocator {
+ public:
+  static constexpr size_t kDefaultPageSize = 4096;
+
+  explicit ArenaAllocator(TVMContext ctx, size_t page_size = kDefaultPageSize)
+      : Allocator(kArena), page_size_(page_size), ctx_(ctx) {
+    // Buffers on OpenCL, Vulkan and Metal are opaque handles that cannot be
+    // offset, so every request is served by the device there.
+    switch (static_cast<int>(ctx.device_type)) {
+      case kDLCPU:
+      case kDLCPUPinned:
+      case kDLGPU:
+      case kDLROCM:
+        bump_ = true;
+        break;
+      default:
+        bump_ = false;
+    }
+  }
+
+  ~ArenaAllocator() { ReleaseAll(); }
+
+  Buffer Alloc(size_t nbytes, size_t alignment, DLDataType type_hint) override {
+    std::lock_guard<std::mutex> lock(mu_);
+    Buffer buf;
+    buf.ctx = ctx_;
+    buf.size = nbytes;
+    if (bump_ && alignment <= page_size_) {
+      if (current_.base == nullptr && high_water_ != 0) {
+        current_ = NewArena(high_water_);
+      }
+      size_t offset = (current_.offset + alignment - 1) / alignment * alignment;
+      if (current_.base != nullptr && offset < current_.capacity &&
+          offset + nbytes <= current_.capacity) {
+        current_.offset = offset + nbytes;
+        current_.live += 1;
+        run_bytes_ = std::max(run_bytes_, current_.offset + run_overflow_bytes_);
+        buf.data = current_.base + offset;
+        return buf;
+      }
+      run_overflow_bytes_ += nbytes + alignment;
+      run_bytes_ = std::max(run_bytes_, current_.offset + run_overflow_bytes_);
+    }
+    buf.data = DeviceAPI::Get(ctx_)->AllocDataSpace(ctx_, nbytes, alignment, type_hint);
+    used_memory_.fetch_add(nbytes, std::memory_order_relaxed);
+    DLOG(INFO) << "allocate " << nbytes << " B outside the arena, used memory " << used_memory_
+               << " B";
+    return buf;
+  }
+
+  void Free(const Buffer& buffer) override {
+    std::lock_guard<std::mutex> lock(mu_);
+    char* ptr = static_cast<char*>(buffer.data);
+    if (current_.Contains(ptr)) {
+      if (--current_.live == 0) current_.offset = 0;
+      return;
+    }
+    for (size_t i = 0; i < retired_.size(); ++i) {
+      if (retired_[i].Contains(ptr)) {
+        if (--retired_[i].live == 0) {
+          Recycle(retired_[i]);
+          retired_[i] = retired_.back();
+          retired_.pop_back();
+        }
+        return;
+      }
+    }
+    DeviceAPI::Get(ctx_)->FreeDataSpace(ctx_, buffer.data);
+    used_memory_.fetch_sub(buffer.size, std::memory_order_relaxed);
+    DLOG(INFO) << "free " << buffer.size << " B, used memory " << used_memory_ << " B";
+  }
+
+  size_t UsedMemory() const override { return used_memory_.load(std::memory_order_relaxed); }
+
+  void EndInvocation() override {
+    std::lock_guard<std::mutex> lock(mu_);
+    size_t demand = (run_bytes_ + page_size_ - 1) / page_size_ * page_size_;
+    high_water_ = std::max(high_water_, demand);
+    run_bytes_ = 0;
+    run_overflow_bytes_ = 0;
+    if (current_.base == nullptr) return;
+    if (current_.live != 0) {
+      // Some buffers escaped the invocation; keep the arena until they are freed.
+      retired_.push_back(current_);
+      current_ = Arena();
+    } else if (current_.capacity < high_water_) {
+      Release(current_);
+      current_ = Arena();
+    } else {
+      current_.offset = 0;
+    }
+  }
+
+ private:
+  struct Arena {
+    char* base{nullptr};
+    size_t capacity{0};
+    size_t offset{0};
+    /*! \brief Number of buffers handed out from the arena and not yet freed. */
+    size_t live{0};
+
+    bool Contains(const char* ptr) const { return ptr >= base && ptr < base + capacity; }
+  };
+
+  Arena NewArena(size_t capacity) {
+    if (spare_.base != nullptr) {
+      Arena arena = spare_;
+      spare_ = Arena();
+      if (arena.capacity >= capacity) return arena;
+      Release(arena);
+    }
+    Arena arena;
+    arena.capacity = capacity;
+    arena.base = static_cast<char*>(DeviceAPI::Get(ctx_)->AllocDataSpace(
+        ctx_, capacity, page_size_, DLDataType{kDLUInt, 8, 1}));
+    used_memory_.fetch_add(capacity, std::memory_order_relaxed);
+    DLOG(INFO) << "allocate arena of " << capacity << " B, used memory " << used_memory_ << " B";
+    return arena;
+  }
+
+  /*! \brief Keep one drained arena around for the next invocation. */
+  void Recycle(Arena arena) {
+    arena.offset = 0;
+    if (arena.capacity >= high_water_ &&
+        (spare_.base == nullptr || spare_.capacity < arena.capacity)) {
+      std::swap(spare_, arena);
+    }
+    if (arena.base != nullptr) Release(arena);
+  }
+
+  void Release(const Arena& arena) {
+    DeviceAPI::Get(ctx_)->FreeDataSpace(ctx_, arena.base);
+    used_memory_.fetch_sub(arena.capacity, std::memory_order_relaxed);
+  }
+
+  void ReleaseAll() {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (current_.base != nullptr) Release(current_);
+    if (spare_.base != nullptr) Release(spare_);
+    for (auto const& arena : retired_) Release(arena);
+    current_ = spare_ = Arena();
+    retired_.clear();
+    DLOG(INFO) << "release all arenas";
+  }
+
+ private:
+  size_t page_size_;
+  bool bump_;
+  std::atomic<size_t> used_memory_{0};
+  /*! \brief Arena capacity needed by the largest invocation seen so far. */
+  size_t high_water_{0};
+  /*! \brief Bytes the current invocation has requested, in and outside the arena. */
+  size_t run_bytes_{0};
+  size_t run_overflow_bytes_{0};
+  Arena current_;
+  Arena spare_;
+  std::vector<Arena> retired_;
+  std::mutex mu_;
+  TVMContext ctx_;
+};
+
+}  // namespace vm
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_RUNTIME_VM_ARENA_ALLOCATOR_H_
@@ -0,0 +1,249 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file runtime/best_fit_allocator.h
+ * \brief An allocator that serves requests from the smallest cached block that
+ *  fits, splits and coalesces blocks inside a device allocation, and returns
+ *  cold memory to the device once the cache grows beyond a limit.
+ */
+#ifndef TVM_RUNTIME_VM_BEST_FIT_ALLOCATOR_H_
+#define TVM_RUNTIME_VM_BEST_FIT_ALLOCATOR_H_
+
+#include <tvm/runtime/device_api.h>
+#include <tvm/runtime/vm/memory_manager.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+namespace tvm {
+namespace runtime {
+namespace vm {
+
+class BestFitAllocator final : public Allocator {
+ public:
+  static constexpr size_t kDefaultPageSize = 4096;
+  /*!
+   * \brief Devices whose buffers are opaque handles cannot be split, so a cached
+   *  block is only reused when it wastes at most this factor of the request.
+   */
+  static constexpr size_t kMaxWholeBlockWaste = 2;
+
+  explicit BestFitAllocator(TVMContext ctx, size_t page_size = kDefaultPageSize)
+      : Allocator(kBestFit),
+        page_size_(page_size),
+        splittable_(SupportsSubAllocation(ctx)),
+        ctx_(ctx) {}
+
+  ~BestFitAllocator() { ReleaseAll(); }
+
+  Buffer Alloc(size_t nbytes, size_t alignment, DLDataType type_hint) override {
+    std::lock_guard<std::mutex> lock(mu_);
+    size_t size = ((nbytes + page_size_ - 1) / page_size_) * page_size_;
+    if (size == 0) size = page_size_;
+    for (auto it = free_blocks_.lower_bound(std::make_pair(size, uintptr_t(0)));
+         it != free_blocks_.end(); ++it) {
+      uintptr_t addr = it->second;
+      if (addr % alignment != 0) continue;
+      if (!splittable_ && it->first > size * kMaxWholeBlockWaste) break;
+      Block& block = blocks_.at(addr);
+      free_blocks_.erase(it);
+      cached_bytes_ -= block.size;
+      block.free = false;
+      if (splittable_ && block.size > size) {
+        // Return the tail of the block to the free list.
+        Block tail{block.size - size, block.region, true};
+        block.size = size;
+        blocks_.emplace(addr + size, tail);
+        free_blocks_.emplace(tail.size, addr + size);
+        cached_bytes_ += tail.size;
+      }
+      Region& region = regions_.at(block.region);
+      if (region.idle) {
+        idle_regions_.erase(std::make_pair(region.last_use, block.region));
+        region.idle = false;
+      }
+      region.last_use = ++clock_;
+      Buffer buf;
+      buf.ctx = ctx_;
+      buf.size = block.size;
+      buf.data = reinterpret_cast<void*>(addr);
+      return buf;
+    }
+    Buffer buf;
+    buf.ctx = ctx_;
+    buf.size = size;
+    buf.data = DeviceAPI::Get(ctx_)->AllocDataSpace(ctx_, size, alignment, type_hint);
+    uintptr_t addr = reinterpret_cast<uintptr_t>(buf.data);
+    regions_.emplace(addr, Region{size, ++clock_, false});
+    blocks_.emplace(addr, Block{size, addr, false});
+    used_memory_.fetch_add(size, std::memory_order_relaxed);
+    DLOG(INFO) << "allocate " << size << " B, used memory " << used_memory_ << " B";
+    return buf;
+  }
+
+  void Free(const Buffer& buffer) override {
+    std::lock_guard<std::mutex> lock(mu_);
+    uintptr_t addr = reinterpret_cast<uintptr_t>(buffer.data);
+    auto it = blocks_.find(addr);
+    CHECK(it != blocks_.end() && !it->second.free)
+        << "BestFitAllocator: free of unknown buffer " << buffer.data;
+    it->second.free = true;
+    // Merge with the following block if it belongs to the same device allocation.
+    auto next = std::next(it);
+    if (next != blocks_.end() && next->second.free && next->second.region == it->second.region) {
+      free_blocks_.erase(std::make_pair(next->second.size, next->first));
+      cached_bytes_ -= next->second.size;
+      it->second.size += next->second.size;
+      blocks_.erase(next);
+    }
+    // Merge into the preceding block under the same condition.
+    if (it != blocks_.begin()) {
+      auto prev = std::prev(it);
+      if (prev->second.free && prev->second.region == it->second.region) {
+        free_blocks_.erase(std::make_pair(prev->second.size, prev->first));
+        cached_bytes_ -= prev->second.size;
+        prev->second.size += it->second.size;
+        blocks_.erase(it);
+        it = prev;
+      }
+    }
+    free_blocks_.emplace(it->second.size, it->first);
+    cached_bytes_ += it->second.size;
+    Region& region = regions_.at(it->second.region);
+    region.last_use = ++clock_;
+    if (it->second.size == region.size) {
+      region.idle = true;
+      idle_regions_.emplace(region.last_use, it->second.region);
+    }
+    DLOG(INFO) << "reclaim buffer " << buffer.size << ", cached " << cached_bytes_ << " B";
+    Trim(CacheLimit().load(std::memory_order_relaxed));
+  }
+
+  size_t UsedMemory() const override { return used_memory_.load(std::memory_order_relaxed); }
+
+  /*!
+   * \brief The upper bound on bytes kept in free blocks by every best-fit
+   *  allocator. Device allocations that are entirely free are released, least
+   *  recently used first, until the cache is back under the limit. Initialized
+   *  from TVM_VM_ALLOCATOR_CACHE_LIMIT (bytes); unlimited by default.
+   */
+  static std::atomic<size_t>& CacheLimit() {
+    static std::atomic<size_t> limit([]() {
+      const char* val = getenv("TVM_VM_ALLOCATOR_CACHE_LIMIT");
+      if (val == nullptr) return std::numeric_limits<size_t>::max();
+      return static_cast<size_t>(std::strtoull(val, nullptr, 10));
+    }());
+    return limit;
+  }
+
+ private:
+  /*! \brief A contiguous piece of a device allocation. */
+  struct Block {
+    size_t size;
+    /*! \brief Base address of the device allocation this block was carved from. */
+    uintptr_t region;
+    bool free;
+  };
+  /*! \brief A single allocation obtained from the device. */
+  struct Region {
+    size_t size;
+    uint64_t last_use;
+    /*! \brief Whether the region is a single free block. */
+    bool idle;
+  };
+
+  /*!
+   * \brief Whether buffers on the device are raw pointers that can be offset.
+   *  OpenCL, Vulkan and Metal hand out opaque handles instead.
+   */
+  static bool SupportsSubAllocation(TVMContext ctx) {
+    switch (static_cast<int>(ctx.device_type)) {
+      case kDLCPU:
+      case kDLCPUPinned:
+      case kDLGPU:
+      case kDLROCM:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  void Trim(size_t limit) {
+    while (cached_bytes_ > limit && !idle_regions_.empty()) {
+      auto it = idle_regions_.begin();
+      uintptr_t addr = it->second;
+      idle_regions_.erase(it);
+      size_t size = regions_.at(addr).size;
+      free_blocks_.erase(std::make_pair(size, addr));
+      blocks_.erase(addr);
+      regions_.erase(addr);
+      cached_bytes_ -= size;
+      used_memory_.fetch_sub(size, std::memory_order_relaxed);
+      DeviceAPI::Get(ctx_)->FreeDataSpace(ctx_, reinterpret_cast<void*>(addr));
+      DLOG(INFO) << "release " << size << " B, used memory " << used_memory_ << " B";
+    }
+  }
+
+  void ReleaseAll() {
+    std::lock_guard<std::mutex> lock(mu_);
+    for (auto const& it : regions_) {
+      DeviceAPI::Get(ctx_)->FreeDataSpace(ctx_, reinterpret_cast<void*>(it.first));
+    }
+    regions_.clear();
+    blocks_.clear();
+    free_blocks_.clear();
+    idle_regions_.clear();
+    cached_bytes_ = 0;
+    used_memory_ = 0;
+    DLOG(INFO) << "release all buffers";
+  }
+
+ private:
+  size_t page_size_;
+  bool splittable_;
+  std::atomic<size_t> used_memory_{0};
+  /*! \brief Bytes held in free blocks. */
+  size_t cached_bytes_{0};
+  /*! \brief Logical clock used to order regions by recency. */
+  uint64_t clock_{0};
+  /*! \brief All blocks, free or in use, ordered by address so neighbours can be merged. */
+  std::map<uintptr_t, Block> blocks_;
+  /*! \brief Free blocks ordered by (size, address) for best-fit lookup. */
+  std::set<std::pair<size_t, uintptr_t> > free_blocks_;
+  /*! \brief Device allocations keyed by base address. */
+  std::unordered_map<uintptr_t, Region> regions_;
+  /*! \brief Entirely free regions ordered by (last use, base address). */
+  std::set<std::pair<uint64_t, uintptr_t> > idle_regions_;
+  std::mutex mu_;
+  TVMContext ctx_;
+};
+
+}  // namespace vm
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_RUNTIME_VM_BEST_FIT_ALLOCATOR_H_
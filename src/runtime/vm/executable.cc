@@ -36,6 +36,7 @@
 #include <utility>
 #include <vector>
 
+#include "../param_file.h"
 #include "serialize_util.h"
 
 namespace tvm {
@@ -67,6 +68,20 @@ PackedFunc Executable::GetFunction(const std::string& name, const ObjectPtr<Obje
       std::string func_name = args[0];
       *rv = this->GetFunctionArity(func_name);
     });
+  } else if (name == "save_to_mappable_file") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      this->SaveToMappableFile(args[0]);
+    });
+  } else if (name == "move_late_bound_consts") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      int64_t byte_limit = args[1];
+      CHECK_GE(byte_limit, 0) << "byte_limit must be non-negative";
+      this->MoveLateBoundConstantsToFile(args[0], static_cast<size_t>(byte_limit));
+    });
+  } else if (name == "load_late_bound_consts") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      this->LoadLateBoundConstantsFromFile(args[0]);
+    });
   } else if (name == "get_function_param_name") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
       std::string func_name = args[0];
@@ -103,6 +118,107 @@ std::string Executable::GetFunctionParameterName(std::string func_name, uint32_t
   return func.params[index];
 }
 
+void Executable::MoveLateBoundConstantsToFile(const std::string& path, size_t byte_limit) {
+  late_bound_constant_names.resize(constants.size());
+  // The bytes of the constants moved by an earlier call are only in its file, they have to be
+  // loaded to be written to the new one.
+  for (size_t i = 0; i < constants.size(); ++i) {
+    CHECK(constants[i].defined() || late_bound_constant_names[i].empty())
+        << "The late bound constant " << late_bound_constant_names[i]
+        << " is not loaded, call load_late_bound_consts before moving the constants again";
+  }
+  std::vector<std::pair<std::string, NDArray>> params;
+  for (size_t i = 0; i < constants.size(); ++i) {
+    if (!constants[i].defined()) continue;
+    // Constants moved by an earlier call stay late bound.
+    bool late_bound = !late_bound_constant_names[i].empty();
+    NDArray constant = Downcast<NDArray>(constants[i]);
+    if (!late_bound && GetDataSize(*constant.operator->()) < byte_limit) continue;
+    late_bound_constant_names[i] = GetConstantName(i);
+    params.emplace_back(late_bound_constant_names[i], constant);
+  }
+  SaveParamFile(path, params);
+  for (size_t i = 0; i < constants.size(); ++i) {
+    if (!late_bound_constant_names[i].empty()) constants[i] = ObjectRef();
+  }
+}
+
+void Executable::LoadLateBoundConstantsFromFile(const std::string& path) {
+  std::unordered_map<std::string, Index> indices;
+  for (size_t i = 0; i < late_bound_constant_names.size(); ++i) {
+    if (!late_bound_constant_names[i].empty()) indices[late_bound_constant_names[i]] = i;
+  }
+  for (auto& kv : LoadParamFile(path)) {
+    auto it = indices.find(kv.first);
+    CHECK(it != indices.end()) << "The executable has no late bound constant " << kv.first;
+    constants[it->second] = kv.second;
+  }
+}
+
+// Name of the serialized executable in a mappable executable file.
+constexpr const char* kMappableCodeName = "__vm_code__";
+
+void Executable::SaveToMappableFile(const std::string& path) {
+  // Serialize the code with every constant late bound, then store the constants
+  // under their names next to it.
+  std::vector<ObjectRef> saved_constants = constants;
+  std::vector<std::string> saved_names = late_bound_constant_names;
+  std::vector<std::pair<std::string, NDArray>> params;
+  late_bound_constant_names.resize(constants.size());
+  for (size_t i = 0; i < constants.size(); ++i) {
+    late_bound_constant_names[i] = GetConstantName(i);
+    if (constants[i].defined()) {
+      params.emplace_back(late_bound_constant_names[i], Downcast<NDArray>(constants[i]));
+      constants[i] = ObjectRef();
+    }
+  }
+  TVMByteArray code = Save();
+  constants = std::move(saved_constants);
+  late_bound_constant_names = std::move(saved_names);
+
+  NDArray code_array =
+      NDArray::Empty({static_cast<int64_t>(code.size)}, {kDLUInt, 8, 1}, {kDLCPU, 0});
+  code_array.CopyFromBytes(code.data, code.size);
+  params.emplace(params.begin(), kMappableCodeName, code_array);
+  SaveParamFile(path, params);
+}
+
+runtime::Module Executable::LoadFromMappableFile(const std::string& path,
+                                                 const runtime::Module lib) {
+  auto params = LoadParamFile(path);
+  CHECK(!params.empty() && params[0].first == kMappableCodeName)
+      << path << " is not a mappable VM executable file";
+  const NDArray& code_array = params[0].second;
+  std::string code(static_cast<const char*>(code_array->data),
+                   GetDataSize(*code_array.operator->()));
+  runtime::Module mod = Load(code, lib);
+  auto* exec = static_cast<Executable*>(mod.operator->());
+  std::unordered_map<std::string, Index> indices;
+  for (size_t i = 0; i < exec->late_bound_constant_names.size(); ++i) {
+    indices[exec->late_bound_constant_names[i]] = i;
+  }
+  for (size_t i = 1; i < params.size(); ++i) {
+    auto it = indices.find(params[i].first);
+    CHECK(it != indices.end()) << "The executable has no constant " << params[i].first;
+    exec->constants[it->second] = params[i].second;
+    // Constants stored in the file are regular constants of the loaded executable.
+    exec->late_bound_constant_names[it->second].clear();
+  }
+  bool has_late_bound = std::any_of(exec->late_bound_constant_names.begin(),
+                                    exec->late_bound_constant_names.end(),
+                                    [](const std::string& name) { return !name.empty(); });
+  if (!has_late_bound) exec->late_bound_constant_names.clear();
+  return mod;
+}
+
+std::string Executable::GetConstantName(Index index) const {
+  if (static_cast<size_t>(index) < late_bound_constant_names.size() &&
+      !late_bound_constant_names[index].empty()) {
+    return late_bound_constant_names[index];
+  }
+  return "const_" + std::to_string(index);
+}
+
 std::string Executable::GetBytecode() const {
   std::ostringstream oss;
 
@@ -144,6 +260,10 @@ std::string Executable::Stats() const {
   // Get the number of constants and the shape of each of them.
   oss << "  Constant shapes (# " << constants.size() << "): [";
   for (const auto& it : constants) {
+    if (!it.defined()) {
+      oss << "late bound, ";
+      continue;
+    }
     const auto constant = Downcast<NDArray>(it);
     const auto& shape = constant.Shape();
 
@@ -218,6 +338,9 @@ TVMByteArray Executable::Save() {
   // Code section.
   SaveCodeSection(&strm);
 
+  // Names of the late bound constants, readers of older executables stop before it.
+  strm.Write(late_bound_constant_names);
+
   TVMByteArray arr;
   arr.data = code_.c_str();
   arr.size = code_.length();
@@ -241,8 +364,10 @@ void Executable::SaveGlobalSection(dmlc::Stream* strm) {
 
 void Executable::SaveConstantSection(dmlc::Stream* strm) {
   std::vector<DLTensor*> arrays;
+  // late bound constants are saved as empty placeholders.
+  runtime::NDArray placeholder = runtime::NDArray::Empty({0}, {kDLFloat, 32, 1}, {kDLCPU, 0});
   for (const auto& obj : this->constants) {
-    const auto cell = Downcast<runtime::NDArray>(obj);
+    const auto cell = obj.defined() ? Downcast<runtime::NDArray>(obj) : placeholder;
     arrays.push_back(const_cast<DLTensor*>(cell.operator->()));
   }
   strm->Write(static_cast<uint64_t>(this->constants.size()));
@@ -486,6 +611,18 @@ runtime::Module Executable::Load(const std::string& code, const runtime::Module
   // Code section.
   exec->LoadCodeSection(&strm);
 
+  // Late bound constants, absent from older executables.
+  if (strm.Read(&exec->late_bound_constant_names)) {
+    STREAM_CHECK(exec->late_bound_constant_names.empty() ||
+                     exec->late_bound_constant_names.size() == exec->constants.size(),
+                 "late bound constant");
+    for (size_t i = 0; i < exec->late_bound_constant_names.size(); ++i) {
+      if (!exec->late_bound_constant_names[i].empty()) exec->constants[i] = ObjectRef();
+    }
+  } else {
+    exec->late_bound_constant_names.clear();
+  }
+
   return runtime::Module(exec);
 }
 
@@ -791,6 +928,11 @@ TVM_REGISTER_GLOBAL("runtime.Load_Executable")
       return Executable::Load(code, lib);
     });
 
+TVM_REGISTER_GLOBAL("runtime.Load_ExecutableFromMappableFile")
+    .set_body_typed([](std::string path, runtime::Module lib) {
+      return Executable::LoadFromMappableFile(path, lib);
+    });
+
 }  // namespace vm
 }  // namespace runtime
 }  // namespace tvm
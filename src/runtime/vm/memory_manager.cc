@@ -21,11 +21,16 @@
  * \file tvm/runtime/vm/memory_manager.cc
  * \brief Allocate and manage memory for the runtime.
  */
+#include <tvm/runtime/registry.h>
 #include <tvm/runtime/vm/memory_manager.h>
 
+#include <limits>
 #include <memory>
+#include <sstream>
 #include <utility>
 
+#include "arena_allocator.h"
+#include "best_fit_allocator.h"
 #include "naive_allocator.h"
 #include "pooled_allocator.h"
 
@@ -33,11 +38,17 @@ namespace tvm {
 namespace runtime {
 namespace vm {
 
+/*! \brief A buffer of an NDArray allocated by Allocator::Empty. */
+struct EmptyBuffer {
+  Buffer buffer;
+  Allocator* allocator;
+};
+
 static void BufferDeleter(Object* obj) {
   auto* ptr = static_cast<NDArray::Container*>(obj);
   CHECK(ptr->manager_ctx != nullptr);
-  Buffer* buffer = reinterpret_cast<Buffer*>(ptr->manager_ctx);
-  MemoryManager::GetAllocator(buffer->ctx)->Free(*(buffer));
+  EmptyBuffer* buffer = reinterpret_cast<EmptyBuffer*>(ptr->manager_ctx);
+  buffer->allocator->Free(buffer->buffer);
   delete buffer;
   delete ptr;
 }
@@ -114,49 +125,55 @@ MemoryManager* MemoryManager::Global() {
   return &memory_manager;
 }
 
-Allocator* MemoryManager::GetOrCreateAllocator(TVMContext ctx, AllocatorType type) {
-  MemoryManager* m = MemoryManager::Global();
-  std::lock_guard<std::mutex> lock(m->mu_);
-  if (m->allocators_.find(ctx) == m->allocators_.end()) {
-    std::unique_ptr<Allocator> alloc;
-    switch (type) {
-      case kNaive: {
-        DLOG(INFO) << "New naive allocator for " << DeviceName(ctx.device_type) << "("
-                   << ctx.device_id << ")";
-        alloc.reset(new NaiveAllocator(ctx));
-        break;
-      }
-      case kPooled: {
-        DLOG(INFO) << "New pooled allocator for " << DeviceName(ctx.device_type) << "("
-                   << ctx.device_id << ")";
-        alloc.reset(new PooledAllocator(ctx));
-        break;
-      }
-      default:
-        LOG(FATAL) << "Unknown allocator type: " << type;
+std::shared_ptr<Allocator> MemoryManager::CreateAllocator(TVMContext ctx, AllocatorType type) {
+  switch (type) {
+    case kNaive: {
+      DLOG(INFO) << "New naive allocator for " << DeviceName(ctx.device_type) << "("
+                 << ctx.device_id << ")";
+      return std::make_shared<NaiveAllocator>(ctx);
+    }
+    case kPooled: {
+      DLOG(INFO) << "New pooled allocator for " << DeviceName(ctx.device_type) << "("
+                 << ctx.device_id << ")";
+      return std::make_shared<PooledAllocator>(ctx);
+    }
+    case kBestFit: {
+      DLOG(INFO) << "New best-fit allocator for " << DeviceName(ctx.device_type) << "("
+                 << ctx.device_id << ")";
+      return std::make_shared<BestFitAllocator>(ctx);
+    }
+    case kArena: {
+      DLOG(INFO) << "New arena allocator for " << DeviceName(ctx.device_type) << "("
+                 << ctx.device_id << ")";
+      return std::make_shared<ArenaAllocator>(ctx);
     }
-    auto ret = alloc.get();
-    m->allocators_.emplace(ctx, std::move(alloc));
-    return ret;
+    default:
+      LOG(FATAL) << "Unknown allocator type: " << type;
   }
-  auto alloc = m->allocators_.at(ctx).get();
-  if (alloc->type() != type) {
-    LOG(WARNING) << "The type of existing allocator for " << DeviceName(ctx.device_type) << "("
-                 << ctx.device_id << ") is different from the request type (" << alloc->type()
-                 << " vs " << type << ")";
+  return nullptr;
+}
+
+std::shared_ptr<Allocator> MemoryManager::GetOrCreateAllocator(TVMContext ctx,
+                                                               AllocatorType type) {
+  MemoryManager* m = MemoryManager::Global();
+  std::lock_guard<std::mutex> lock(m->mu_);
+  auto& allocators = m->allocators_[ctx];
+  auto it = allocators.find(type);
+  if (it == allocators.end()) {
+    it = allocators.emplace(type, CreateAllocator(ctx, type)).first;
   }
-  return alloc;
+  return it->second;
 }
 
-Allocator* MemoryManager::GetAllocator(TVMContext ctx) {
+Allocator* MemoryManager::GetAllocator(TVMContext ctx, AllocatorType type) {
   MemoryManager* m = MemoryManager::Global();
   std::lock_guard<std::mutex> lock(m->mu_);
   auto it = m->allocators_.find(ctx);
-  if (it == m->allocators_.end()) {
-    LOG(FATAL) << "Allocator for " << DeviceName(ctx.device_type) << "(" << ctx.device_id
-               << ") has not been created yet.";
+  if (it == m->allocators_.end() || it->second.count(type) == 0) {
+    LOG(FATAL) << "Allocator of type " << type << " for " << DeviceName(ctx.device_type) << "("
+               << ctx.device_id << ") has not been created yet.";
   }
-  return it->second.get();
+  return it->second.at(type).get();
 }
 
 NDArray Allocator::Empty(std::vector<int64_t> shape, DLDataType dtype, DLContext ctx) {
@@ -165,13 +182,19 @@ NDArray Allocator::Empty(std::vector<int64_t> shape, DLDataType dtype, DLContext
   container->SetDeleter(BufferDeleter);
   size_t size = GetDataSize(container->dl_tensor);
   size_t alignment = GetDataAlignment(container->dl_tensor);
-  Buffer* buffer = new Buffer;
-  *buffer = this->Alloc(size, alignment, dtype);
+  EmptyBuffer* buffer = new EmptyBuffer;
+  buffer->buffer = this->Alloc(size, alignment, dtype);
+  buffer->allocator = this;
   container->manager_ctx = reinterpret_cast<void*>(buffer);
-  container->dl_tensor.data = buffer->data;
+  container->dl_tensor.data = buffer->buffer.data;
   return NDArray(GetObjectPtr<Object>(container));
 }
 
+TVM_REGISTER_GLOBAL("runtime.SetBestFitAllocatorCacheLimit").set_body_typed([](int64_t nbytes) {
+  BestFitAllocator::CacheLimit() =
+      nbytes < 0 ? std::numeric_limits<size_t>::max() : static_cast<size_t>(nbytes);
+});
+
 }  // namespace vm
 }  // namespace runtime
 }  // namespace tvm
@@ -28,9 +28,11 @@
 
 #include <algorithm>
 #include <chrono>
+#include <functional>
 #include <iomanip>
 #include <memory>
 #include <numeric>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -39,6 +41,35 @@ namespace tvm {
 namespace runtime {
 namespace vm {
 
+namespace {
+
+/*! \brief The names of the instruction kinds, in Opcode order followed by shape functions. */
+const char* const kInstructionKindNames[] = {"Move",
+                                             "Ret",
+                                             "Invoke",
+                                             "InvokeClosure",
+                                             "InvokePacked",
+                                             "AllocTensor",
+                                             "AllocTensorReg",
+                                             "AllocADT",
+                                             "AllocClosure",
+                                             "GetField",
+                                             "If",
+                                             "LoadConst",
+                                             "Goto",
+                                             "GetTag",
+                                             "LoadConsti",
+                                             "Fatal",
+                                             "AllocStorage",
+                                             "ShapeOf",
+                                             "ReshapeTensor",
+                                             "InvokePacked(shape_func)"};
+
+}  // namespace
+
+constexpr size_t VirtualMachineDebug::kShapeFuncKind;
+constexpr size_t VirtualMachineDebug::kNumInstructionKinds;
+
 PackedFunc VirtualMachineDebug::GetFunction(const std::string& name,
                                             const ObjectPtr<Object>& sptr_to_self) {
   if (name == "get_stat") {
@@ -87,6 +118,51 @@ PackedFunc VirtualMachineDebug::GetFunction(const std::string& name,
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
       op_durations_.clear();
       op_invokes_.clear();
+      op_perf_stats_.clear();
+      for (auto& stats : instr_stats_) stats.fill(InstructionStat());
+      returned_invocations_ = 0;
+      max_frame_depth_ = 0;
+    });
+  } else if (name == "enable_instruction_profile") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      profile_instructions_ = args[0];
+    });
+  } else if (name == "get_instruction_stat") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      *rv = FormatInstructionReport();
+    });
+  } else if (name == "enable_perf_counters") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      perf_counters_.Close();
+      bool enable = args[0];
+      std::string error;
+      if (enable && !perf_counters_.Open(&error)) {
+        LOG(WARNING) << "Cannot count hardware events: " << error;
+      }
+      *rv = perf_counters_.is_open();
+    });
+  } else if (name == "set_op_flops") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      CHECK_EQ(args.num_args % 2, 0) << "set_op_flops expects pairs of name and flops";
+      for (int i = 0; i < args.num_args; i += 2) {
+        std::string op_name = args[i];
+        op_flops_[op_name] = args[i + 1];
+      }
+    });
+  } else if (name == "get_perf_counters") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      std::vector<std::pair<std::string, PerfCounterStats>> rows;
+      for (const auto& kv : op_perf_stats_) {
+        const std::string& op_name = packed_index_map_[kv.first];
+        PerfCounterStats stats = kv.second;
+        auto it = op_flops_.find(op_name);
+        if (it != op_flops_.end()) stats.flops = it->second;
+        rows.emplace_back(op_name, stats);
+      }
+      std::sort(rows.begin(), rows.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.second.counts[kPerfCycles] > rhs.second.counts[kPerfCycles];
+      });
+      *rv = FormatPerfCounterReport(rows);
     });
   } else {
     return VirtualMachine::GetFunction(name, sptr_to_self);
@@ -100,20 +176,141 @@ void VirtualMachineDebug::LoadExecutable(const Executable* exec) {
     packed_index_map_[kv.second] = kv.first;
     op_invokes_[kv.second] = 0;
   }
+  instr_stats_.assign(exec_->functions.size(), {});
+}
+
+void VirtualMachineDebug::OnInstruction(const Instruction& instr) {
+  RecordInstruction(std::chrono::steady_clock::now());
+  timed_func_ = func_index_;
+  timed_kind_ = static_cast<size_t>(instr.op);
+  if (instr.op == Opcode::InvokePacked && is_shape_func_[instr.packed_index]) {
+    timed_kind_ = kShapeFuncKind;
+  }
+  max_frame_depth_ = std::max(max_frame_depth_, frames_.size());
+  // Start timing after the bookkeeping so it is not counted as interpreter time.
+  timed_begin_ = std::chrono::steady_clock::now();
+}
+
+void VirtualMachineDebug::OnRunLoopExit(bool returned) {
+  RecordInstruction(std::chrono::steady_clock::now());
+  if (returned) ++returned_invocations_;
+}
+
+void VirtualMachineDebug::RecordInstruction(std::chrono::steady_clock::time_point end) {
+  if (timed_func_ < 0) return;
+  if (static_cast<size_t>(timed_func_) < instr_stats_.size()) {
+    InstructionStat* stat = &instr_stats_[timed_func_][timed_kind_];
+    stat->count += 1;
+    stat->duration += std::chrono::duration<double, std::micro>(end - timed_begin_).count();
+  }
+  timed_func_ = -1;
+}
+
+std::string VirtualMachineDebug::FormatInstructionReport() const {
+  static_assert(sizeof(kInstructionKindNames) / sizeof(kInstructionKindNames[0]) ==
+                    kNumInstructionKinds,
+                "Every instruction kind needs a name");
+  auto kind = [](Opcode op) { return static_cast<size_t>(op); };
+  std::array<InstructionStat, kNumInstructionKinds> totals;
+  std::vector<std::pair<double, size_t>> funcs;
+  double total_duration = 0.0;
+  for (size_t i = 0; i < instr_stats_.size(); ++i) {
+    double func_duration = 0.0;
+    for (size_t k = 0; k < kNumInstructionKinds; ++k) {
+      totals[k].count += instr_stats_[i][k].count;
+      totals[k].duration += instr_stats_[i][k].duration;
+      func_duration += instr_stats_[i][k].duration;
+    }
+    funcs.emplace_back(func_duration, i);
+    total_duration += func_duration;
+  }
+  std::sort(funcs.begin(), funcs.end(), std::greater<std::pair<double, size_t>>());
+  auto percent = [total_duration](double duration) {
+    return total_duration > 0 ? duration / total_duration * 100 : 0.0;
+  };
+
+  std::ostringstream os;
+  os << std::fixed << std::setprecision(3);
+  for (const auto& func : funcs) {
+    const auto& stats = instr_stats_[func.second];
+    std::vector<size_t> kinds;
+    for (size_t k = 0; k < kNumInstructionKinds; ++k) {
+      if (stats[k].count > 0) kinds.push_back(k);
+    }
+    if (kinds.empty()) continue;
+    std::sort(kinds.begin(), kinds.end(),
+              [&stats](size_t lhs, size_t rhs) { return stats[lhs].duration > stats[rhs].duration; });
+    os << "Function " << exec_->functions[func.second].name << ": " << func.first << " us ("
+       << percent(func.first) << "%)" << std::endl;
+    os << std::setw(30) << std::left << "#Instruction"
+       << "\t" << std::setw(10) << std::left << "#Count"
+       << "\t"
+       << "#Duration(us): Sum/Mean"
+       << "\t"
+       << "#Percent" << std::endl;
+    for (size_t k : kinds) {
+      os << std::setw(30) << std::left << kInstructionKindNames[k] << "\t" << std::setw(10)
+         << std::left << stats[k].count << "\t" << stats[k].duration << "/"
+         << stats[k].duration / stats[k].count << "\t" << percent(stats[k].duration) << std::endl;
+    }
+    os << std::endl;
+  }
+
+  const InstructionStat& alloc_storage = totals[kind(Opcode::AllocStorage)];
+  double kernels = totals[kind(Opcode::InvokePacked)].duration;
+  double shape_funcs = totals[kShapeFuncKind].duration;
+  double memory = alloc_storage.duration + totals[kind(Opcode::AllocTensor)].duration +
+                  totals[kind(Opcode::AllocTensorReg)].duration;
+  double interpreter = total_duration - kernels - shape_funcs - memory;
+  int64_t calls = totals[kind(Opcode::Invoke)].count + totals[kind(Opcode::InvokeClosure)].count;
+  os << "Kernels: " << kernels << " us (" << percent(kernels) << "%)" << std::endl;
+  os << "Shape functions: " << shape_funcs << " us (" << percent(shape_funcs) << "%)"
+     << std::endl;
+  os << "Memory (AllocStorage, AllocTensor, AllocTensorReg): " << memory << " us ("
+     << percent(memory) << "%), " << alloc_storage.count << " AllocStorage at "
+     << (alloc_storage.count > 0 ? alloc_storage.duration / alloc_storage.count : 0.0)
+     << " us each" << std::endl;
+  os << "Interpreter (other instructions): " << interpreter << " us (" << percent(interpreter)
+     << "%)" << std::endl;
+  os << "Frames pushed: " << calls + returned_invocations_
+     << ", popped: " << totals[kind(Opcode::Ret)].count << ", max depth: " << max_frame_depth_
+     << std::endl;
+  os << "Total Duration: " << total_duration << " us." << std::endl;
+  return os.str();
 }
 
 void VirtualMachineDebug::InvokePacked(Index packed_index, const PackedFunc& func, Index arg_count,
                                        Index output_size, const std::vector<ObjectRef>& args) {
   CHECK(exec_);
   auto ctx = this->GetParamsContext();
-  // warmup
-  VirtualMachine::InvokePacked(packed_index, func, arg_count, output_size, args);
-  TVMSynchronize(ctx.device_type, ctx.device_id, nullptr);
+  // Skip the warmup when profiling instructions, so that the instruction times add up to the
+  // time of the invocation.
+  if (!profile_instructions_) {
+    VirtualMachine::InvokePacked(packed_index, func, arg_count, output_size, args);
+    TVMSynchronize(ctx.device_type, ctx.device_id, nullptr);
+  }
 
+  if (perf_counters_.is_open()) perf_counters_.Start();
   auto op_begin = std::chrono::high_resolution_clock::now();
   VirtualMachine::InvokePacked(packed_index, func, arg_count, output_size, args);
   TVMSynchronize(ctx.device_type, ctx.device_id, nullptr);
   auto op_end = std::chrono::high_resolution_clock::now();
+  if (perf_counters_.is_open()) {
+    PerfCounterStats* stats = &op_perf_stats_[packed_index];
+    perf_counters_.Stop(stats);
+    stats->bytes = 0;
+    for (const ObjectRef& arg : args) {
+      if (const auto* nd = arg.as<NDArray::ContainerType>()) {
+        stats->bytes += static_cast<int64_t>(GetDataSize(nd->dl_tensor));
+      } else if (const auto* adt = arg.as<ADTObj>()) {
+        for (size_t i = 0; i < adt->size; ++i) {
+          if (const auto* field = (*adt)[i].as<NDArray::ContainerType>()) {
+            stats->bytes += static_cast<int64_t>(GetDataSize(field->dl_tensor));
+          }
+        }
+      }
+    }
+  }
   double op_duration =
       std::chrono::duration_cast<std::chrono::duration<double>>(op_end - op_begin).count();
 
@@ -27,11 +27,15 @@
 
 #include <tvm/runtime/vm/vm.h>
 
+#include <array>
+#include <chrono>
 #include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "../../perf_counters.h"
+
 namespace tvm {
 namespace runtime {
 namespace vm {
@@ -50,9 +54,43 @@ class VirtualMachineDebug : public VirtualMachine {
   void InvokePacked(Index packed_index, const PackedFunc& func, Index arg_count, Index output_size,
                     const std::vector<ObjectRef>& args) final;
 
+  void OnInstruction(const Instruction& instr) final;
+
+  void OnRunLoopExit(bool returned) final;
+
+  /*! \brief Add the time of the instruction being timed, which completed at end. */
+  void RecordInstruction(std::chrono::steady_clock::time_point end);
+
+  /*! \brief Format the instruction statistics grouped by function. */
+  std::string FormatInstructionReport() const;
+
+  /*! \brief The count and total duration in microseconds of one kind of instruction. */
+  struct InstructionStat {
+    int64_t count{0};
+    double duration{0.0};
+  };
+  /*! \brief The instruction kinds profiled, the opcodes followed by shape function calls. */
+  static constexpr size_t kShapeFuncKind = static_cast<size_t>(Opcode::ReshapeTensor) + 1;
+  static constexpr size_t kNumInstructionKinds = kShapeFuncKind + 1;
+
   std::unordered_map<Index, std::string> packed_index_map_;
   std::unordered_map<Index, std::vector<double>> op_durations_;
   std::unordered_map<Index, int> op_invokes_;
+  /*! \brief The hardware counters, closed unless enabled. */
+  PerfCounters perf_counters_;
+  std::unordered_map<Index, PerfCounterStats> op_perf_stats_;
+  /*! \brief The floating point operations of function names. */
+  std::unordered_map<std::string, double> op_flops_;
+  /*! \brief The instruction statistics of each function, by function index. */
+  std::vector<std::array<InstructionStat, kNumInstructionKinds>> instr_stats_;
+  /*! \brief The function and kind of the instruction being timed, the function is -1 if none. */
+  Index timed_func_{-1};
+  size_t timed_kind_{0};
+  std::chrono::steady_clock::time_point timed_begin_;
+  /*! \brief The number of invocations that returned, each pushed a frame for its entry. */
+  int64_t returned_invocations_{0};
+  /*! \brief The deepest call stack seen. */
+  size_t max_frame_depth_{0};
 };
 
 }  // namespace vm
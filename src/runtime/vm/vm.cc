@@ -31,8 +31,13 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
 #include <stdexcept>
+#include <utility>
 #include <vector>
 
 using namespace tvm::runtime;
@@ -62,6 +67,16 @@ std::ostream& operator<<(std::ostream& os, const VMFunction& vm_func) {
   return os;
 }
 
+// The number of opcodes, LoadExecutable rejects bytecode with any other opcode.
+constexpr size_t kNumOpcodes = static_cast<size_t>(Opcode::ReshapeTensor) + 1;
+
+// Dispatch the interpreter loop with computed gotos when the compiler supports them.
+#if defined(__GNUC__) && !USE_RELAY_DEBUG
+#define TVM_VM_COMPUTED_GOTO 1
+#else
+#define TVM_VM_COMPUTED_GOTO 0
+#endif
+
 inline ObjectRef CopyTo(ObjectRef src, const DLContext& ctx) {
   if (src->IsInstance<NDArray::ContainerType>()) {
     auto nd_array = Downcast<NDArray>(src);
@@ -102,25 +117,96 @@ std::vector<int64_t> ToShape(NDArray shape_tensor) {
   return shape;
 }
 
+// Shape function inputs with more bytes than this are not cached.
+constexpr size_t kMaxShapeCacheKeyBytes = 4096;
+
+// Collect the tensors among args[begin, end), flattening tuples.
+void FlattenTensors(const std::vector<ObjectRef>& args, Index begin, Index end,
+                    std::vector<NDArray>* tensors) {
+  for (Index i = begin; i < end; ++i) {
+    if (const auto* adt = args[i].as<ADTObj>()) {
+      for (size_t fi = 0; fi < adt->size; ++fi) {
+        tensors->push_back(Downcast<NDArray>((*adt)[fi]));
+      }
+    } else {
+      tensors->push_back(Downcast<NDArray>(args[i]));
+    }
+  }
+}
+
+// The data of a contiguous CPU tensor, or nullptr for any other tensor.
+char* CPUData(const NDArray& arr) {
+  if (arr->ctx.device_type != kDLCPU || !arr.IsContiguous()) return nullptr;
+  return static_cast<char*>(arr->data) + arr->byte_offset;
+}
+
+// Append the type, shape and contents of a shape function input to a cache key.
+bool AppendShapeCacheKey(const NDArray& arr, std::string* key) {
+  const char* data = CPUData(arr);
+  size_t nbytes = GetDataSize(*arr.operator->());
+  if (data == nullptr || key->size() + nbytes > kMaxShapeCacheKeyBytes) return false;
+  key->append(reinterpret_cast<const char*>(&arr->dtype), sizeof(arr->dtype));
+  key->append(reinterpret_cast<const char*>(&arr->ndim), sizeof(arr->ndim));
+  key->append(reinterpret_cast<const char*>(arr->shape), sizeof(int64_t) * arr->ndim);
+  key->append(data, nbytes);
+  return true;
+}
+
+// Report which constants were loaded by the runs so far as JSON. The late bound constants
+// no run loaded are listed as unloaded, their bytes only stay in the parameter file.
+std::string ConstantUsage(const Executable* exec, const std::vector<ObjectRef>& const_pool) {
+  int64_t num_used = 0, bytes_used = 0, bytes_total = 0;
+  std::ostringstream used, unused, unloaded;
+  for (size_t i = 0; i < exec->constants.size(); ++i) {
+    bool is_used = i < const_pool.size() && const_pool[i].defined();
+    bool is_late_bound = i < exec->late_bound_constant_names.size() &&
+                         !exec->late_bound_constant_names[i].empty();
+    int64_t nbytes = 0;
+    if (is_used || !is_late_bound) {
+      const ObjectRef& constant = is_used ? const_pool[i] : exec->constants[i];
+      if (const auto* nd = constant.as<NDArray::ContainerType>()) {
+        nbytes = static_cast<int64_t>(GetDataSize(nd->dl_tensor));
+      }
+    }
+    bytes_total += nbytes;
+    std::ostringstream& names = is_used ? used : (is_late_bound ? unloaded : unused);
+    if (names.tellp() != 0) names << ", ";
+    names << "\"" << exec->GetConstantName(i) << "\"";
+    if (is_used) {
+      ++num_used;
+      bytes_used += nbytes;
+    }
+  }
+  std::ostringstream os;
+  os << "{\"num_params\": " << exec->constants.size() << ", \"num_used\": " << num_used
+     << ", \"bytes_total\": " << bytes_total << ", \"bytes_used\": " << bytes_used
+     << ", \"used\": [" << used.str() << "], \"unused\": [" << unused.str()
+     << "], \"unloaded\": [" << unloaded.str() << "]}";
+  return os.str();
+}
+
 PackedFunc VirtualMachine::GetFunction(const std::string& name,
                                        const ObjectPtr<Object>& sptr_to_self) {
   if (name == "invoke") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
-      CHECK(exec_) << "The executable is not created yet.";
-      std::string func_name = args[0];
-      auto git = exec_->global_map.find(func_name);
-      CHECK(git != exec_->global_map.end())
-          << "Cannot find function " << func_name << " in the executable";
-      auto func = exec_->functions[git->second];
-      if (func.params.empty()) {
-        *rv = Invoke(func, {});
-      } else {
-        auto it = inputs_.find(func_name);
-        CHECK(it != inputs_.end()) << "Input has not been set for function " << func_name;
-        const std::vector<ObjectRef>& func_args = it->second;
-        *rv = Invoke(func, func_args);
-      }
+      CHECK(!async_running_) << "An asynchronous invocation is in progress";
+      std::vector<ObjectRef> func_args;
+      const auto& func = GetFunctionInputs(args[0], &func_args);
+      *rv = Invoke(func, func_args);
+    });
+  } else if (name == "invoke_async") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      std::vector<ObjectRef> func_args;
+      const auto& func = GetFunctionInputs(args[0], &func_args);
+      InvokeAsync(func, func_args);
     });
+  } else if (name == "resume") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      ObjectRef result;
+      if (Resume(&result)) *rv = result;
+    });
+  } else if (name == "cancel_async") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { CancelAsync(); });
   } else if (name == "init") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
       CHECK_EQ(args.size() % 3, 0);
@@ -137,6 +223,72 @@ PackedFunc VirtualMachine::GetFunction(const std::string& name,
       }
       this->Init(contexts, alloc_types);
     });
+  } else if (name == "get_allocator_stats") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      CHECK(!ctxs_.empty()) << "The VirtualMachine is not initialized with contexts";
+      const Allocator* alloc = allocators_.at(ctxs_[0]).get();
+      const char* type = "unknown";
+      switch (alloc->type()) {
+        case kNaive:
+          type = "naive";
+          break;
+        case kPooled:
+          type = "pooled";
+          break;
+        case kBestFit:
+          type = "best_fit";
+          break;
+        case kArena:
+          type = "arena";
+          break;
+      }
+      std::ostringstream os;
+      os << "{\"type\": \"" << type << "\", \"used_memory\": " << alloc->UsedMemory() << "}";
+      *rv = os.str();
+    });
+  } else if (name == "get_param_usage") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      CHECK(exec_) << "The executable is not created yet.";
+      std::vector<ObjectRef> constants;
+      {
+        std::lock_guard<std::mutex> lock(shared_const_pool_->mu);
+        constants = shared_const_pool_->constants;
+      }
+      *rv = ConstantUsage(exec_, constants);
+    });
+  } else if (name == "fork") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      *rv = runtime::Module(Fork());
+    });
+  } else if (name == "set_shape_cache") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      int64_t capacity = args[0];
+      CHECK_GE(capacity, 0) << "The shape cache capacity cannot be negative";
+      shape_cache_capacity_ = static_cast<size_t>(capacity);
+      for (auto& cache : shape_cache_) cache.clear();
+      shape_cache_hits_ = shape_cache_misses_ = 0;
+    });
+  } else if (name == "set_storage_cache") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      int64_t limit = args[0];
+      CHECK_GE(limit, 0) << "The storage cache limit cannot be negative";
+      storage_cache_limit_ = static_cast<size_t>(limit);
+      storage_cache_.clear();
+      storage_cache_bytes_ = 0;
+      storage_reuses_ = storage_allocs_ = 0;
+    });
+  } else if (name == "get_shape_cache_stats") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      size_t entries = 0;
+      for (const auto& cache : shape_cache_) entries += cache.size();
+      std::ostringstream os;
+      os << "{\"capacity\": " << shape_cache_capacity_ << ", \"entries\": " << entries
+         << ", \"hits\": " << shape_cache_hits_ << ", \"misses\": " << shape_cache_misses_
+         << ", \"storage_reuses\": " << storage_reuses_
+         << ", \"storage_allocs\": " << storage_allocs_
+         << ", \"storage_bytes\": " << storage_cache_bytes_ << "}";
+      *rv = os.str();
+    });
   } else if (name == "set_input") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
       CHECK(exec_) << "The executable is not created yet.";
@@ -179,18 +331,27 @@ TVMContext VirtualMachine::GetParamsContext() const {
 }
 
 void VirtualMachine::PushFrame(Index arg_count, Index ret_pc, const VMFunction& vm_func) {
-  auto frame = VMFrame(ret_pc, func_index_, arg_count, code_, vm_func.register_file_size);
-  frames_.push_back(frame);
+  frames_.emplace_back(ret_pc, func_index_, arg_count, code_, 0);
+  // Take the register file of a returned frame to avoid a heap allocation per call.
+  auto& register_file = frames_.back().register_file;
+  if (!free_register_files_.empty()) {
+    register_file.swap(free_register_files_.back());
+    free_register_files_.pop_back();
+  }
+  register_file.resize(vm_func.register_file_size);
 }
 
 Index VirtualMachine::PopFrame() {
   CHECK_GT(frames_.size(), 0);
-  const VMFrame& fr = frames_.back();
+  VMFrame& fr = frames_.back();
   func_index_ = fr.func_index;
   code_ = fr.code;
   pc_ = fr.pc;
   auto call_stack_size = frames_.size();
+  std::vector<ObjectRef> register_file = std::move(fr.register_file);
   frames_.pop_back();
+  register_file.clear();
+  free_register_files_.push_back(std::move(register_file));
   return call_stack_size;
 }
 
@@ -198,6 +359,8 @@ void VirtualMachine::InvokeGlobal(const VMFunction& func, const std::vector<Obje
   DLOG(INFO) << "Invoking global " << func.name << " " << args.size();
 
   PushFrame(func.params.size(), this->pc_ + 1, func);
+  auto it = exec_->global_map.find(func.name);
+  if (it != exec_->global_map.end()) func_index_ = it->second;
   for (size_t i = 0; i < args.size(); ++i) {
     WriteRegister(i, args[i]);
   }
@@ -210,9 +373,74 @@ void VirtualMachine::InvokeGlobal(const VMFunction& func, const std::vector<Obje
 ObjectRef VirtualMachine::Invoke(const VMFunction& func, const std::vector<ObjectRef>& args) {
   DLOG(INFO) << "Executing Function: " << std::endl << func;
 
+  size_t frame_start = frames_.size();
   InvokeGlobal(func, args);
-  RunLoop();
-  return return_register_;
+  try {
+    RunLoop();
+  } catch (...) {
+    // Drop the frames of the failed invocation and release its arena so that the VM stays usable.
+    while (frames_.size() > frame_start) PopFrame();
+    EndInvocation();
+    throw;
+  }
+  EndInvocation();
+  // Hand the result over instead of keeping it alive, so that its storage can be reused once the
+  // caller drops it.
+  ObjectRef ret = std::move(return_register_);
+  return ret;
+}
+
+void VirtualMachine::InvokeAsync(const VMFunction& func, const std::vector<ObjectRef>& args) {
+  CHECK(!async_running_) << "An asynchronous invocation is already in progress";
+  InvokeGlobal(func, args);
+  async_frame_start_ = frames_.size();
+  async_running_ = true;
+}
+
+bool VirtualMachine::Resume(ObjectRef* result) {
+  CHECK(async_running_) << "No asynchronous invocation is in progress";
+  bool done;
+  try {
+    done = RunLoop(async_frame_start_, true);
+  } catch (...) {
+    // Drop the frames of the failed invocation and release its arena so that the VM stays usable.
+    while (frames_.size() >= static_cast<size_t>(async_frame_start_)) PopFrame();
+    async_running_ = false;
+    EndInvocation();
+    throw;
+  }
+  if (!done) return false;
+  async_running_ = false;
+  EndInvocation();
+  *result = std::move(return_register_);
+  return true;
+}
+
+void VirtualMachine::CancelAsync() {
+  if (!async_running_) return;
+  while (frames_.size() >= static_cast<size_t>(async_frame_start_)) PopFrame();
+  async_running_ = false;
+  EndInvocation();
+}
+
+void VirtualMachine::EndInvocation() {
+  for (auto& it : allocators_) {
+    it.second->EndInvocation();
+  }
+}
+
+const VMFunction& VirtualMachine::GetFunctionInputs(const std::string& name,
+                                                    std::vector<ObjectRef>* args) const {
+  CHECK(exec_) << "The executable is not created yet.";
+  auto git = exec_->global_map.find(name);
+  CHECK(git != exec_->global_map.end()) << "Cannot find function " << name << " in the executable";
+  const auto& func = exec_->functions[git->second];
+  if (!func.params.empty()) {
+    auto it = inputs_.find(name);
+    CHECK(it != inputs_.end()) << "Input has not been set for function " << name;
+    *args = it->second;
+  }
+  return func;
 }
 
 ObjectRef VirtualMachine::Invoke(const std::string& name, const std::vector<ObjectRef>& args) {
@@ -235,9 +463,21 @@ void VirtualMachine::InvokePacked(Index packed_index, const PackedFunc& func, In
     }
   }
 
-  std::vector<TVMValue> values(arity);
-  std::vector<int> codes(arity);
-  runtime::TVMArgsSetter setter(values.data(), codes.data());
+  // Most kernels take a handful of arguments, which are passed without a heap allocation.
+  constexpr size_t kNumStackArgs = 16;
+  TVMValue stack_values[kNumStackArgs];
+  int stack_codes[kNumStackArgs];
+  std::vector<TVMValue> heap_values;
+  std::vector<int> heap_codes;
+  TVMValue* values = stack_values;
+  int* codes = stack_codes;
+  if (arity > kNumStackArgs) {
+    heap_values.resize(arity);
+    heap_codes.resize(arity);
+    values = heap_values.data();
+    codes = heap_codes.data();
+  }
+  runtime::TVMArgsSetter setter(values, codes);
   int idx = 0;
   for (Index i = 0; i < arg_count; i++) {
     if (const auto* dt_cell = args[i].as<ADTObj>()) {
@@ -253,7 +493,87 @@ void VirtualMachine::InvokePacked(Index packed_index, const PackedFunc& func, In
   }
 
   TVMRetValue rv;
-  func.CallPacked(TVMArgs(values.data(), codes.data(), arity), &rv);
+  func.CallPacked(TVMArgs(values, codes, arity), &rv);
+}
+
+void VirtualMachine::InvokeShapeFunc(Index packed_index, const PackedFunc& func, Index arg_count,
+                                     Index output_size, const std::vector<ObjectRef>& args) {
+  // Shape functions are pure, so their outputs only depend on the inputs. Small CPU inputs,
+  // which covers both the shapes and the data of data dependent shape functions, form the key.
+  std::vector<NDArray> inputs, outputs;
+  FlattenTensors(args, 0, arg_count - output_size, &inputs);
+  FlattenTensors(args, arg_count - output_size, arg_count, &outputs);
+  std::string key;
+  bool cacheable = true;
+  for (const auto& arr : inputs) {
+    cacheable = cacheable && AppendShapeCacheKey(arr, &key);
+  }
+  for (const auto& arr : outputs) {
+    cacheable = cacheable && CPUData(arr) != nullptr;
+  }
+  if (!cacheable) {
+    InvokePacked(packed_index, func, arg_count, output_size, args);
+    return;
+  }
+
+  auto& cache = shape_cache_[packed_index];
+  auto it = cache.find(key);
+  if (it != cache.end()) {
+    ++shape_cache_hits_;
+    for (size_t i = 0; i < outputs.size(); ++i) {
+      const std::string& value = it->second[i];
+      CHECK_EQ(value.size(), GetDataSize(*outputs[i].operator->()));
+      std::memcpy(CPUData(outputs[i]), value.data(), value.size());
+    }
+    return;
+  }
+
+  ++shape_cache_misses_;
+  InvokePacked(packed_index, func, arg_count, output_size, args);
+  if (cache.size() >= shape_cache_capacity_) cache.clear();
+  std::vector<std::string> values;
+  for (const auto& arr : outputs) {
+    values.emplace_back(CPUData(arr), GetDataSize(*arr.operator->()));
+  }
+  cache.emplace(std::move(key), std::move(values));
+}
+
+Storage VirtualMachine::AllocStorage(const Instruction& instr, int64_t size) {
+  auto alignment = instr.alloc_storage.alignment;
+  auto it = allocators_.find(ctxs_[0]);
+  CHECK(it != allocators_.end()) << "Did you forget to init the VirtualMachine with contexts?";
+  const std::shared_ptr<Allocator>& alloc = it->second;
+
+  // The arena allocator already makes allocation cheap and relies on storage being released at
+  // the end of each invocation, so only reuse storage with the other allocators.
+  bool reuse = storage_cache_limit_ > 0 && alloc->type() != kArena;
+  if (reuse) {
+    auto cit = storage_cache_.find(&instr);
+    if (cit != storage_cache_.end()) {
+      // Reuse the storage once the tensors allocated from it last time are gone, so that the
+      // cache holds the only reference, and only for the same size.
+      if (cit->second.storage.use_count() == 1 && cit->second.size == size) {
+        ++storage_reuses_;
+        return cit->second.storage;
+      }
+      // Storage that escaped or does not fit goes back to the allocator once it is released.
+      storage_cache_bytes_ -= cit->second.storage->buffer.size;
+      storage_cache_.erase(cit);
+    }
+  }
+
+  auto storage_obj = SimpleObjAllocator().make_object<StorageObj>();
+  storage_obj->buffer = alloc->Alloc(size, alignment, instr.alloc_storage.dtype_hint);
+  storage_obj->allocator = alloc;
+  Storage storage(storage_obj);
+  if (reuse) {
+    ++storage_allocs_;
+    if (storage_cache_bytes_ + storage_obj->buffer.size <= storage_cache_limit_) {
+      storage_cache_bytes_ += storage_obj->buffer.size;
+      storage_cache_[&instr] = CachedStorage{storage, size};
+    }
+  }
+  return storage;
 }
 
 void VirtualMachine::LoadExecutable(const Executable* exec) {
@@ -274,10 +594,69 @@ void VirtualMachine::LoadExecutable(const Executable* exec) {
     tvm::runtime::PackedFunc pf = lib.GetFunction(packed_name, true);
     CHECK(pf != nullptr) << "Cannot find function in module: " << packed_name;
     packed_funcs_[packed_index] = pf;
+    if (is_shape_func_.size() <= packed_index) {
+      is_shape_func_.resize(packed_index + 1, false);
+    }
+    is_shape_func_[packed_index] = packed_name.compare(0, 10, "shape_func") == 0;
   }
+  is_shape_func_.resize(packed_funcs_.size(), false);
+  shape_cache_.clear();
+  shape_cache_.resize(packed_funcs_.size());
+  storage_cache_.clear();
+  storage_cache_bytes_ = 0;
+  const_pool_.clear();
+  shared_const_pool_ = std::make_shared<VMConstantPool>();
   for (size_t i = 0; i < packed_funcs_.size(); ++i) {
     CHECK(packed_funcs_[i] != nullptr) << "Packed function " << i << " is not initialized";
   }
+  // Check the bytecode once here so that the dispatch loop can trust it.
+  for (const auto& func : exec_->functions) {
+    for (const auto& instr : func.instructions) {
+      CHECK_LT(static_cast<size_t>(instr.op), kNumOpcodes)
+          << "Unknown instruction opcode " << static_cast<int>(instr.op) << " in " << func.name;
+      if (instr.op == Opcode::InvokePacked) {
+        CHECK_LT(static_cast<size_t>(instr.packed_index), packed_funcs_.size())
+            << "Invalid packed function index " << instr.packed_index << " in " << func.name;
+      }
+    }
+  }
+}
+
+ObjectPtr<VirtualMachine> VirtualMachine::Fork() const {
+  CHECK(exec_) << "The executable is not created yet.";
+  auto vm = make_object<VirtualMachine>();
+  vm->exec_ = exec_;
+  vm->packed_funcs_ = packed_funcs_;
+  vm->is_shape_func_ = is_shape_func_;
+  vm->shape_cache_.resize(shape_cache_.size());
+  vm->shape_cache_capacity_ = shape_cache_capacity_;
+  vm->storage_cache_limit_ = storage_cache_limit_;
+  vm->shared_const_pool_ = shared_const_pool_;
+  vm->ctxs_ = ctxs_;
+  // Arenas are rewound at the end of every invocation, so each fork needs its own.
+  for (const auto& it : allocators_) {
+    auto alloc = it.second->type() == kArena ? MemoryManager::CreateAllocator(it.first, kArena)
+                                             : it.second;
+    vm->allocators_.emplace(it.first, alloc);
+  }
+  return vm;
+}
+
+ObjectRef VirtualMachine::LoadSharedConstant(Index const_index) {
+  std::lock_guard<std::mutex> lock(shared_const_pool_->mu);
+  auto& constants = shared_const_pool_->constants;
+  if (constants.size() <= static_cast<size_t>(const_index)) {
+    constants.resize(const_index + 1);
+  }
+  if (!constants[const_index].defined()) {
+    const auto& constant_obj = exec_->constants[const_index];
+    CHECK(constant_obj.defined()) << "The late bound constant "
+                                  << exec_->GetConstantName(const_index)
+                                  << " is not loaded, call load_late_bound_consts first";
+    // TODO(wweic) ctx could be obtained from the ctxs list.
+    constants[const_index] = CopyTo(constant_obj, ctxs_[0]);
+  }
+  return constants[const_index];
 }
 
 void VirtualMachine::Init(const std::vector<TVMContext>& ctxs,
@@ -285,7 +664,10 @@ void VirtualMachine::Init(const std::vector<TVMContext>& ctxs,
   CHECK_EQ(ctxs.size(), alloc_types.size());
   ctxs_ = ctxs;
   for (size_t i = 0; i < ctxs.size(); ++i) {
-    auto alloc = MemoryManager::GetOrCreateAllocator(ctxs[i], alloc_types[i]);
+    // An arena is owned by its VM, the other allocators are shared on the context.
+    auto alloc = alloc_types[i] == kArena
+                     ? MemoryManager::CreateAllocator(ctxs[i], kArena)
+                     : MemoryManager::GetOrCreateAllocator(ctxs[i], alloc_types[i]);
     allocators_.emplace(ctxs[i], alloc);
   }
 }
@@ -294,14 +676,21 @@ inline void VirtualMachine::WriteRegister(Index r, const ObjectRef& val) {
   frames_.back().register_file[r] = val;
 }
 
-inline ObjectRef VirtualMachine::ReadRegister(Index r) const {
+inline const ObjectRef& VirtualMachine::ReadRegister(Index r) const {
   return frames_.back().register_file[r];
 }
 
 inline int64_t VirtualMachine::LoadScalarInt(Index r) const {
   int64_t result = 0;
   const auto& obj = ReadRegister(r);
-  NDArray array = Downcast<NDArray>(CopyTo(obj, {kDLCPU, 0}));
+  // Scalars almost always live on the CPU already, read those in place.
+  const auto* container = obj.as<NDArray::ContainerType>();
+  NDArray cpu_array;
+  const DLTensor* array = container != nullptr ? &container->dl_tensor : nullptr;
+  if (array == nullptr || array->ctx.device_type != kDLCPU) {
+    cpu_array = Downcast<NDArray>(CopyTo(obj, {kDLCPU, 0}));
+    array = cpu_array.operator->();
+  }
 
   switch (array->dtype.bits) {
     case 1: {
@@ -334,232 +723,284 @@ void VirtualMachine::RunLoop() {
   CHECK(this->exec_);
   CHECK(this->code_);
   pc_ = 0;
-  Index frame_start = frames_.size();
+  RunLoop(frames_.size(), false);
+}
+
+bool VirtualMachine::RunLoop(Index frame_start, bool suspend_after_packed) {
+  if (!profile_instructions_) return RunLoopImpl<false>(frame_start, suspend_after_packed);
+  bool returned = false;
+  try {
+    returned = RunLoopImpl<true>(frame_start, suspend_after_packed);
+  } catch (...) {
+    OnRunLoopExit(false);
+    throw;
+  }
+  OnRunLoopExit(returned);
+  return returned;
+}
+
+template <bool kProfile>
+bool VirtualMachine::RunLoopImpl(Index frame_start, bool suspend_after_packed) {
+  const Instruction* instr = nullptr;
+
+#if TVM_VM_COMPUTED_GOTO
+  // Handler addresses in Opcode order, LoadExecutable has checked every opcode is in range.
+  static const void* const kDispatchTable[] = {
+      &&op_Move,         &&op_Ret,        &&op_Invoke,       &&op_InvokeClosure,
+      &&op_InvokePacked, &&op_AllocTensor, &&op_AllocTensorReg, &&op_AllocADT,
+      &&op_AllocClosure, &&op_GetField,   &&op_If,           &&op_LoadConst,
+      &&op_Goto,         &&op_GetTag,     &&op_LoadConsti,   &&op_Fatal,
+      &&op_AllocStorage, &&op_ShapeOf,    &&op_ReshapeTensor};
+  static_assert(sizeof(kDispatchTable) / sizeof(kDispatchTable[0]) == kNumOpcodes,
+                "The dispatch table must cover every opcode");
+// Each handler jumps straight to the next one. A computed goto does not run destructors, so
+// handlers keep their locals in a block that is closed before dispatching.
+#define VM_OP(name) \
+  case Opcode::name: \
+  op_##name:
+#define VM_NEXT()                                         \
+  do {                                                    \
+    instr = &code_[pc_];                                  \
+    DLOG(INFO) << "Executing(" << pc_ << "): " << *instr; \
+    if (kProfile) OnInstruction(*instr);                  \
+    goto* kDispatchTable[static_cast<size_t>(instr->op)]; \
+  } while (0)
+#else
+#define VM_OP(name) case Opcode::name:
+#define VM_NEXT() continue
+#endif
+
   while (true) {
-  main_loop:
-    auto const& instr = code_[this->pc_];
-    DLOG(INFO) << "Executing(" << pc_ << "): " << instr;
+    instr = &code_[pc_];
+    DLOG(INFO) << "Executing(" << pc_ << "): " << *instr;
 #if USE_RELAY_DEBUG
-    InstructionPrint(std::cout, instr);
+    InstructionPrint(std::cout, *instr);
 #endif  // USE_RELAY_DEBUG
+    if (kProfile) OnInstruction(*instr);
+#if TVM_VM_COMPUTED_GOTO
+    goto* kDispatchTable[static_cast<size_t>(instr->op)];
+#endif
 
-    switch (instr.op) {
-      case Opcode::Move: {
-        ObjectRef from_obj;
-        from_obj = ReadRegister(instr.from);
-        WriteRegister(instr.dst, from_obj);
+    switch (instr->op) {
+      VM_OP(Move) {
+        WriteRegister(instr->dst, ReadRegister(instr->from));
         pc_++;
-        goto main_loop;
       }
-      case Opcode::Fatal: {
-        throw std::runtime_error("VM encountered fatal error");
-      }
-      case Opcode::LoadConst: {
-        auto constant_obj = exec_->constants[instr.const_index];
+      VM_NEXT();
+      VM_OP(Fatal) { throw std::runtime_error("VM encountered fatal error"); }
+      VM_OP(LoadConst) {
         // We cache the allocated object in the constant pool. To measure, the
         // first iteration will set the pool up. The other iterations will
         // directly reuse the allocated objects.
-        if (const_pool_.size() <= static_cast<size_t>(instr.const_index)) {
-          const_pool_.resize(instr.const_index + 1);
+        if (const_pool_.size() <= static_cast<size_t>(instr->const_index)) {
+          const_pool_.resize(instr->const_index + 1);
         }
 
-        if (!const_pool_[instr.const_index].defined()) {
-          // TODO(wweic) ctx could be obtained from the ctxs list.
-          const_pool_[instr.const_index] = CopyTo(constant_obj, ctxs_[0]);
+        if (!const_pool_[instr->const_index].defined()) {
+          const_pool_[instr->const_index] = LoadSharedConstant(instr->const_index);
         }
-        WriteRegister(instr.dst, const_pool_[instr.const_index]);
+        WriteRegister(instr->dst, const_pool_[instr->const_index]);
         pc_++;
-        goto main_loop;
       }
-      case Opcode::LoadConsti: {
+      VM_NEXT();
+      VM_OP(LoadConsti) {
         auto tensor = NDArray::Empty({1}, {kDLInt, 64, 1}, {kDLCPU, 0});
-        reinterpret_cast<int64_t*>(tensor->data)[0] = instr.load_consti.val;
-        WriteRegister(instr.dst, tensor);
+        reinterpret_cast<int64_t*>(tensor->data)[0] = instr->load_consti.val;
+        WriteRegister(instr->dst, tensor);
         pc_++;
-        goto main_loop;
       }
-      case Opcode::Invoke: {
-        std::vector<ObjectRef> args;
-        for (Index i = 0; i < instr.num_args; ++i) {
-          args.push_back(ReadRegister(instr.invoke_args_registers[i]));
+      VM_NEXT();
+      VM_OP(Invoke) {
+        const auto& func = exec_->functions[instr->func_index];
+        PushFrame(instr->num_args, pc_ + 1, func);
+        func_index_ = instr->func_index;
+        // Copy the arguments from the caller's registers into the new frame directly.
+        const auto& caller = frames_[frames_.size() - 2].register_file;
+        auto& callee = frames_.back().register_file;
+        for (Index i = 0; i < instr->num_args; ++i) {
+          callee[i] = caller[instr->invoke_args_registers[i]];
         }
-        InvokeGlobal(exec_->functions[instr.func_index], args);
-        frames_.back().caller_return_register = instr.dst;
-        goto main_loop;
+        frames_.back().caller_return_register = instr->dst;
+        code_ = func.instructions.data();
+        pc_ = 0;
       }
-      case Opcode::InvokePacked: {
-        DLOG(INFO) << "InvokedPacked " << instr.packed_index << " arity=" << instr.arity;
-        CHECK_LE(instr.packed_index, packed_funcs_.size());
-        const auto& func = packed_funcs_[instr.packed_index];
-        const auto& arity = instr.arity;
-        std::vector<ObjectRef> args;
+      VM_NEXT();
+      VM_OP(InvokePacked) {
+        DLOG(INFO) << "InvokedPacked " << instr->packed_index << " arity=" << instr->arity;
+        const auto& func = packed_funcs_[instr->packed_index];
+        const auto& arity = instr->arity;
+        // The argument buffer is reused across calls to avoid a heap allocation per kernel.
+        std::vector<ObjectRef>& args = arg_buffer_;
+        args.clear();
         for (Index i = 0; i < arity; ++i) {
-          DLOG(INFO) << "arg" << i << " $" << instr.packed_args[i];
-          auto arg = ReadRegister(instr.packed_args[i]);
-          args.push_back(arg);
+          DLOG(INFO) << "arg" << i << " $" << instr->packed_args[i];
+          args.push_back(ReadRegister(instr->packed_args[i]));
         }
 
         // We no longer need to write the registers back, we write directly
         // through the registers mutably.
-        InvokePacked(instr.packed_index, func, arity, instr.output_size, args);
+        if (shape_cache_capacity_ > 0 && is_shape_func_[instr->packed_index]) {
+          InvokeShapeFunc(instr->packed_index, func, arity, instr->output_size, args);
+        } else {
+          InvokePacked(instr->packed_index, func, arity, instr->output_size, args);
+        }
+        args.clear();
         pc_++;
-        goto main_loop;
+        if (suspend_after_packed) return false;
       }
-      case Opcode::InvokeClosure: {
-        auto object = ReadRegister(instr.closure);
+      VM_NEXT();
+      VM_OP(InvokeClosure) {
+        ObjectRef object = ReadRegister(instr->closure);
         const auto* closure = object.as<VMClosureObj>();
-
-        std::vector<ObjectRef> args;
-        for (auto free_var : closure->free_vars) {
-          args.push_back(free_var);
+        const auto& func = exec_->functions[closure->func_index];
+        Index num_free_vars = closure->free_vars.size();
+        PushFrame(num_free_vars + instr->num_closure_args, pc_ + 1, func);
+        func_index_ = closure->func_index;
+        const auto& caller = frames_[frames_.size() - 2].register_file;
+        auto& callee = frames_.back().register_file;
+        for (Index i = 0; i < num_free_vars; ++i) {
+          callee[i] = closure->free_vars[i];
         }
-        for (Index i = 0; i < instr.num_closure_args; ++i) {
-          args.push_back(ReadRegister(instr.closure_args[i]));
+        for (Index i = 0; i < instr->num_closure_args; ++i) {
+          callee[num_free_vars + i] = caller[instr->closure_args[i]];
         }
-        InvokeGlobal(exec_->functions[closure->func_index], args);
-        frames_.back().caller_return_register = instr.dst;
-        goto main_loop;
+        frames_.back().caller_return_register = instr->dst;
+        code_ = func.instructions.data();
+        pc_ = 0;
       }
-      case Opcode::GetField: {
-        auto object = ReadRegister(instr.object);
+      VM_NEXT();
+      VM_OP(GetField) {
+        const auto& object = ReadRegister(instr->object);
         const auto& tuple = Downcast<ADT>(object);
-        auto field = tuple[instr.field_index];
-        WriteRegister(instr.dst, field);
+        auto field = tuple[instr->field_index];
+        WriteRegister(instr->dst, field);
         pc_++;
-        goto main_loop;
       }
-      case Opcode::GetTag: {
-        auto object = ReadRegister(instr.get_tag.object);
+      VM_NEXT();
+      VM_OP(GetTag) {
+        const auto& object = ReadRegister(instr->get_tag.object);
         const auto& adt = Downcast<ADT>(object);
         auto tag = adt.tag();
         auto tag_tensor = NDArray::Empty({1}, {kDLInt, 32, 1}, {kDLCPU, 0});
         reinterpret_cast<int32_t*>(tag_tensor->data)[0] = tag;
-        WriteRegister(instr.dst, tag_tensor);
+        WriteRegister(instr->dst, tag_tensor);
         pc_++;
-        goto main_loop;
-      }
-      case Opcode::Goto: {
-        pc_ += instr.pc_offset;
-        goto main_loop;
       }
-      case Opcode::If: {
-        int32_t test_val = LoadScalarInt(instr.if_op.test);
-        int32_t target_val = LoadScalarInt(instr.if_op.target);
+      VM_NEXT();
+      VM_OP(Goto) { pc_ += instr->pc_offset; }
+      VM_NEXT();
+      VM_OP(If) {
+        int32_t test_val = LoadScalarInt(instr->if_op.test);
+        int32_t target_val = LoadScalarInt(instr->if_op.target);
 
         if (test_val == target_val) {
-          CHECK_NE(instr.if_op.true_offset, 0);
-          pc_ += instr.if_op.true_offset;
+          CHECK_NE(instr->if_op.true_offset, 0);
+          pc_ += instr->if_op.true_offset;
         } else {
-          CHECK_NE(instr.if_op.false_offset, 0);
-          pc_ += instr.if_op.false_offset;
+          CHECK_NE(instr->if_op.false_offset, 0);
+          pc_ += instr->if_op.false_offset;
         }
-
-        goto main_loop;
       }
-      case Opcode::AllocTensor: {
-        auto shape = std::vector<int64_t>(instr.alloc_tensor.ndim);
+      VM_NEXT();
+      VM_OP(AllocTensor) {
+        auto shape = std::vector<int64_t>(instr->alloc_tensor.ndim);
 
-        for (uint32_t i = 0; i < instr.alloc_tensor.ndim; ++i) {
-          shape[i] = instr.alloc_tensor.shape[i];
+        for (uint32_t i = 0; i < instr->alloc_tensor.ndim; ++i) {
+          shape[i] = instr->alloc_tensor.shape[i];
         }
 
-        auto storage_obj = ReadRegister(instr.alloc_tensor.storage);
-        auto offset = LoadScalarInt(instr.alloc_tensor.offset);
+        const auto& storage_obj = ReadRegister(instr->alloc_tensor.storage);
+        auto offset = LoadScalarInt(instr->alloc_tensor.offset);
         auto storage = Downcast<Storage>(storage_obj);
-        auto obj = storage->AllocNDArray(offset, shape, instr.alloc_tensor.dtype);
+        auto obj = storage->AllocNDArray(offset, shape, instr->alloc_tensor.dtype);
 
-        WriteRegister(instr.dst, obj);
+        WriteRegister(instr->dst, obj);
         pc_++;
-        goto main_loop;
       }
-      case Opcode::AllocTensorReg: {
+      VM_NEXT();
+      VM_OP(AllocTensorReg) {
         DLContext cpu_ctx;
         cpu_ctx.device_type = kDLCPU;
         cpu_ctx.device_id = 0;
-        auto shape_obj = ReadRegister(instr.alloc_tensor_reg.shape_register);
+        const auto& shape_obj = ReadRegister(instr->alloc_tensor_reg.shape_register);
         NDArray shape_tensor = Downcast<NDArray>(CopyTo(shape_obj, cpu_ctx));
         auto shape = ToShape(shape_tensor);
-        auto storage_obj = ReadRegister(instr.alloc_tensor_reg.storage);
+        const auto& storage_obj = ReadRegister(instr->alloc_tensor_reg.storage);
         auto storage = Downcast<Storage>(storage_obj);
-        auto offset = LoadScalarInt(instr.alloc_tensor.offset);
-        auto obj = storage->AllocNDArray(offset, shape, instr.alloc_tensor_reg.dtype);
+        auto offset = LoadScalarInt(instr->alloc_tensor.offset);
+        auto obj = storage->AllocNDArray(offset, shape, instr->alloc_tensor_reg.dtype);
 
-        WriteRegister(instr.dst, obj);
+        WriteRegister(instr->dst, obj);
         pc_++;
-        goto main_loop;
       }
-      case Opcode::AllocADT: {
-        std::vector<ObjectRef> fields;
-        for (Index i = 0; i < instr.num_fields; ++i) {
-          fields.push_back(ReadRegister(instr.datatype_fields[i]));
+      VM_NEXT();
+      VM_OP(AllocADT) {
+        std::vector<ObjectRef>& fields = arg_buffer_;
+        fields.clear();
+        for (Index i = 0; i < instr->num_fields; ++i) {
+          fields.push_back(ReadRegister(instr->datatype_fields[i]));
         }
-        ObjectRef obj = ADT(instr.constructor_tag, fields);
-        WriteRegister(instr.dst, obj);
+        ObjectRef obj = ADT(instr->constructor_tag, fields.begin(), fields.end());
+        fields.clear();
+        WriteRegister(instr->dst, obj);
         pc_++;
-        goto main_loop;
       }
-      case Opcode::AllocClosure: {
+      VM_NEXT();
+      VM_OP(AllocClosure) {
         std::vector<ObjectRef> free_vars;
-        for (Index i = 0; i < instr.num_freevar; i++) {
-          free_vars.push_back(ReadRegister(instr.free_vars[i]));
+        free_vars.reserve(instr->num_freevar);
+        for (Index i = 0; i < instr->num_freevar; i++) {
+          free_vars.push_back(ReadRegister(instr->free_vars[i]));
         }
-        WriteRegister(instr.dst, VMClosure(instr.func_index, free_vars));
+        WriteRegister(instr->dst, VMClosure(instr->func_index, std::move(free_vars)));
         pc_++;
-        goto main_loop;
       }
-      case Opcode::AllocStorage: {
-        auto size = LoadScalarInt(instr.alloc_storage.allocation_size);
-        auto alignment = instr.alloc_storage.alignment;
-
-        DLOG(INFO) << "AllocStorage: allocation_size=" << size << "alignment=" << alignment
-                   << "dtype_hint=" << DLDataType2String(instr.alloc_storage.dtype_hint);
-
-        auto storage_obj = SimpleObjAllocator().make_object<StorageObj>();
-        auto it = allocators_.find(ctxs_[0]);
-        CHECK(it != allocators_.end())
-            << "Did you forget to init the VirtualMachine with contexts?";
-        auto alloc = it->second;
-        storage_obj->buffer = alloc->Alloc(size, alignment, instr.alloc_storage.dtype_hint);
-        Storage storage(storage_obj);
-        WriteRegister(instr.dst, storage);
+      VM_NEXT();
+      VM_OP(AllocStorage) {
+        auto size = LoadScalarInt(instr->alloc_storage.allocation_size);
+
+        DLOG(INFO) << "AllocStorage: allocation_size=" << size
+                   << "alignment=" << instr->alloc_storage.alignment
+                   << "dtype_hint=" << DLDataType2String(instr->alloc_storage.dtype_hint);
+
+        WriteRegister(instr->dst, AllocStorage(*instr, size));
         pc_++;
-        goto main_loop;
       }
-      case Opcode::ShapeOf: {
-        auto input = ReadRegister(instr.shape_of.tensor);
+      VM_NEXT();
+      VM_OP(ShapeOf) {
+        const auto& input = ReadRegister(instr->shape_of.tensor);
         NDArray input_array = Downcast<NDArray>(input);
         int ndim = input_array->ndim;
         auto out_tensor = NDArray::Empty({ndim}, {kDLInt, 64, 1}, {kDLCPU, 0});
         for (int i = 0; i < ndim; ++i) {
           reinterpret_cast<int64_t*>(out_tensor->data)[i] = input_array->shape[i];
         }
-        WriteRegister(instr.dst, out_tensor);
+        WriteRegister(instr->dst, out_tensor);
         pc_++;
-        goto main_loop;
       }
-      case Opcode::Ret: {
+      VM_NEXT();
+      VM_OP(Ret) {
         // If we have hit the point from which we started
         // running, we should return to the caller breaking
         // the dispatch loop.
-        return_register_ = ReadRegister(instr.result);
+        return_register_ = ReadRegister(instr->result);
         auto caller_return_register = frames_.back().caller_return_register;
 
         if (PopFrame() == frame_start) {
-          return;
-          // Otherwise we are just returning from a local call.
-        } else {
-          WriteRegister(caller_return_register, return_register_);
-          goto main_loop;
+          return true;
         }
+        // Otherwise we are just returning from a local call.
+        WriteRegister(caller_return_register, return_register_);
       }
-      case Opcode::ReshapeTensor: {
+      VM_NEXT();
+      VM_OP(ReshapeTensor) {
         DLContext cpu_ctx;
         cpu_ctx.device_type = kDLCPU;
         cpu_ctx.device_id = 0;
-        auto tensor_obj = ReadRegister(instr.reshape_tensor.tensor);
+        auto tensor_obj = ReadRegister(instr->reshape_tensor.tensor);
         NDArray tensor_arr = Downcast<NDArray>(tensor_obj);
         // Read the shape from shape tensor
-        auto shape_obj = ReadRegister(instr.reshape_tensor.newshape);
+        const auto& shape_obj = ReadRegister(instr->reshape_tensor.newshape);
         NDArray shape_tensor = Downcast<NDArray>(CopyTo(shape_obj, cpu_ctx));
         const DLTensor* dl_tensor = shape_tensor.operator->();
         CHECK_EQ(dl_tensor->dtype.code, 0u);
@@ -569,14 +1010,16 @@ void VirtualMachine::RunLoop() {
         std::vector<int64_t> shape(dims, dims + ndim);
         // Reshape the input tensor
         auto out_tensor = tensor_arr.CreateView(shape, tensor_arr->dtype);
-        WriteRegister(instr.dst, out_tensor);
+        WriteRegister(instr->dst, out_tensor);
         pc_++;
-        goto main_loop;
       }
+      VM_NEXT();
       default:
-        LOG(FATAL) << "Unknown instruction opcode: " << int(instr.op);
+        LOG(FATAL) << "Unknown instruction opcode: " << int(instr->op);
     }
   }
+#undef VM_OP
+#undef VM_NEXT
 }
 
 runtime::Module CreateVirtualMachine(const Executable* exec) {
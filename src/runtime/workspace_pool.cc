@@ -23,115 +23,115 @@
  */
 #include "workspace_pool.h"
 
+#include <algorithm>
 #include <memory>
+#include <unordered_map>
 
 namespace tvm {
 namespace runtime {
 
 // page size.
 constexpr size_t kWorkspacePageSize = 4 << 10;
+// number of size classes, enough for any size_t.
+constexpr int kNumSizeClasses = 256;
+// the cached free blocks are trimmed once the reserved bytes exceed
+// this factor times the high-water mark of bytes in use.
+constexpr size_t kMaxReserveFactor = 2;
+
+/*!
+ * \brief Get the size class of a number of pages.
+ *  Classes 0-3 hold 1-4 pages, then there are four classes per power of two,
+ *  so rounding up to a class wastes at most 25%.
+ */
+inline int SizeClass(size_t npages) {
+  if (npages <= 4) return static_cast<int>(npages) - 1;
+  size_t m = npages - 1;
+  int e = 0;
+  while ((m >> (e + 1)) != 0) ++e;
+  return 4 * e - 4 + static_cast<int>((m >> (e - 2)) & 3);
+}
+
+/*! \brief Get the number of pages of a size class. */
+inline size_t SizeClassPages(int cls) {
+  if (cls < 4) return static_cast<size_t>(cls) + 1;
+  int e = cls / 4 + 1;
+  return static_cast<size_t>(5 + cls % 4) << (e - 2);
+}
 
 class WorkspacePool::Pool {
  public:
-  // constructor
-  Pool() {
-    // safe guard header on each list.
-    Entry e;
-    e.data = nullptr;
-    e.size = 0;
-    free_list_.push_back(e);
-    allocated_.push_back(e);
-  }
   // allocate from pool
   void* Alloc(TVMContext ctx, DeviceAPI* device, size_t nbytes) {
     // Allocate align to page.
-    nbytes = (nbytes + (kWorkspacePageSize - 1)) / kWorkspacePageSize * kWorkspacePageSize;
-    if (nbytes == 0) nbytes = kWorkspacePageSize;
-    Entry e;
-    DLDataType type;
-    type.code = kDLUInt;
-    type.bits = 8;
-    type.lanes = 1;
-    if (free_list_.size() == 2) {
-      e = free_list_.back();
-      free_list_.pop_back();
-      if (e.size < nbytes) {
-        // resize the page
-        device->FreeDataSpace(ctx, e.data);
-        e.data = device->AllocDataSpace(ctx, nbytes, kTempAllocaAlignment, type);
-        e.size = nbytes;
-      }
-    } else if (free_list_.size() == 1) {
-      e.data = device->AllocDataSpace(ctx, nbytes, kTempAllocaAlignment, type);
-      e.size = nbytes;
+    size_t npages = (nbytes + (kWorkspacePageSize - 1)) / kWorkspacePageSize;
+    if (npages == 0) npages = 1;
+    int cls = SizeClass(npages);
+    size_t size = SizeClassPages(cls) * kWorkspacePageSize;
+    void* data;
+    std::vector<void*>& bin = free_bins_[cls];
+    if (!bin.empty()) {
+      data = bin.back();
+      bin.pop_back();
+      stats_.num_reuses += 1;
     } else {
-      if (free_list_.back().size >= nbytes) {
-        // find smallest fit
-        auto it = free_list_.end() - 2;
-        for (; it->size >= nbytes; --it) {
-        }
-        e = *(it + 1);
-        free_list_.erase(it + 1);
-      } else {
-        // resize the page
-        e = free_list_.back();
-        free_list_.pop_back();
-        device->FreeDataSpace(ctx, e.data);
-        e.data = device->AllocDataSpace(ctx, nbytes, kTempAllocaAlignment, type);
-        e.size = nbytes;
-      }
+      Trim(ctx, device, size);
+      DLDataType type;
+      type.code = kDLUInt;
+      type.bits = 8;
+      type.lanes = 1;
+      data = device->AllocDataSpace(ctx, size, kTempAllocaAlignment, type);
+      stats_.bytes_reserved += size;
     }
-    allocated_.push_back(e);
-    return e.data;
+    allocated_[data] = cls;
+    stats_.num_allocs += 1;
+    stats_.bytes_in_use += size;
+    stats_.peak_bytes_in_use = std::max(stats_.peak_bytes_in_use, stats_.bytes_in_use);
+    return data;
   }
   // free resource back to pool
   void Free(void* data) {
-    Entry e;
-    if (allocated_.back().data == data) {
-      // quick path, last allocated.
-      e = allocated_.back();
-      allocated_.pop_back();
-    } else {
-      int index = static_cast<int>(allocated_.size()) - 2;
-      for (; index > 0 && allocated_[index].data != data; --index) {
-      }
-      CHECK_GT(index, 0) << "trying to free things that has not been allocated";
-      e = allocated_[index];
-      allocated_.erase(allocated_.begin() + index);
-    }
-    if (free_list_.back().size < e.size) {
-      free_list_.push_back(e);
-    } else if (free_list_.size() == 2) {
-      free_list_.push_back(free_list_.back());
-      free_list_[1] = e;
-    } else {
-      size_t i = free_list_.size() - 1;
-      free_list_.resize(free_list_.size() + 1);
-      for (; e.size < free_list_[i].size; --i) {
-        free_list_[i + 1] = free_list_[i];
-      }
-      free_list_[i + 1] = e;
-    }
+    auto it = allocated_.find(data);
+    CHECK(it != allocated_.end()) << "trying to free things that has not been allocated";
+    int cls = it->second;
+    allocated_.erase(it);
+    free_bins_[cls].push_back(data);
+    stats_.bytes_in_use -= SizeClassPages(cls) * kWorkspacePageSize;
   }
   // Release all resources
   void Release(TVMContext ctx, DeviceAPI* device) {
-    CHECK_EQ(allocated_.size(), 1);
-    for (size_t i = 1; i < free_list_.size(); ++i) {
-      device->FreeDataSpace(ctx, free_list_[i].data);
+    CHECK_EQ(allocated_.size(), 0);
+    for (int cls = 0; cls < kNumSizeClasses; ++cls) {
+      for (void* data : free_bins_[cls]) {
+        device->FreeDataSpace(ctx, data);
+      }
+      free_bins_[cls].clear();
     }
-    free_list_.clear();
+    stats_.bytes_reserved = 0;
   }
+  const Stats& stats() const { return stats_; }
 
  private:
-  /*! \brief a single entry in the pool */
-  struct Entry {
-    void* data;
-    size_t size;
-  };
-  /*! \brief List of free items, sorted from small to big size */
-  std::vector<Entry> free_list_;
-  /*! \brief List of allocated items */
-  std::vector<Entry> allocated_;
+  // Return cached free blocks to the device, largest first, so that a new
+  // allocation does not grow the reserved bytes beyond kMaxReserveFactor
+  // times the high-water mark. A repeating pattern never reaches this path.
+  void Trim(TVMContext ctx, DeviceAPI* device, size_t nbytes) {
+    size_t limit =
+        kMaxReserveFactor * std::max(stats_.peak_bytes_in_use, stats_.bytes_in_use + nbytes);
+    for (int cls = kNumSizeClasses - 1; cls >= 0 && stats_.bytes_reserved + nbytes > limit; --cls) {
+      std::vector<void*>& bin = free_bins_[cls];
+      while (!bin.empty() && stats_.bytes_reserved + nbytes > limit) {
+        device->FreeDataSpace(ctx, bin.back());
+        bin.pop_back();
+        stats_.bytes_reserved -= SizeClassPages(cls) * kWorkspacePageSize;
+      }
+    }
+  }
+  /*! \brief Free blocks of each size class */
+  std::vector<void*> free_bins_[kNumSizeClasses];
+  /*! \brief Map from allocated blocks to their size class */
+  std::unordered_map<void*, int> allocated_;
+  /*! \brief The statistics */
+  Stats stats_;
 };
 
 WorkspacePool::WorkspacePool(DLDeviceType device_type, std::shared_ptr<DeviceAPI> device)
@@ -150,6 +150,7 @@ WorkspacePool::~WorkspacePool() {
 }
 
 void* WorkspacePool::AllocWorkspace(TVMContext ctx, size_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
   if (static_cast<size_t>(ctx.device_id) >= array_.size()) {
     array_.resize(ctx.device_id + 1, nullptr);
   }
@@ -160,9 +161,18 @@ void* WorkspacePool::AllocWorkspace(TVMContext ctx, size_t size) {
 }
 
 void WorkspacePool::FreeWorkspace(TVMContext ctx, void* ptr) {
+  std::lock_guard<std::mutex> lock(mutex_);
   CHECK(static_cast<size_t>(ctx.device_id) < array_.size() && array_[ctx.device_id] != nullptr);
   array_[ctx.device_id]->Free(ptr);
 }
 
+WorkspacePool::Stats WorkspacePool::GetStats(TVMContext ctx) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (static_cast<size_t>(ctx.device_id) >= array_.size() || array_[ctx.device_id] == nullptr) {
+    return Stats();
+  }
+  return array_[ctx.device_id]->stats();
+}
+
 }  // namespace runtime
 }  // namespace tvm
@@ -27,6 +27,7 @@
 #include <tvm/runtime/device_api.h>
 
 #include <memory>
+#include <mutex>
 #include <vector>
 
 namespace tvm {
@@ -41,9 +42,27 @@ namespace runtime {
  *  - Only a few allocation will happen, and space will be released after use.
  *  - The release order is usually in reverse order of allocate
  *  - Repeative pattern of same allocations over different runs.
+ *
+ *  Blocks are grouped into size classes and recycled through per-class free
+ *  lists, so allocation and free take constant time. The pool is thread safe;
+ *  device APIs still keep one pool per thread, which acts as the thread local
+ *  cache and keeps the lock uncontended.
  */
 class TVM_DLL WorkspacePool {
  public:
+  /*! \brief Statistics of the pool of one device. */
+  struct Stats {
+    /*! \brief Bytes currently handed out. */
+    size_t bytes_in_use{0};
+    /*! \brief High-water mark of bytes_in_use. */
+    size_t peak_bytes_in_use{0};
+    /*! \brief Bytes held from the device, including the cached free blocks. */
+    size_t bytes_reserved{0};
+    /*! \brief Number of workspace allocations. */
+    size_t num_allocs{0};
+    /*! \brief Number of allocations served from a cached free block. */
+    size_t num_reuses{0};
+  };
   /*!
    * \brief Create pool with specific device type and device.
    * \param device_type The device type.
@@ -65,9 +84,17 @@ class TVM_DLL WorkspacePool {
    * \param ptr The pointer to be freed.
    */
   void FreeWorkspace(TVMContext ctx, void* ptr);
+  /*!
+   * \brief Get the statistics of the pool of a device.
+   * \param ctx The context of the device.
+   * \return The statistics, all zero if the device has not been used.
+   */
+  Stats GetStats(TVMContext ctx);
 
  private:
   class Pool;
+  /*! \brief mutex guarding array_ and the pools */
+  std::mutex mutex_;
   /*! \brief pool of device local array */
   std::vector<Pool*> array_;
   /*! \brief device type this pool support */
@@ -56,11 +56,12 @@ class RingBuffer {
   void Reserve(size_t n) {
     if (ring_.size() < n) {
       size_t old_size = ring_.size();
-      size_t new_size = static_cast<size_t>(n * 1.2);
+      // number of bytes that wrap around to the head of the ring.
+      size_t ncopy = std::max(head_ptr_ + bytes_available_, old_size) - old_size;
+      size_t new_size = std::max(static_cast<size_t>(n * 1.2), old_size + ncopy);
       ring_.resize(new_size);
-      if (head_ptr_ + bytes_available_ > old_size) {
+      if (ncopy != 0) {
         // copy the ring overflow part into the tail.
-        size_t ncopy = head_ptr_ + bytes_available_ - old_size;
         memcpy(&ring_[0] + old_size, &ring_[0], ncopy);
       }
     } else if (ring_.size() > n * 8 && ring_.size() > kInitCapacity) {
@@ -121,6 +122,7 @@ class RingBuffer {
       bytes_available_ -= nsend2;
       nsend += nsend2;
     }
+    head_ptr_ = (head_ptr_ + nsend) % ring_.size();
     return nsend;
   }
   /*!
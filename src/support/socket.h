@@ -383,6 +383,23 @@ class TCPSocket : public Socket {
       Socket::Error("SetKeepAlive");
     }
   }
+  /*!
+   * \brief set the timeout of blocking receives
+   * \param timeout_ms the timeout in milliseconds, 0 to block without a timeout
+   */
+  void SetRecvTimeout(int timeout_ms) {
+#ifdef _WIN32
+    DWORD opt = static_cast<DWORD>(timeout_ms);
+#else
+    timeval opt;
+    opt.tv_sec = timeout_ms / 1000;
+    opt.tv_usec = (timeout_ms % 1000) * 1000;
+#endif
+    if (setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<char*>(&opt), sizeof(opt)) <
+        0) {
+      Socket::Error("SetRecvTimeout");
+    }
+  }
   /*!
    * \brief create the socket, call this before using socket
    * \param af domain
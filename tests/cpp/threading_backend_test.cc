@@ -19,10 +19,19 @@
 
 #include <gtest/gtest.h>
 #include <tvm/runtime/c_backend_api.h>
+#include <tvm/runtime/registry.h>
+#include <tvm/runtime/threading_backend.h>
 
 #include <atomic>
+#include <fstream>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <thread>
+#include <vector>
+#if defined(__linux__)
+#include <sched.h>
+#endif
 
 constexpr size_t N = 128;
 
@@ -64,6 +73,182 @@ TEST(ThreadingBackend, TVMBackendParallelLaunchMultipleThreads) {
   }
 }
 
+TEST(ThreadingBackend, TVMBackendParallelLaunchWorkStealing) {
+  const tvm::runtime::PackedFunc* config_policy =
+      tvm::runtime::Registry::Get("runtime.config_threadpool_policy");
+  ASSERT_TRUE(config_policy != nullptr);
+  for (int chunks_per_worker : {1, 3, 16}) {
+    (*config_policy)(1, chunks_per_worker);
+    for (size_t j = 0; j < 3; ++j) {
+      std::atomic<size_t> acc(0);
+      TVMBackendParallelLaunch(atomic_add_task_id, &acc, 0);
+      EXPECT_EQ(acc.load(std::memory_order_relaxed), N * (N - 1) / 2);
+    }
+  }
+  (*config_policy)(0);
+}
+
+static FTVMParallelLambda barrier_task = [](int task_id, TVMParallelGroupEnv* penv,
+                                             void* cdata) -> int {
+  return TVMBackendParallelBarrier(task_id, penv);
+};
+
+TEST(ThreadingBackend, TVMBackendParallelBarrierWithoutSync) {
+  const tvm::runtime::PackedFunc* config_policy =
+      tvm::runtime::Registry::Get("runtime.config_threadpool_policy");
+  ASSERT_TRUE(config_policy != nullptr);
+  // Chunked work stealing launches have no barrier counters, the barrier fails the launch.
+  (*config_policy)(1, 3);
+  EXPECT_EQ(TVMBackendParallelLaunch(barrier_task, nullptr, 0), -1);
+  EXPECT_NE(std::string(TVMGetLastError()).find("Parallel barrier"), std::string::npos);
+  (*config_policy)(0);
+  EXPECT_EQ(TVMBackendParallelLaunch(barrier_task, nullptr, 0), 0);
+}
+
+static FTVMParallelLambda nested_launch = [](int task_id, TVMParallelGroupEnv* penv,
+                                              void* cdata) -> int {
+  std::atomic<size_t> acc(0);
+  if (TVMBackendParallelLaunch(atomic_add_task_id, &acc, 0) != 0) return -1;
+  if (acc.load(std::memory_order_relaxed) != N * (N - 1) / 2) return -1;
+  reinterpret_cast<std::atomic<int>*>(cdata)->fetch_add(1, std::memory_order_relaxed);
+  return 0;
+};
+
+TEST(ThreadingBackend, TVMBackendParallelLaunchNested) {
+  std::atomic<int> num_done(0);
+  EXPECT_EQ(TVMBackendParallelLaunch(nested_launch, &num_done, 0), 0);
+  EXPECT_GT(num_done.load(), 0);
+}
+
+TEST(ThreadingBackend, TVMBackendParallelLaunchSharedPool) {
+  const tvm::runtime::PackedFunc* config_shared =
+      tvm::runtime::Registry::Get("runtime.config_threadpool_shared");
+  ASSERT_TRUE(config_shared != nullptr);
+  (*config_shared)(true);
+  std::vector<std::unique_ptr<std::thread>> ts;
+  for (size_t i = 0; i < 4; ++i) {
+    ts.emplace_back(new std::thread([&]() {
+      for (size_t j = 0; j < 10; ++j) {
+        std::atomic<size_t> acc(0);
+        TVMBackendParallelLaunch(atomic_add_task_id, &acc, 0);
+        EXPECT_EQ(acc.load(std::memory_order_relaxed), N * (N - 1) / 2);
+      }
+      std::atomic<int> num_done(0);
+      EXPECT_EQ(TVMBackendParallelLaunch(nested_launch, &num_done, 0), 0);
+    }));
+  }
+  for (auto& t : ts) {
+    t->join();
+  }
+  (*config_shared)(false);
+}
+
+TEST(ThreadingBackend, ThreadPoolWaitStats) {
+  const tvm::runtime::PackedFunc* wait_stats =
+      tvm::runtime::Registry::Get("runtime.threadpool_wait_stats");
+  ASSERT_TRUE(wait_stats != nullptr);
+  std::atomic<size_t> acc(0);
+  TVMBackendParallelLaunch(atomic_add_task_id, &acc, 0);
+  std::string stats = (*wait_stats)(true);
+  EXPECT_NE(stats.find("\"spin_ns\""), std::string::npos);
+  EXPECT_NE(stats.find("\"num_parks\""), std::string::npos);
+  std::string reset = (*wait_stats)();
+  EXPECT_NE(reset.find("\"num_spin_wakeups\": 0"), std::string::npos);
+}
+
+TEST(ThreadingBackend, TVMBackendParallelLaunchNumaNode) {
+  const tvm::runtime::PackedFunc* num_numa_nodes =
+      tvm::runtime::Registry::Get("runtime.num_numa_nodes");
+  const tvm::runtime::PackedFunc* config_numa =
+      tvm::runtime::Registry::Get("runtime.config_threadpool_numa");
+  ASSERT_TRUE(num_numa_nodes != nullptr && config_numa != nullptr);
+  int num_nodes = (*num_numa_nodes)();
+  EXPECT_GE(num_nodes, 1);
+  // Containers may hide the node topology, ConfigureMissingNumaNode covers that case.
+  std::ifstream cpulist("/sys/devices/system/node/node" + std::to_string(num_nodes - 1) +
+                        "/cpulist");
+  if (!cpulist.good()) return;
+  (*config_numa)(num_nodes - 1);
+  EXPECT_EQ(tvm::runtime::threading::PreferredNumaNode(), num_nodes - 1);
+  std::atomic<size_t> acc(0);
+  TVMBackendParallelLaunch(atomic_add_task_id, &acc, 0);
+  EXPECT_EQ(acc.load(std::memory_order_relaxed), N * (N - 1) / 2);
+  void* workspace = TVMBackendAllocWorkspace(kDLCPU, 0, 1 << 20, kDLFloat, 32);
+  EXPECT_TRUE(workspace != nullptr);
+  EXPECT_EQ(TVMBackendFreeWorkspace(kDLCPU, 0, workspace), 0);
+  tvm::runtime::threading::SetPreferredNumaNode(-1);
+  (*tvm::runtime::Registry::Get("runtime.config_threadpool"))(1, 0);
+}
+
+TEST(ThreadingBackend, ConfigureMissingNumaNode) {
+  // A node without cores in sysfs falls back to the big cores.
+  std::atomic<bool> done(false);
+  tvm::runtime::threading::ThreadGroup group(
+      2,
+      [&done](int worker_id) {
+        while (!done.load()) std::this_thread::yield();
+      },
+      true);
+  int num_workers = group.ConfigureNumaNode(1 << 20, 0, true);
+  EXPECT_GE(num_workers, 1);
+  EXPECT_LE(num_workers, 2);
+  done.store(true);
+  group.Join();
+}
+
+#if defined(__linux__)
+struct SliceAffinity {
+  std::mutex mutex;
+  cpu_set_t cpus;
+};
+
+// Record the cores the task may run on.
+static FTVMParallelLambda record_affinity = [](int task_id, TVMParallelGroupEnv* penv,
+                                               void* cdata) -> int {
+  auto* affinity = reinterpret_cast<SliceAffinity*>(cdata);
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  if (sched_getaffinity(0, sizeof(cpu_set_t), &cpus) != 0) return -1;
+  std::lock_guard<std::mutex> lock(affinity->mutex);
+  CPU_OR(&affinity->cpus, &affinity->cpus, &cpus);
+  return 0;
+};
+
+TEST(ThreadingBackend, ThreadPoolCoreSlices) {
+  // Disjoint slices need a core per slice and permission to pin threads.
+  const int num_slices = 2;
+  const char* bind_threads = getenv("TVM_BIND_THREADS");
+  if (tvm::runtime::threading::MaxConcurrency() < num_slices ||
+      static_cast<int>(std::thread::hardware_concurrency()) < num_slices ||
+      (bind_threads != nullptr && atoi(bind_threads) != 1)) {
+    return;
+  }
+  std::vector<SliceAffinity> affinity(num_slices);
+  std::vector<std::unique_ptr<std::thread>> ts;
+  for (int i = 0; i < num_slices; ++i) {
+    CPU_ZERO(&affinity[i].cpus);
+    ts.emplace_back(new std::thread([&affinity, i, num_slices]() {
+      int num_workers = tvm::runtime::threading::ConfigureThreadPoolCoreSlice(i, num_slices);
+      EXPECT_GE(num_workers, 1);
+      for (int j = 0; j < 3; ++j) {
+        EXPECT_EQ(TVMBackendParallelLaunch(record_affinity, &affinity[i], 0), 0);
+      }
+    }));
+  }
+  for (auto& t : ts) {
+    t->join();
+  }
+  for (int i = 0; i < num_slices; ++i) {
+    EXPECT_GT(CPU_COUNT(&affinity[i].cpus), 0);
+    for (int j = i + 1; j < num_slices; ++j) {
+      cpu_set_t shared;
+      CPU_AND(&shared, &affinity[i].cpus, &affinity[j].cpus);
+      EXPECT_EQ(CPU_COUNT(&shared), 0) << "slices " << i << " and " << j << " share cores";
+    }
+  }
+}
+#endif
+
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
   testing::FLAGS_gtest_death_test_style = "threadsafe";
@@ -0,0 +1,124 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <tvm/runtime/c_backend_api.h>
+#include <tvm/runtime/device_api.h>
+
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../src/runtime/workspace_pool.h"
+
+using namespace tvm::runtime;
+
+// Device API that counts the allocations reaching the device.
+class CountingDeviceAPI final : public DeviceAPI {
+ public:
+  void SetDevice(TVMContext ctx) final {}
+  void GetAttr(TVMContext ctx, DeviceAttrKind kind, TVMRetValue* rv) final {}
+  void* AllocDataSpace(TVMContext ctx, size_t nbytes, size_t alignment,
+                       DLDataType type_hint) final {
+    ++num_device_allocs;
+    return malloc(nbytes);
+  }
+  void FreeDataSpace(TVMContext ctx, void* ptr) final {
+    ++num_device_frees;
+    free(ptr);
+  }
+  void CopyDataFromTo(const void* from, size_t from_offset, void* to, size_t to_offset, size_t size,
+                      TVMContext ctx_from, TVMContext ctx_to, DLDataType type_hint,
+                      TVMStreamHandle stream) final {}
+  void StreamSync(TVMContext ctx, TVMStreamHandle stream) final {}
+
+  int num_device_allocs{0};
+  int num_device_frees{0};
+};
+
+static TVMContext CPUContext() {
+  TVMContext ctx;
+  ctx.device_type = kDLCPU;
+  ctx.device_id = 0;
+  return ctx;
+}
+
+TEST(WorkspacePool, ReuseSizeClass) {
+  auto device = std::make_shared<CountingDeviceAPI>();
+  TVMContext ctx = CPUContext();
+  {
+    WorkspacePool pool(kDLCPU, device);
+    for (int run = 0; run < 10; ++run) {
+      std::vector<void*> ptrs;
+      for (size_t nbytes : {1, 4096, 5000, 100000, 1 << 20}) {
+        ptrs.push_back(pool.AllocWorkspace(ctx, nbytes));
+      }
+      // release out of order
+      for (size_t i = 0; i < ptrs.size(); i += 2) pool.FreeWorkspace(ctx, ptrs[i]);
+      for (size_t i = 1; i < ptrs.size(); i += 2) pool.FreeWorkspace(ctx, ptrs[i]);
+    }
+    // the repeating pattern only reaches the device on the first run
+    EXPECT_EQ(device->num_device_allocs, 5);
+    WorkspacePool::Stats stats = pool.GetStats(ctx);
+    EXPECT_EQ(stats.num_allocs, 50);
+    EXPECT_EQ(stats.num_reuses, 45);
+    EXPECT_EQ(stats.bytes_in_use, 0);
+    EXPECT_GE(stats.peak_bytes_in_use, 4096 + 4096 + 5000 + 100000 + (1 << 20));
+    EXPECT_EQ(stats.bytes_reserved, stats.peak_bytes_in_use);
+  }
+  EXPECT_EQ(device->num_device_frees, 5);
+}
+
+TEST(WorkspacePool, TrimGrowingSizes) {
+  auto device = std::make_shared<CountingDeviceAPI>();
+  TVMContext ctx = CPUContext();
+  WorkspacePool pool(kDLCPU, device);
+  for (size_t npages = 1; npages <= 256; ++npages) {
+    pool.FreeWorkspace(ctx, pool.AllocWorkspace(ctx, npages * 4096));
+  }
+  WorkspacePool::Stats stats = pool.GetStats(ctx);
+  // cached blocks are returned to the device instead of piling up
+  EXPECT_LE(stats.bytes_reserved, 2 * stats.peak_bytes_in_use);
+  EXPECT_GT(device->num_device_frees, 0);
+}
+
+TEST(WorkspacePool, BackendAllocWorkspaceThreads) {
+  std::vector<std::unique_ptr<std::thread>> ts;
+  for (int t = 0; t < 4; ++t) {
+    ts.emplace_back(new std::thread([]() {
+      for (int i = 0; i < 100; ++i) {
+        void* a = TVMBackendAllocWorkspace(kDLCPU, 0, 1000 * (i % 7 + 1), kDLFloat, 32);
+        void* b = TVMBackendAllocWorkspace(kDLCPU, 0, 123456, kDLFloat, 32);
+        EXPECT_TRUE(a != nullptr && b != nullptr && a != b);
+        EXPECT_EQ(TVMBackendFreeWorkspace(kDLCPU, 0, a), 0);
+        EXPECT_EQ(TVMBackendFreeWorkspace(kDLCPU, 0, b), 0);
+      }
+    }));
+  }
+  for (auto& t : ts) {
+    t->join();
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  testing::FLAGS_gtest_death_test_style = "threadsafe";
+  return RUN_ALL_TESTS();
+}
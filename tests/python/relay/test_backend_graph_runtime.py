@@ -14,6 +14,7 @@
 # KIND, either express or implied.  See the License for the
 # specific language governing permissions and limitations
 # under the License.
+import json
 import numpy as np
 
 import tvm
@@ -178,8 +179,123 @@ def test_gru_like():
             tvm.testing.assert_allclose(out, ref, rtol=1e-5, atol=1e-5)
 
 
+def _branchy_func():
+    x = relay.var("x", shape=(64,))
+    branches = []
+    for i in range(4):
+        b = relay.exp(relay.add(x, relay.const(float(i))))
+        b = relay.sqrt(relay.add(b, relay.const(1.0)))
+        branches.append(relay.log(b))
+    out = branches[0]
+    for b in branches[1:]:
+        out = relay.add(out, b)
+    return relay.Function([x], out)
+
+
+def _branchy_ref(x):
+    out = 0
+    for i in range(4):
+        out = out + np.log(np.sqrt(np.exp(x + i) + 1.0))
+    return out
+
+
+def test_plan_memory_parallel():
+    mod = tvm.IRModule.from_expr(_branchy_func())
+    mod = relay.transform.InferType()(mod)
+    mod = relay.transform.FuseOps(0)(mod)
+    func = mod["main"]
+
+    def num_storage_ids():
+        smap = relay.backend._backend.GraphPlanMemory(func)
+        return len(set(sid.value for v in smap.values() for sid in v[0]))
+
+    sequential = num_storage_ids()
+    with tvm.transform.PassContext(config={"relay.backend.parallel_memory_plan": True}):
+        parallel = num_storage_ids()
+    # branches that can run concurrently cannot share their temporaries.
+    assert parallel > sequential
+
+
+def test_inter_op_parallel():
+    x_data = np.random.rand(64).astype("float32")
+    configs = [{}, {"relay.backend.parallel_memory_plan": True}]
+    for config in configs:
+        with tvm.transform.PassContext(opt_level=0, config=config):
+            graph, lib, _ = relay.build(tvm.IRModule.from_expr(_branchy_func()), "llvm")
+        mod = graph_runtime.create(graph, lib, ctx=tvm.cpu(0))
+        for num_streams, threads_per_op in [(4, 1), (2, 0), (1, 0)]:
+            mod.set_inter_op_parallelism(num_streams, threads_per_op)
+            for _ in range(10):
+                mod.run(x=x_data)
+                res = mod.get_output(0).asnumpy()
+                tvm.testing.assert_allclose(res, _branchy_ref(x_data), rtol=1e-5)
+
+
+def test_freeze():
+    x_data = np.random.rand(64).astype("float32")
+    with tvm.transform.PassContext(opt_level=0):
+        graph, lib, _ = relay.build(tvm.IRModule.from_expr(_branchy_func()), "llvm")
+    mod = graph_runtime.create(graph, lib, ctx=tvm.cpu(0))
+    for small_op_bytes in [0, 1 << 20]:
+        mod.freeze(small_op_bytes)
+        for _ in range(3):
+            x_data = np.random.rand(64).astype("float32")
+            mod.run(x=x_data)
+            res = mod.get_output(0).asnumpy()
+            tvm.testing.assert_allclose(res, _branchy_ref(x_data), rtol=1e-5)
+
+
+def test_trace():
+    with tvm.transform.PassContext(opt_level=0):
+        graph, lib, _ = relay.build(tvm.IRModule.from_expr(_branchy_func()), "llvm")
+    mod = graph_runtime.create(graph, lib, ctx=tvm.cpu(0))
+    num_ops = len([n for n in json.loads(graph)["nodes"] if n["op"] == "tvm_op"])
+    mod.set_trace_config(0.5)
+    for _ in range(4):
+        mod.run(x=np.random.rand(64).astype("float32"))
+    events = json.loads(mod.get_trace("chrome"))["traceEvents"]
+    assert len(events) == 2 * num_ops
+    assert set(e["args"]["run"] for e in events) == {0, 2}
+    assert all(e["ph"] == "X" and e["dur"] >= 0 for e in events)
+    hist = json.loads(mod.get_trace("histogram", reset=True))
+    assert hist["num_runs"] == 4
+    assert all(n["count"] == 2 and sum(n["buckets"]) == 2 for n in hist["nodes"])
+    assert json.loads(mod.get_trace())["traceEvents"] == []
+    # the ring buffer keeps the newest events.
+    mod.set_trace_config(1, capacity=3)
+    mod.freeze()
+    mod.run(x=np.random.rand(64).astype("float32"))
+    events = json.loads(mod.get_trace())["traceEvents"]
+    assert [e["args"]["nid"] for e in events] == sorted(e["args"]["nid"] for e in events)
+    assert len(events) == min(3, num_ops)
+
+
+def test_pipeline():
+    x = relay.var("x", shape=(10, 5))
+    y = relay.var("y", shape=(1, 5))
+    func = relay.Function([x, y], relay.exp(relay.add(x, y)))
+    y_data = np.random.rand(1, 5).astype("float32")
+    graph, lib, params = relay.build(tvm.IRModule.from_expr(func), "llvm", params={"y": y_data})
+    pipeline = graph_runtime.create_pipeline(graph, lib, tvm.cpu(0), num_contexts=3)
+    assert pipeline.get_num_contexts() == 3
+    pipeline.load_params(relay.save_param_dict(params))
+    x_data = [np.random.rand(10, 5).astype("float32") for _ in range(16)]
+    requests = [pipeline.submit(x=data) for data in x_data]
+    # results can be collected in any order.
+    for data, req in reversed(list(zip(x_data, requests))):
+        res = req.result()[0].asnumpy()
+        tvm.testing.assert_allclose(res, np.exp(data + y_data), rtol=1e-5)
+    res = pipeline.submit(x_data[0]).result()[0].asnumpy()
+    tvm.testing.assert_allclose(res, np.exp(x_data[0] + y_data), rtol=1e-5)
+
+
 if __name__ == "__main__":
     test_plan_memory()
+    test_plan_memory_parallel()
+    test_inter_op_parallel()
+    test_freeze()
+    test_trace()
+    test_pipeline()
     test_with_params()
     test_add_op_scalar()
     test_add_op_tensor()
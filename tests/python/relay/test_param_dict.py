@@ -39,6 +39,60 @@ def test_save_load():
     np.testing.assert_equal(param2["y"].asnumpy(), y)
 
 
+def test_param_file():
+    x = np.random.rand(10, 2).astype("float32")
+    y = np.random.randint(-100, 100, size=(3,)).astype("int8")
+    temp = util.tempdir()
+    path = temp.relpath("params.bin")
+    relay.save_param_file({"x": x, "y": y}, path)
+    params = relay.load_param_file(path)
+    assert len(params) == 2
+    np.testing.assert_equal(params["x"].asnumpy(), x)
+    np.testing.assert_equal(params["y"].asnumpy(), y)
+
+    a = relay.var("a", shape=(10, 2))
+    b = relay.var("x", shape=(10, 2))
+    func = relay.Function([a, b], relay.add(a, b))
+    with tvm.transform.PassContext(opt_level=0):
+        graph, lib, _ = relay.build(tvm.IRModule.from_expr(func), "llvm")
+    mod = graph_runtime.create(graph, lib, ctx=tvm.cpu(0))
+    mod.load_params_file(path)
+    a_data = np.random.rand(10, 2).astype("float32")
+    mod.run(a=a_data)
+    np.testing.assert_allclose(mod.get_output(0).asnumpy(), a_data + x, rtol=1e-5)
+
+    mod = graph_runtime.create(graph, lib, ctx=tvm.cpu(0))
+    mod.load_params_file(path, lazy=True)
+    usage = json.loads(mod.get_param_usage())
+    assert usage["num_params"] == 1 and usage["unused"] == ["x"]
+    mod.run(a=a_data)
+    np.testing.assert_allclose(mod.get_output(0).asnumpy(), a_data + x, rtol=1e-5)
+    usage = json.loads(mod.get_param_usage())
+    assert usage["used"] == ["x"] and usage["bytes_used"] == x.nbytes
+
+
+def verify_param_file_zero_copy(lazy):
+    x = np.random.rand(10, 2).astype("float32")
+    path = util.tempdir().relpath("params.bin")
+    relay.save_param_file({"x": x}, path)
+    a = relay.var("a", shape=(10, 2))
+    b = relay.var("x", shape=(10, 2))
+    func = relay.Function([a, b], relay.add(a, b))
+    with tvm.transform.PassContext(opt_level=0):
+        graph, lib, _ = relay.build(tvm.IRModule.from_expr(func), "llvm")
+    mod = graph_runtime.create(graph, lib, ctx=tvm.cpu(0))
+    # binding the file rebuilds the operators, zero copy inputs go to the new ones
+    mod.load_params_file(path, lazy=lazy)
+    a_data = tvm.nd.array(np.random.rand(10, 2).astype("float32"))
+    mod.module["set_input_zero_copy"]("a", a_data)
+    mod.run()
+    np.testing.assert_allclose(mod.get_output(0).asnumpy(), a_data.asnumpy() + x, rtol=1e-5)
+
+
+def test_param_file_zero_copy():
+    verify_param_file_zero_copy(lazy=False)
+    verify_param_file_zero_copy(lazy=True)
+
 def test_ndarray_reflection():
     # Make two `NDArrayWrapper`s that point to the same underlying array.
     np_array = np.random.uniform(size=(10, 2)).astype("float32")
@@ -91,5 +145,7 @@ def test_bigendian_rpc_param():
 
 if __name__ == "__main__":
     test_save_load()
+    test_param_file()
+    test_param_file_zero_copy()
     test_ndarray_reflection()
     test_bigendian_rpc_param()
@@ -14,6 +14,9 @@
 # KIND, either express or implied.  See the License for the
 # specific language governing permissions and limitations
 # under the License.
+import json
+import threading
+
 import numpy as np
 import pytest
 
@@ -671,5 +674,195 @@ def test_vm_reshape_tensor():
     y_np = np.array([8, 2, 8]).astype("int32")
     check_result([x_np, y_np], x_np.reshape([8, 2, 8]), mod)
 
+def test_vm_best_fit_allocator():
+    x = relay.var("x", shape=(relay.Any(), 16), dtype="float32")
+    mod = tvm.IRModule()
+    mod["main"] = relay.Function([x], relay.add(x, x))
+    exe = relay.vm.compile(mod, "llvm")
+    ctx = tvm.cpu()
+    runtime.vm.VirtualMachine.set_allocator_cache_limit(1 << 16)
+    try:
+        # Virtual machines on one context get the allocator they ask for.
+        pooled_vm = runtime.vm.VirtualMachine(exe, ctx)
+        vm = runtime.vm.VirtualMachine(exe, ctx, memory_cfg="best_fit")
+        assert json.loads(pooled_vm.get_allocator_stats())["type"] == "pooled"
+        assert json.loads(vm.get_allocator_stats())["type"] == "best_fit"
+        for n in [64, 8, 17, 128, 3, 64]:
+            x_np = np.random.rand(n, 16).astype("float32")
+            res = vm.invoke("main", x_np)
+            tvm.testing.assert_allclose(res.asnumpy(), x_np + x_np)
+            tvm.testing.assert_allclose(pooled_vm.invoke("main", x_np).asnumpy(), x_np + x_np)
+        del res
+        # Everything is free now, the cache is trimmed to the limit.
+        stats = json.loads(vm.get_allocator_stats())
+        assert stats["used_memory"] <= 1 << 16
+    finally:
+        runtime.vm.VirtualMachine.set_allocator_cache_limit(-1)
+
+def test_vm_arena_allocator():
+    x = relay.var("x", shape=(relay.Any(), 16), dtype="float32")
+    y = relay.add(x, x)
+    mod = tvm.IRModule()
+    mod["main"] = relay.Function([x], relay.multiply(y, y))
+    exe = relay.vm.compile(mod, "llvm")
+    vm = runtime.vm.VirtualMachine(exe, tvm.cpu(), memory_cfg="arena")
+    get_stats = lambda: json.loads(vm.get_allocator_stats())
+    assert get_stats()["type"] == "arena"
+    # Keep earlier outputs alive so that later runs cannot reuse their arena.
+    results = []
+    for n in [8, 8, 32, 4, 32]:
+        x_np = np.random.rand(n, 16).astype("float32")
+        results.append((vm.invoke("main", x_np), x_np))
+    for res, x_np in results:
+        tvm.testing.assert_allclose(res.asnumpy(), (2 * x_np) * (2 * x_np), rtol=1e-5)
+    held = get_stats()["used_memory"]
+    del results, res
+    # The arenas of the dropped outputs are recycled, and the next runs reuse one arena.
+    used = []
+    for _ in range(4):
+        x_np = np.random.rand(32, 16).astype("float32")
+        res = vm.invoke("main", x_np)
+        tvm.testing.assert_allclose(res.asnumpy(), (2 * x_np) * (2 * x_np), rtol=1e-5)
+        del res
+        used.append(get_stats()["used_memory"])
+    assert used[1] == used[2] == used[3] and 0 < used[3] < held
+    # A failed run releases its storage, and the arena keeps serving the same demand.
+    with pytest.raises(tvm.error.TVMError):
+        vm.invoke("main", np.random.rand(32, 8).astype("float32"))
+    res = vm.invoke("main", x_np)
+    tvm.testing.assert_allclose(res.asnumpy(), (2 * x_np) * (2 * x_np), rtol=1e-5)
+    del res
+    assert get_stats()["used_memory"] == used[3]
+    # A fork on the same context has an arena of its own.
+    forked = vm.fork()
+    get_fork_stats = lambda: json.loads(forked.get_allocator_stats())
+    assert get_fork_stats()["type"] == "arena" and get_fork_stats()["used_memory"] == 0
+    kept = vm.invoke("main", x_np)
+    res = forked.invoke("main", x_np)
+    tvm.testing.assert_allclose(kept.asnumpy(), (2 * x_np) * (2 * x_np), rtol=1e-5)
+    tvm.testing.assert_allclose(res.asnumpy(), (2 * x_np) * (2 * x_np), rtol=1e-5)
+    assert get_fork_stats()["used_memory"] > 0
+
+
+def test_vm_shape_cache():
+    x = relay.var("x", shape=(relay.Any(), 16), dtype="float32")
+    mod = tvm.IRModule()
+    mod["main"] = relay.Function([x], relay.add(x, x))
+    exe = relay.vm.compile(mod, "llvm")
+    vm = runtime.vm.VirtualMachine(exe, tvm.cpu())
+    results = []
+    for n in [8, 8, 32, 8, 32]:
+        x_np = np.random.rand(n, 16).astype("float32")
+        results.append((vm.invoke("main", x_np), x_np))
+    for res, x_np in results:
+        tvm.testing.assert_allclose(res.asnumpy(), x_np + x_np)
+    stats = json.loads(vm.get_shape_cache_stats())
+    assert stats["misses"] == 2
+    assert stats["hits"] == 3
+    # Storage is only kept across runs on request.
+    assert stats["storage_reuses"] == 0 and stats["storage_bytes"] == 0
+    results = None
+    vm.set_storage_cache(1 << 20)
+    # Dropped outputs hand their storage to the next run of the same size.
+    for n in [8, 8, 8]:
+        x_np = np.random.rand(n, 16).astype("float32")
+        res = vm.invoke("main", x_np)
+        tvm.testing.assert_allclose(res.asnumpy(), x_np + x_np)
+    stats = json.loads(vm.get_shape_cache_stats())
+    assert stats["storage_reuses"] > 0
+    assert 0 < stats["storage_bytes"] <= 1 << 20
+    # A different size allocates a new buffer instead of keeping the larger one.
+    res = None
+    res = vm.invoke("main", np.ones((2, 16), "float32"))
+    after = json.loads(vm.get_shape_cache_stats())
+    assert after["storage_allocs"] == stats["storage_allocs"] + 1
+    assert after["storage_bytes"] <= stats["storage_bytes"]
+    # Nothing is kept beyond the limit.
+    vm.set_storage_cache(16)
+    for n in [8, 8]:
+        res = vm.invoke("main", np.ones((n, 16), "float32"))
+    stats = json.loads(vm.get_shape_cache_stats())
+    assert stats["storage_reuses"] == 0 and stats["storage_bytes"] == 0
+    vm.set_shape_cache(0)
+    res = vm.invoke("main", np.ones((4, 16), "float32"))
+    tvm.testing.assert_allclose(res.asnumpy(), np.full((4, 16), 2, "float32"))
+    assert json.loads(vm.get_shape_cache_stats())["misses"] == 0
+
+def test_vm_fork():
+    x = relay.var("x", shape=(relay.Any(), 16), dtype="float32")
+    c_np = np.random.rand(16).astype("float32")
+    mod = tvm.IRModule()
+    mod["main"] = relay.Function([x], relay.add(x, relay.const(c_np)))
+    exe = relay.vm.compile(mod, "llvm")
+    vm = runtime.vm.VirtualMachine(exe, tvm.cpu())
+    errors = []
+
+    def run(fork, seed):
+        rng = np.random.RandomState(seed)
+        try:
+            for _ in range(20):
+                x_np = rng.rand(rng.randint(1, 32), 16).astype("float32")
+                res = fork.invoke("main", x_np)
+                tvm.testing.assert_allclose(res.asnumpy(), x_np + c_np)
+        except Exception as err:  # pylint: disable=broad-except
+            errors.append(err)
+
+    threads = [threading.Thread(target=run, args=(vm.fork(), i)) for i in range(4)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    assert not errors, errors
+    # The forks share the device constants with the virtual machine they came from.
+    assert json.loads(vm.get_param_usage())["num_used"] == 1
+
+def test_vm_invoke_async():
+    x = relay.var("x", shape=(relay.Any(), 16), dtype="float32")
+    y = relay.add(x, x)
+    mod = tvm.IRModule()
+    mod["main"] = relay.Function([x], relay.multiply(y, y))
+    exe = relay.vm.compile(mod, "llvm")
+    vm = runtime.vm.VirtualMachine(exe, tvm.cpu())
+    inputs = [np.random.rand(n, 16).astype("float32") for n in [3, 8, 5]]
+    invocations = [vm.fork().invoke_async("main", x_np) for x_np in inputs]
+    results = runtime.vm.run_interleaved(invocations)
+    for res, x_np in zip(results, inputs):
+        tvm.testing.assert_allclose(res.asnumpy(), (2 * x_np) * (2 * x_np), rtol=1e-5)
+    # The virtual machine can be invoked again once the invocation finished.
+    res = runtime.vm.run_interleaved([vm.invoke_async("main", inputs[0])])[0]
+    tvm.testing.assert_allclose(res.asnumpy(), (2 * inputs[0]) * (2 * inputs[0]), rtol=1e-5)
+    tvm.testing.assert_allclose(vm.invoke("main", inputs[1]).asnumpy(),
+                                (2 * inputs[1]) * (2 * inputs[1]), rtol=1e-5)
+    # Generators created before either runs keep their own inputs.
+    first = vm.invoke_async("main", inputs[0])
+    second = vm.invoke_async("main", inputs[1])
+    for invocation, x_np in [(first, inputs[0]), (second, inputs[1])]:
+        res = runtime.vm.run_interleaved([invocation])[0]
+        tvm.testing.assert_allclose(res.asnumpy(), (2 * x_np) * (2 * x_np), rtol=1e-5)
+
+
+def test_vm_invoke_async_abandoned():
+    x = relay.var("x", shape=(relay.Any(), 16), dtype="float32")
+    y = relay.add(x, x)
+    mod = tvm.IRModule()
+    mod["main"] = relay.Function([x], relay.multiply(y, y))
+    exe = relay.vm.compile(mod, "llvm")
+    vm = runtime.vm.VirtualMachine(exe, tvm.cpu())
+    x_np = np.random.rand(4, 16).astype("float32")
+    invocation = vm.invoke_async("main", x_np)
+    next(invocation)
+    # Dropping the invocation halfway cancels it.
+    del invocation
+    tvm.testing.assert_allclose(vm.invoke("main", x_np).asnumpy(),
+                                (2 * x_np) * (2 * x_np), rtol=1e-5)
+    # So does closing it, and a generator that never ran leaves nothing to cancel.
+    invocation = vm.invoke_async("main", x_np)
+    next(invocation)
+    invocation.close()
+    vm.invoke_async("main", x_np)
+    tvm.testing.assert_allclose(vm.invoke("main", x_np).asnumpy(),
+                                (2 * x_np) * (2 * x_np), rtol=1e-5)
+
+
 if __name__ == "__main__":
     pytest.main([__file__])
@@ -16,7 +16,9 @@
 # under the License.
 # pylint: disable=invalid-name, missing-docstring, no-else-return
 """Unit tests for the Relay VM serialization and deserialization."""
+import json
 import numpy as np
+import pytest
 
 import tvm
 from tvm.runtime import vm as _vm
@@ -149,6 +151,81 @@ def test_const():
     tvm.testing.assert_allclose(res.asnumpy(), x_data + 1)
 
 
+def test_late_bound_consts():
+    big = np.random.rand(64, 64).astype("float32")
+    small = np.random.rand(2).astype("float32")
+    x = relay.var('x', shape=(64, 64), dtype='float32')
+    y = relay.var('y', shape=(2,), dtype='float32')
+    f = relay.Function([x, y], relay.Tuple([x + relay.const(big), y + relay.const(small)]))
+    exe = create_exec(f)
+    path = util.tempdir().relpath("consts.bin")
+    exe.move_late_bound_consts(path, byte_limit=1024)
+    code, lib = exe.save()
+    des_exec = _vm.Executable.load_exec(code, lib)
+    des_exec.load_late_bound_consts(path)
+    des_vm = _vm.VirtualMachine(des_exec, tvm.cpu())
+    usage = json.loads(des_vm.get_param_usage())
+    assert len(usage["unloaded"]) == 1 and usage["bytes_total"] == small.nbytes
+    x_data = np.random.rand(64, 64).astype('float32')
+    y_data = np.random.rand(2).astype('float32')
+    res = des_vm.run(x_data, y_data)
+    tvm.testing.assert_allclose(res[0].asnumpy(), x_data + big)
+    tvm.testing.assert_allclose(res[1].asnumpy(), y_data + small)
+    usage = json.loads(des_vm.get_param_usage())
+    assert usage["num_used"] == usage["num_params"] and not usage["unloaded"]
+
+
+def test_late_bound_consts_moved_twice():
+    big = np.random.rand(64, 64).astype("float32")
+    small = np.random.rand(2).astype("float32")
+    x = relay.var('x', shape=(64, 64), dtype='float32')
+    y = relay.var('y', shape=(2,), dtype='float32')
+    f = relay.Function([x, y], relay.Tuple([x + relay.const(big), y + relay.const(small)]))
+    exe = create_exec(f)
+    path = util.tempdir().relpath("consts.bin")
+    exe.move_late_bound_consts(path, byte_limit=1024)
+    # The moved constant is only in the file, it has to be loaded to be moved again.
+    with pytest.raises(tvm.error.TVMError):
+        exe.move_late_bound_consts(path, byte_limit=0)
+    exe.load_late_bound_consts(path)
+    exe.move_late_bound_consts(path, byte_limit=0)
+    saved = tvm.get_global_func("runtime.LoadParamFile")(path)
+    arrays = [saved[i].asnumpy() for i in range(1, len(saved), 2)]
+    assert any(np.array_equal(a, big) for a in arrays)
+    assert any(np.array_equal(a, small) for a in arrays)
+    code, lib = exe.save()
+    des_exec = _vm.Executable.load_exec(code, lib)
+    des_exec.load_late_bound_consts(path)
+    des_vm = _vm.VirtualMachine(des_exec, tvm.cpu())
+    x_data = np.random.rand(64, 64).astype('float32')
+    y_data = np.random.rand(2).astype('float32')
+    res = des_vm.run(x_data, y_data)
+    tvm.testing.assert_allclose(res[0].asnumpy(), x_data + big)
+    tvm.testing.assert_allclose(res[1].asnumpy(), y_data + small)
+
+
+def test_mappable_file():
+    big = np.random.rand(64, 64).astype("float32")
+    small = np.random.rand(2).astype("float32")
+    x = relay.var('x', shape=(64, 64), dtype='float32')
+    y = relay.var('y', shape=(2,), dtype='float32')
+    f = relay.Function([x, y], relay.Tuple([x + relay.const(big), y + relay.const(small)]))
+    exe = create_exec(f)
+    path = util.tempdir().relpath("exec.tvm")
+    exe.save_to_mappable_file(path)
+    des_exec = _vm.Executable.load_from_mappable_file(path, exe.lib)
+    des_vm = _vm.VirtualMachine(des_exec, tvm.cpu())
+    x_data = np.random.rand(64, 64).astype('float32')
+    y_data = np.random.rand(2).astype('float32')
+    res = des_vm.run(x_data, y_data)
+    tvm.testing.assert_allclose(res[0].asnumpy(), x_data + big)
+    tvm.testing.assert_allclose(res[1].asnumpy(), y_data + small)
+    # The loaded executable saves its constants inline again.
+    code, lib = des_exec.save()
+    res = _vm.VirtualMachine(_vm.Executable.load_exec(code, lib), tvm.cpu()).run(x_data, y_data)
+    tvm.testing.assert_allclose(res[0].asnumpy(), x_data + big)
+
+
 def test_if():
     x = relay.var('x', shape=(10, 10))
     y = relay.var('y', shape=(10, 10))
@@ -300,6 +377,8 @@ if __name__ == "__main__":
     test_serializer()
     test_save_load()
     test_const()
+    test_late_bound_consts()
+    test_late_bound_consts_moved_twice()
     test_if()
     test_loop()
     test_tuple()
@@ -110,6 +110,18 @@ def test_graph_simple():
         out = mod.get_output(0, tvm.nd.empty((n,)))
         np.testing.assert_equal(out.asnumpy(), a + 1)
 
+        #verify the hardware counters where the OS allows them
+        if mod.enable_perf_counters():
+            mod.set_op_flops({"myadd": n})
+            mod.run_individual(10)
+            rows = mod.get_perf_counters().strip().split("\n")
+            assert len(rows) == 2
+            cols = rows[1].split("\t")
+            assert cols[0].strip() == "add"
+            assert cols[7] == str(2 * n * 4)
+            assert float(cols[-1]) == 8.0
+            mod.enable_perf_counters(False)
+
         mod.exit()
         #verify dump root delete after cleanup
         assert(not os.path.exists(directory))
@@ -19,6 +19,8 @@ from tvm import te
 import tvm.testing
 import os
 import stat
+import struct
+import sys
 import logging
 import time
 import multiprocessing
@@ -27,6 +29,8 @@ import pytest
 import numpy as np
 from tvm import rpc
 from tvm.contrib import util, cc
+from tvm.rpc import base
+from tvm.rpc.base import TrackerCode
 from tvm.rpc.tracker import Tracker
 
 
@@ -131,6 +135,121 @@ def test_rpc_large_array():
     np.testing.assert_equal(b.asnumpy(), b_np)
 
 
+def test_rpc_copy_arrays():
+    if not tvm.runtime.enabled("rpc"):
+        return
+    server = rpc.Server("localhost")
+    remote = rpc.connect(server.host, server.port)
+    ctx = remote.cpu(0)
+    shapes = [(0,), (1,), (1000,), (300, 1024)]
+    data = [np.random.uniform(size=shape).astype("float32") for shape in shapes]
+    for chunk_bytes, window in [(0, 1), (1000, 1), (4096, 4), (1 << 20, 8)]:
+        remote.set_copy_window(chunk_bytes, window)
+        r_arrs = [tvm.nd.empty(x.shape, "float32", ctx) for x in data]
+        remote.copy_arrays(list(zip([tvm.nd.array(x) for x in data], r_arrs)))
+        outs = [tvm.nd.empty(x.shape, "float32") for x in data]
+        remote.copy_arrays(list(zip(r_arrs, outs)))
+        for x, out in zip(data, outs):
+            np.testing.assert_equal(out.asnumpy(), x)
+        np.testing.assert_equal(r_arrs[-1].asnumpy(), data[-1])
+
+
+def test_rpc_async_function():
+    if not tvm.runtime.enabled("rpc"):
+        return
+    @tvm.register_func("rpc.test.async_add")
+    def async_add(x, y):
+        return x + y
+
+    @tvm.register_func("rpc.test.async_error")
+    def async_error():
+        raise ValueError("async error")
+
+    server = rpc.Server("localhost")
+    client = rpc.connect(server.host, server.port)
+    fadd = client.get_async_function("rpc.test.async_add")
+    results = [fadd(i, 1) for i in range(10)]
+    assert client.get_function("rpc.test.async_add")(2, 3) == 5
+    error = client.get_async_function("rpc.test.async_error")()
+    later = fadd(10, 1)
+    fadd(0, 0)  # dropped without waiting
+    for i in reversed(range(10)):
+        assert results[i]() == i + 1
+    with pytest.raises(tvm.error.RPCError):
+        error()
+    assert later() == 11
+    assert client.get_function("rpc.test.async_add")(4, 4) == 8
+
+
+def test_rpc_async_drop_handle():
+    if not tvm.runtime.enabled("rpc"):
+        return
+    @tvm.register_func("rpc.test.async_make_adder")
+    def make_adder(x):
+        return lambda y: x + y
+
+    server = rpc.Server("localhost")
+    client = rpc.connect(server.host, server.port)
+    # the function handle is freed when its last return is read
+    result = client.get_async_function("rpc.test.async_make_adder")(1)
+    assert result()(2) == 3
+    # the returned remote function is freed with a return nobody waits for
+    client.get_async_function("rpc.test.async_make_adder")(2)
+    result = client.get_async_function("rpc.test.async_make_adder")(3)
+    assert client.get_function("rpc.test.async_make_adder")(4)(1) == 5
+    assert result()(1) == 4
+
+
+def test_rpc_batch_evaluate():
+    if not tvm.runtime.enabled("rpc") or not tvm.runtime.enabled("llvm"):
+        return
+    n = 102
+    A = te.placeholder((n,), name='A')
+    temp = util.tempdir()
+    paths = []
+    for i in range(2):
+        B = te.compute(A.shape, lambda *k: A(*k) + float(i + 1), name='B')
+        s = te.create_schedule(B.op)
+        # the modules share a base name
+        os.mkdir(temp.relpath("build%d" % i))
+        paths.append(temp.relpath(os.path.join("build%d" % i, "lib.so")))
+        tvm.build(s, [A, B], "llvm", name="myadd").export_library(paths[-1])
+    paths.append(temp.relpath("broken.so"))
+    with open(paths[-1], "wb") as outfile:
+        outfile.write(b"not a library")
+
+    server = rpc.Server("localhost")
+    remote = rpc.connect(server.host, server.port)
+    ctx = remote.cpu(0)
+    a = tvm.nd.array(np.random.uniform(size=n).astype(A.dtype), ctx)
+    b = tvm.nd.array(np.zeros(n, dtype=A.dtype), ctx)
+    finished = []
+    results = remote.batch_evaluate(paths, "myadd", ctx, [a, b], number=2, repeat=3,
+                                    callback=lambda i, res: finished.append(i))
+    assert finished == [0, 1, 2]
+    assert len(results[0].results) == 3 and results[1].mean > 0
+    assert isinstance(results[2], str)
+    # the last module that ran wrote the output
+    np.testing.assert_equal(b.asnumpy(), a.asnumpy() + 2)
+
+
+def test_rpc_shm_session():
+    if not tvm.runtime.enabled("rpc") or not sys.platform.startswith("linux"):
+        return
+    client = rpc.ShmSession()
+    fecho = client.get_function("testing.echo")
+    assert fecho(1, 2, 3) == 1
+    assert fecho("xyz") == "xyz"
+    ctx = client.cpu(0)
+    # larger than the ring in each direction
+    data = np.random.randint(0, 1 << 20, size=(3 << 20)).astype("int32")
+    a = tvm.nd.array(data, ctx)
+    np.testing.assert_equal(a.asnumpy(), data)
+    b = tvm.nd.array(np.zeros(7, dtype="float32"), ctx)
+    b.copyfrom(np.arange(7, dtype="float32"))
+    np.testing.assert_equal(b.asnumpy(), np.arange(7, dtype="float32"))
+
+
 def test_rpc_echo():
     def check(remote):
         fecho = remote.get_function("testing.echo")
@@ -473,6 +592,41 @@ def test_rpc_tracker_request():
     tracker.terminate()
 
 
+def test_rpc_tracker_least_loaded():
+    """The tracker gives a request to the least loaded server."""
+    tracker = Tracker('localhost', port=9000, port_end=10000)
+    device_key = 'test_device'
+
+    def fake_server(load, matchkey):
+        sock = base.connect_with_retry((tracker.host, tracker.port))
+        sock.sendall(struct.pack('<i', base.RPC_TRACKER_MAGIC))
+        assert struct.unpack('<i', base.recvall(sock, 4))[0] == base.RPC_TRACKER_MAGIC
+        for msg in [[TrackerCode.UPDATE_INFO, {"key": "server:" + device_key}],
+                    [TrackerCode.UPDATE_INFO, {"load": load, "capacity": 4}],
+                    [TrackerCode.PUT, device_key, [9091, matchkey], None]]:
+            base.sendjson(sock, msg)
+            assert base.recvjson(sock) == TrackerCode.SUCCESS
+        return sock
+
+    busy = fake_server(3, device_key + ":busy")
+    idle = fake_server(1, device_key + ":idle")
+
+    sock = base.connect_with_retry((tracker.host, tracker.port))
+    sock.sendall(struct.pack('<i', base.RPC_TRACKER_MAGIC))
+    base.recvall(sock, 4)
+    matchkeys = []
+    for _ in range(2):
+        base.sendjson(sock, [TrackerCode.REQUEST, device_key, "", 1])
+        value = base.recvjson(sock)
+        assert value[0] == TrackerCode.SUCCESS
+        matchkeys.append(value[1][2])
+    assert matchkeys == [device_key + ":idle", device_key + ":busy"]
+
+    for s in [sock, busy, idle]:
+        s.close()
+    tracker.terminate()
+
+
 if __name__ == "__main__":
     logging.basicConfig(level=logging.INFO)
     test_rpc_echo()
@@ -487,4 +641,10 @@ if __name__ == "__main__":
     test_local_func()
     test_rpc_tracker_register()
     test_rpc_tracker_request()
+    test_rpc_tracker_least_loaded()
     test_rpc_large_array()
+    test_rpc_copy_arrays()
+    test_rpc_async_function()
+    test_rpc_async_drop_handle()
+    test_rpc_batch_evaluate()
+    test_rpc_shm_session()
@@ -22,6 +22,27 @@ from tvm.runtime import profiler_vm
 from tvm import relay
 from tvm.relay.testing import resnet
 
+PERF_COUNTER_COLUMNS = ["#OpName", "#Calls", "#Cycles", "#Instructions", "#IPC", "#LLCMisses",
+                        "#BranchMisses", "#Bytes", "#FLOP", "#Bytes/FLOP"]
+
+
+def get_perf_counter_rows(report):
+    """Parse the perf counter report into the values of each op, keyed by name."""
+    lines = [line for line in report.splitlines() if line.strip()]
+    if not lines:
+        return {}
+    assert [col.strip() for col in lines[0].split("\t")] == PERF_COUNTER_COLUMNS
+    rows = {}
+    for line in lines[1:]:
+        values = [v.strip() for v in line.split("\t")]
+        assert len(values) == len(PERF_COUNTER_COLUMNS)
+        assert int(values[1]) > 0
+        # Events the host cannot count are shown as "-".
+        assert all(v == "-" or float(v) >= 0 for v in values[2:])
+        rows[values[0]] = values[1:]
+    return rows
+
+
 def test_basic():
     mod, params = resnet.get_workload()
     target = 'llvm'
@@ -35,6 +56,68 @@ def test_basic():
     res = vm.invoke("main", [data])
     print("\n{}".format(vm.get_stat()))
     print("\n{}".format(vm.get_stat(False)))
+    if vm.enable_perf_counters():
+        vm.invoke("main", [data])
+        report = vm.get_perf_counters()
+        print("\n{}".format(report))
+        assert any(name.startswith("fused_nn_conv2d") for name in get_perf_counter_rows(report))
+
+
+def test_perf_counters():
+    x = relay.var("x", shape=(3, 4), dtype="float32")
+    mod = tvm.IRModule()
+    mod["main"] = relay.Function([x], relay.nn.relu(x + relay.const(1.0)))
+    if not profiler_vm.enabled():
+        return
+    exe = relay.vm.compile(mod, "llvm")
+    vm = profiler_vm.VirtualMachineProfiler(exe, tvm.cpu())
+    data = np.random.rand(3, 4).astype("float32")
+
+    # Nothing is counted while the counters are off.
+    vm.invoke("main", [data])
+    assert not get_perf_counter_rows(vm.get_perf_counters())
+    if not vm.enable_perf_counters():
+        return
+    vm.invoke("main", [data])
+    vm.invoke("main", [data])
+    rows = get_perf_counter_rows(vm.get_perf_counters())
+    assert list(rows) == ["fused_add_nn_relu"]
+    assert rows["fused_add_nn_relu"][0] == "2"
+    # At least the bytes of the input and the output.
+    assert int(rows["fused_add_nn_relu"][6]) >= 2 * data.nbytes
+
+    vm.enable_perf_counters(False)
+    vm.reset()
+    vm.invoke("main", [data])
+    assert not get_perf_counter_rows(vm.get_perf_counters())
+
+
+def test_instruction_profile():
+    x = relay.var("x", shape=(relay.Any(), 4), dtype="float32")
+    mod = tvm.IRModule()
+    mod["main"] = relay.Function([x], relay.nn.relu(x + relay.const(1.0)))
+    if not profiler_vm.enabled():
+        return
+    exe = relay.vm.compile(mod, "llvm")
+    vm = profiler_vm.VirtualMachineProfiler(exe, tvm.cpu())
+    vm.enable_instruction_profile()
+
+    data = np.random.rand(3, 4).astype("float32")
+    res = vm.invoke("main", [data])
+    np.testing.assert_allclose(res.asnumpy(), np.maximum(data + 1.0, 0.0))
+    report = vm.get_instruction_stat()
+    print("\n{}".format(report))
+    assert "Function main" in report
+    assert "InvokePacked(shape_func)" in report
+    assert "AllocStorage" in report
+    assert "Frames pushed: 1, popped: 1" in report
+
+    vm.reset()
+    vm.enable_instruction_profile(False)
+    vm.invoke("main", [data])
+    assert "Function main" not in vm.get_instruction_stat()
 
 if __name__ == "__main__":
     test_basic()
+    test_perf_counters()
+    test_instruction_profile()